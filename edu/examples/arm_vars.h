@@ -8,6 +8,16 @@
 
 using namespace arma;
 
+// The model sets the grid size at run time now, but this example
+// compares fixed-size and dynamic cubes, so it needs the sizes here:
+
+#define nGeoLons 18
+#define nGeoLonsG nGeoGhosts + nGeoLons + nGeoGhosts
+#define nGeoLats 36
+#define nGeoLatsG nGeoGhosts + nGeoLats + nGeoGhosts
+#define nGeoAlts 50
+#define nGeoAltsG nGeoGhosts + nGeoAlts + nGeoGhosts
+
 class Grid {
 
  public:
@@ -11,6 +11,9 @@
 #include "../include/grid.h"
 #include "../include/planets.h"
 #include "../include/ions.h"
+#include "../include/workers.h"
+#include "../include/parallel.h"
+#include "../include/scheduler.h"
 
 int advance( Planets &planet,
 	     Grid &gGrid,
@@ -21,6 +24,9 @@ int advance( Planets &planet,
 	     Chemistry &chemistry,
 	     Indices &indices,
 	     Inputs &args,
+	     Workers &workers,
+	     Parallel &parallel,
+	     Scheduler &scheduler,
 	     Report &report);
 
 #endif // AETHER_INCLUDE_ADVANCE_H_
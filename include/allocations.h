@@ -0,0 +1,22 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#ifndef AETHER_INCLUDE_ALLOCATIONS_H_
+#define AETHER_INCLUDE_ALLOCATIONS_H_
+
+// -----------------------------------------------------------------------------
+// A time step shouldn't allocate anything: the fields are all in the
+// arena, and everything else is set up before the first step.  To
+// check this, build with make CHECK_ALLOCATIONS=1, which counts every
+// call to new (so every std::vector, std::string, std::function, ...),
+// and advance will complain if a step allocates anything.  Without it,
+// nothing is counted.
+// -----------------------------------------------------------------------------
+
+// 1 if allocations are being counted:
+int is_counting_allocations();
+
+// Number of allocations since the start of the run:
+long get_nAllocations();
+
+#endif // AETHER_INCLUDE_ALLOCATIONS_H_
@@ -0,0 +1,100 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#ifndef AETHER_INCLUDE_ARENA_H_
+#define AETHER_INCLUDE_ARENA_H_
+
+#include <vector>
+#include <functional>
+
+#include "inputs.h"
+#include "report.h"
+
+// -----------------------------------------------------------------------------
+// The arena owns the memory for all of the 3D fields (in Grid, Neutrals
+// and Ions).  It hands out pieces of a few big slabs, and every field
+// starts on a cache line (64 bytes), so vector loads are aligned.
+// The slabs can be backed by huge pages (#hugepages in aether.in),
+// which cuts down on TLB misses for big grids.  Everything is freed
+// when the arena goes away, so the model can be set up and torn down
+// many times (e.g., when it is embedded in another code).
+// -----------------------------------------------------------------------------
+
+class Arena {
+
+ public:
+
+  // Fields start on this boundary (in bytes):
+  static const long alignment = 64;
+
+  // Size of a huge page (in bytes):
+  static const long huge_page = 2 * 1024 * 1024;
+
+  // This is called on every new field before it is used.  It gets the
+  // field, the number of grid points and the number of values per grid
+  // point (e.g., 3 for a vector).  It has to zero the field.  The
+  // default zeroes it on the calling thread, but if the grid is split
+  // into tiles, each thread can touch its own tiles first, so that the
+  // pages end up close to the thread that will use them:
+  typedef std::function<void(float *field,
+			     long nPoints,
+			     long nValuesPerPoint)> touch_function;
+
+  Arena(const Inputs &input, Report &report);
+  ~Arena();
+
+  // The arena owns the memory, so it can't be copied:
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  // A set of per-species fields (e.g., the neutral densities) can be
+  // laid out three ways (#species_layout in aether.in):
+  //   separate      : each species gets its own field (the default)
+  //   species_major : one [species][lon][lat][alt] tensor
+  //   interleaved   : one [lon][lat][alt][species] tensor
+  // allocate_species fills in a pointer for each species and returns
+  // the stride, so species iSpecies at a grid point (index) is at
+  // fields[iSpecies][index * stride].  The stride is 1, except for the
+  // interleaved layout, where it is the number of species.
+  static const int separate_layout = 0;
+  static const int species_major_layout = 1;
+  static const int interleaved_layout = 2;
+
+  float *allocate(long nPoints, long nValuesPerPoint = 1);
+  long allocate_species(long nPoints,
+			long nTotalSpecies,
+			std::vector<float*> &fields);
+  int get_species_layout();
+
+  // For index arrays (e.g., which profile each column uses).  These
+  // are just zeroed:
+  long *allocate_indices(long nIndices);
+  void set_first_touch(touch_function toucher);
+  long get_nBytes();
+  long get_nFields();
+
+ private:
+
+  struct slab_struct {
+    char *start;
+    long nBytes;
+    long nBytesUsed;
+  };
+
+  std::vector<slab_struct> slabs;
+
+  int UseHugePages;
+  int species_layout;
+  long slab_size;
+  long nFields;
+  long nBytesFields;
+
+  touch_function first_touch;
+
+  slab_struct new_slab(long nBytesNeeded);
+  char *allocate_bytes(long nBytes);
+  void zero(float *field, long nPoints, long nValuesPerPoint);
+
+};
+
+#endif // AETHER_INCLUDE_ARENA_H_
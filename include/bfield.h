@@ -13,22 +13,22 @@ struct bfield_info_type {
 bfield_info_type get_bfield(float lon,
 			    float lat,
 			    float alt,
-			    Planets planet,
-			    Inputs input,
+			    const Planets &planet,
+			    const Inputs &input,
 			    Report &report);
 
 bfield_info_type get_dipole(float lon,
 			    float lat,
 			    float alt,
-			    Planets planet,
-			    Inputs input,
+			    const Planets &planet,
+			    const Inputs &input,
 			    Report &report);
 
 bfield_info_type get_dipole(float lon,
 			    float lat,
 			    float alt,
-			    Planets planet,
-			    Inputs input,
+			    const Planets &planet,
+			    const Inputs &input,
 			    Report &report);
 
 #endif // AETHER_INCLUDE_EUV_H_
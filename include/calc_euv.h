@@ -15,19 +15,25 @@
 #include "euv.h"
 #include "neutrals.h"
 #include "ions.h"
+#include "workers.h"
 
 // -------------------------------------------------------------------------
-//
+// The EUV heating and ionization, which are updated when IsDue (every
+// dt_euv, see Scheduler).  With #euv
+// interpolate, the sources go smoothly from one update to the next
+// (the grid's SZA is moved ahead and back for this).
 // -------------------------------------------------------------------------
 
-int calc_euv( Planets planet,
-	      Grid grid,
-	      Times time,
+int calc_euv( Planets &planet,
+	      Grid &grid,
+	      const Times &time,
 	      Euv &euv,
 	      Neutrals &neutrals,
 	      Ions &ions,
-	      Indices indices,
-	      Inputs args,
+	      const Indices &indices,
+	      const Inputs &args,
+	      int IsDue,
+	      Workers &workers,
 	      Report &report);
 
 #endif // AETHER_INCLUDE_CALC_EUV_H_
@@ -43,61 +43,107 @@ class Chemistry {
 
   std::vector<reaction_type> reactions;
   long nReactions;
+
+  // The chemistry puts all of the species into one list: the
+  // neutrals, then the ions, with the electrons last:
+  static const int nChemSpecies = nSpecies + nIons + 1;
+  static const int iFirstIon = nSpecies;
+  static const int iElectrons = nSpecies + nIons;
+
+  // The sources and losses at one grid point, for each of the species
+  // in the list.  The losses are first, then the sources, so that a
+  // reaction adds to both through one list (see compile_reactions).
+  // Each thread has its own, since the grid is split up between
+  // threads (see workers.h):
+  struct sources_and_losses_type {
+
+    float values[2 * nChemSpecies];
+
+    float &loss(int iSpecies) { return values[iSpecies]; }
+    float &source(int iSpecies) { return values[nChemSpecies + iSpecies]; }
+
+  };
   
-  Chemistry(Neutrals neutrals,
-	    Ions ions,
-	    Inputs args,
+  Chemistry(const Neutrals &neutrals,
+	    const Ions &ions,
+	    const Inputs &args,
 	    Report &report);
+  Chemistry(const Chemistry &) = delete;
+  Chemistry &operator=(const Chemistry &) = delete;
 
     
   void calc_chemistry(Neutrals &neutrals,
 		      Ions &ions,
-		      Times time,
-		      Grid grid,
+		      float dt,
+		      int nSubcycles,
+		      const Grid &grid,
+		      Workers &workers,
 		      Report &report);
-
-  void calc_chemical_sources(float *neutral_density,
-			     float *ion_density,
-			     float Tn,
-			     float Ti,
-			     float Te,
-			     Report &report);
+  // calc_chemistry in pieces (see Neutrals, #column_fusion).  The
+  // electrons have to be filled in the columns before they are done:
+  void prepare_chemistry(int nThreads);
+  void calc_chemistry_columns(Neutrals &neutrals,
+			      Ions &ions,
+			      float dt,
+			      int nSubcycles,
+			      const tile_struct &tile,
+			      int iThread);
+  void finish_chemistry(Neutrals &neutrals);
+
+  // The longest (sub-)step that the chemistry allows, from the last
+  // time through calc_chemistry on this processor (see calc_chemistry):
+  float get_dt_limit() const { return dt_limit; }
+
+  // Add the sources and losses from all of the reactions at a grid
+  // point, with the densities of the species in the list above:
+  void calc_chemical_sources(const float *density,
+			     sources_and_losses_type &sources_and_losses) const;
 
  private:
 
-  struct sources_and_losses_type {
-
-    float neutral_sources[nSpecies];
-    float neutral_losses[nSpecies];
-    float ion_sources[nIons];
-    float ion_losses[nIons];
-    
-    float heat_neutrals;
-    float heat_ions;
-    float heat_electrons;
-
-  };
-
-  sources_and_losses_type sources_and_losses;
-  
-  int read_chemistry_file(Neutrals neutrals,
-			  Ions ions,
-			  Inputs args,
+  // How much a species can change in a step (0 is no limit, see
+  // Inputs::dt_input_struct), the limit that this gives, and the
+  // smallest limit that each thread found:
+  float chemistry_change;
+  float dt_limit;
+  std::vector<float> dt_limit_scratch;
+
+  // The reactions, compiled into flat tables (compressed rows, like a
+  // sparse matrix), so that a grid point doesn't have to go through
+  // the reaction_types.  The reactants of reaction iReaction are
+  // reactant_ids[reactant_start[iReaction] to
+  // reactant_start[iReaction+1]] (in the list of species, with a
+  // species that reacts twice in there twice).  What the reaction
+  // changes is in the same form: target_ids is where in
+  // sources_and_losses_type.values it goes (a loss or a source), and
+  // target_coefs is how many of the species it takes or makes:
+  std::vector<float> reaction_rates;
+  std::vector<int> reactant_start;
+  std::vector<int> reactant_ids;
+  std::vector<int> target_start;
+  std::vector<int> target_ids;
+  std::vector<float> target_coefs;
+
+  void compile_reactions();
+
+  int read_chemistry_file(const Neutrals &neutrals,
+			  const Ions &ions,
+			  const Inputs &args,
 			  Report &report);
   
-  reaction_type interpret_reaction_line(Neutrals neutrals,
-					Ions ions,
-					std::vector<std::string> line,
+  reaction_type interpret_reaction_line(const Neutrals &neutrals,
+					const Ions &ions,
+					const std::vector<std::string> &line,
 					Report &report);
 
-  void find_species_id(std::string name,
-		       Neutrals neutrals,
-		       Ions ions,
+  void find_species_id(const std::string &name,
+		       const Neutrals &neutrals,
+		       const Ions &ions,
 		       int &id_,
 		       int &IsNeutral,
 		       Report &report);
 
-  void display_reaction(reaction_type reaction);
+  void display_reaction(const reaction_type &reaction);
 
 
   
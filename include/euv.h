@@ -14,6 +14,7 @@
 #include "grid.h"
 #include "ions.h"
 #include "report.h"
+#include "spectrum_file.h"
 
 class Euv {
 
@@ -48,37 +49,70 @@ public:
   // Initialize EUV
   // --------------------------------------------------------------------------
 
-  Euv(Inputs args, Report report);
+  Euv(const Inputs &args, Report &report);
+  Euv(const Euv &) = delete;
+  Euv &operator=(const Euv &) = delete;
+
+  // 0 if the files (or the #euv_model spectrum file) couldn't be read,
+  // so the model can't run:
+  int is_ok() const;
 
   // -------------------------------------------------------------------------
-  //
+  // Fill in the spectrum at 1 AU (wavelengths_intensity_1au) with the
+  // #euv_model: euvac (from F10.7 and F10.7A), fixed (EUVAC at
+  // F10.7 = F10.7A = 100), or file (see spectrum_file.h).  What the
+  // spectrum was made from is kept, so if that hasn't changed, this
+  // does nothing.
   // -------------------------------------------------------------------------
 
-  int euvac(Times time, Indices indices, Report &report);
+  int calc_spectrum(const Times &time, const Indices &indices, Report &report);
+
+  // Forget what the spectrum was made from, so that the next
+  // calc_spectrum does it again (see main, with #euv_bins):
+  void reset_spectrum();
+
+  // -------------------------------------------------------------------------
+  // The EUVAC spectrum for f107 and f107a
+  // -------------------------------------------------------------------------
+
+  int euvac(float f107, float f107a, Report &report);
 
   // -------------------------------------------------------------------------
   //
   // -------------------------------------------------------------------------
 
-  int scale_from_1au(Planets planet, Times time);
+  int scale_from_1au(Planets &planet, const Times &time);
   
 private:
-  
+
+  std::string euv_model;
+  SpectrumFile spectrum_file;
+  int IsOk = 0;
+
+  // What is in wavelengths_intensity_1au now: F10.7 and F10.7A (for
+  // euvac and fixed), or the record and weight (for file):
+  float spectrum_f107 = -1.0;
+  float spectrum_f107a = -1.0;
+  long spectrum_iRecord = -1;
+  float spectrum_weight = -1.0;
+  // Whether the time was outside of the spectrum file last time:
+  int IsOutsideFile = 0;
+
   // --------------------------------------------------------------------------
   // Read in the EUV file that describes all of the wavelengths and
   // cross sections
   // --------------------------------------------------------------------------
 
-  int read_file(Inputs args, Report report);
+  int read_file(const Inputs &args, Report &report);
 
   // --------------------------------------------------------------------------
   //
   // --------------------------------------------------------------------------
 
-  int slot_euv(std::string item,
-	       std::string item2,
+  int slot_euv(const std::string &item,
+	       const std::string &item2,
 	       std::vector<float> &values,
-	       Report report);
+	       Report &report);
   
 };
 
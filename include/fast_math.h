@@ -0,0 +1,144 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#ifndef AETHER_INCLUDE_FAST_MATH_H_
+#define AETHER_INCLUDE_FAST_MATH_H_
+
+#include <cstdint>
+#include <cstring>
+
+// -----------------------------------------------------------------------------
+// log, exp and pow that the compiler can vectorize.  The ones in
+// <cmath> are function calls (and can set errno), so a loop with pow
+// in it is done one point at a time.  These are only adds, multiplies,
+// a divide and bit twiddling (no branches or tables), so a loop over a
+// column with fast_pow in it is done 2 or 4 points at a time.
+//
+// Error bound (checked in test.cpp against <cmath>):
+//   fast_log(x) : absolute error < 2e-14 * (1 + |log(x)|), for normal x > 0
+//   fast_exp(x) : relative error < 1e-13, for |x| < 700
+//   fast_pow(x, p) = fast_exp(p * fast_log(x)) : relative error
+//     < 1e-13 * (1 + |p log(x)|), for normal x > 0 and |p log(x)| < 700
+//   fast_expf(x) : (a float exp) relative error < 3e-7, for |x| < 87
+// That is a lot smaller than the precision of a float (6e-8), so the
+// fields (which are floats) are the same to within a float ulp or so.
+// There are no checks for x <= 0, inf or nan!
+// -----------------------------------------------------------------------------
+
+inline double bits_to_double(uint64_t bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+inline uint64_t double_to_bits(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+inline double fast_log(double x) {
+
+  const double ln2 = 0.6931471805599453;
+  // Adding this and taking it away turns bits into a double:
+  const double two52 = 4503599627370496.0;
+  // The bits of 1.0 minus the bits of sqrt(1/2):
+  const uint64_t offset = 0x3ff0000000000000ULL - 0x3fe6a09e667f3bcdULL;
+
+  // x = m * 2^e, with sqrt(1/2) <= m < sqrt(2), so s (below) is
+  // small.  Adding offset moves the exponent bits up by one when the
+  // mantissa is more than sqrt(2), which does this without an if:
+  uint64_t bits = double_to_bits(x);
+  uint64_t iExp = (bits + offset) >> 52;
+  double m = bits_to_double(bits - (iExp << 52) + 0x3ff0000000000000ULL);
+  double e = bits_to_double(0x4330000000000000ULL | iExp) - two52 - 1023.0;
+
+  // log(m) = 2 atanh(s), with |s| < 0.172:
+  double s = (m - 1.0) / (m + 1.0);
+  double s2 = s * s;
+  double series =
+    1.0 + s2 * (1.0 / 3.0 +
+    s2 * (1.0 / 5.0 +
+    s2 * (1.0 / 7.0 +
+    s2 * (1.0 / 9.0 +
+    s2 * (1.0 / 11.0 +
+    s2 * (1.0 / 13.0 +
+    s2 * (1.0 / 15.0)))))));
+
+  return e * ln2 + 2.0 * s * series;
+
+}
+
+inline double fast_exp(double x) {
+
+  const double log2e = 1.4426950408889634;
+  // ln(2) is split in two, so n * ln2_hi is exact:
+  const double ln2_hi = 0.6931471803691238;
+  const double ln2_lo = 1.9082149292705877e-10;
+  // Adding this rounds to an integer, which is then in the low bits:
+  const double round = 6755399441055744.0;
+
+  // x = n ln(2) + r, with |r| <= ln(2)/2, so exp(x) = 2^n exp(r):
+  double shifted = x * log2e + round;
+  double n = shifted - round;
+  double r = (x - n * ln2_hi) - n * ln2_lo;
+
+  double poly =
+    1.0 + r * (1.0 +
+    r * (1.0 / 2.0 +
+    r * (1.0 / 6.0 +
+    r * (1.0 / 24.0 +
+    r * (1.0 / 120.0 +
+    r * (1.0 / 720.0 +
+    r * (1.0 / 5040.0 +
+    r * (1.0 / 40320.0 +
+    r * (1.0 / 362880.0 +
+    r * (1.0 / 3628800.0 +
+    r * (1.0 / 39916800.0)))))))))));
+
+  // 2^n, made by putting n into the exponent bits:
+  uint64_t iN = double_to_bits(shifted) - double_to_bits(round);
+  double two_n = bits_to_double((iN + 1023) << 52);
+
+  return poly * two_n;
+
+}
+
+inline double fast_pow(double x, double p) {
+  return fast_exp(p * fast_log(x));
+}
+
+// The same as fast_exp, but all in floats (so twice as many at a time),
+// with a shorter polynomial, for when the answer is a float anyway:
+inline float fast_expf(float x) {
+
+  const float log2e = 1.44269504f;
+  const float ln2_hi = 0.693145752f;
+  const float ln2_lo = 1.42860677e-6f;
+  const float round = 12582912.0f;
+
+  float shifted = x * log2e + round;
+  float n = shifted - round;
+  float r = (x - n * ln2_hi) - n * ln2_lo;
+
+  float poly =
+    1.0f + r * (1.0f +
+    r * (1.0f / 2.0f +
+    r * (1.0f / 6.0f +
+    r * (1.0f / 24.0f +
+    r * (1.0f / 120.0f +
+    r * (1.0f / 720.0f +
+    r * (1.0f / 5040.0f)))))));
+
+  uint32_t bits, round_bits, two_n_bits;
+  memcpy(&bits, &shifted, sizeof(bits));
+  memcpy(&round_bits, &round, sizeof(round_bits));
+  two_n_bits = (bits - round_bits + 127) << 23;
+  float two_n;
+  memcpy(&two_n, &two_n_bits, sizeof(two_n));
+
+  return poly * two_n;
+
+}
+
+#endif // AETHER_INCLUDE_FAST_MATH_H_
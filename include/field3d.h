@@ -0,0 +1,373 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#ifndef AETHER_INCLUDE_FIELD3D_H_
+#define AETHER_INCLUDE_FIELD3D_H_
+
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+#include "sizes.h"
+
+// -----------------------------------------------------------------------------
+// Field3D is a view of a 3D field (it doesn't own the memory, the arena
+// does).  It knows the extents of the grid, so the index math is all
+// in one place, instead of in a bunch of macros:
+//
+//   Field3D<float> temperature(neutrals.temperature_s3gc, extents);
+//   temperature(iLon, iLat, iAlt) = 200.0;
+//
+//   nComponents : 1 for scalars (_s3gc), 3 for vectors (_v3gc)
+//   Stagger : 0 for cell centers, 1 for cell edges in altitude (_s3ge3),
+//             which have one more point in altitude
+//   stride : distance between values (e.g., for interleaved species)
+//
+// If the code is compiled with -DAETHER_BOUNDS_CHECK (see the
+// Makefile), every index is checked against the extents, and the code
+// stops if it is outside of the grid.  Otherwise the index is the same
+// address math as the old ijk_ macros.
+//
+// The views can also split the grid into tiles of columns, so loops
+// can be blocked:
+//
+//   for (tile_struct tile : temperature.tiles(4, 4, 0))
+//     for (column_struct column : temperature.columns(tile))
+//       ... temperature(column.iLon, column.iLat, iAlt) ...
+// -----------------------------------------------------------------------------
+
+#ifdef AETHER_BOUNDS_CHECK
+#define FIELD3D_CHECK(iLon, iLat, iAlt, iComponent) \
+  check(iLon, iLat, iAlt, iComponent)
+#else
+#define FIELD3D_CHECK(iLon, iLat, iAlt, iComponent)
+#endif
+
+// A tile is the block of columns [iLonStart, iLonEnd) x [iLatStart, iLatEnd)
+// (the ends are NOT inclusive, unlike the grid extents):
+struct tile_struct {
+  long iLonStart, iLonEnd;
+  long iLatStart, iLatEnd;
+};
+
+// A column is all of the altitudes at one lon and lat:
+struct column_struct {
+  long iLon, iLat;
+};
+
+// -----------------------------------------------------------------------------
+// Loops through the columns of a tile, with the latitude changing the
+// fastest, so it walks through memory in order.
+// -----------------------------------------------------------------------------
+
+class tile_columns {
+
+ public:
+
+  class iterator {
+   public:
+    iterator(const tile_struct &tile, long iLon, long iLat)
+      : tile_(tile), column_{iLon, iLat} {}
+    column_struct operator*() const { return column_; }
+    iterator &operator++() {
+      column_.iLat++;
+      if (column_.iLat >= tile_.iLatEnd) {
+	column_.iLat = tile_.iLatStart;
+	column_.iLon++;
+      }
+      return *this;
+    }
+    bool operator!=(const iterator &other) const {
+      return column_.iLon != other.column_.iLon ||
+	column_.iLat != other.column_.iLat;
+    }
+   private:
+    tile_struct tile_;
+    column_struct column_;
+  };
+
+  tile_columns(const tile_struct &tile) : tile_(tile) {}
+
+  iterator begin() const {
+    if (tile_.iLonStart >= tile_.iLonEnd || tile_.iLatStart >= tile_.iLatEnd)
+      return end();
+    return iterator(tile_, tile_.iLonStart, tile_.iLatStart);
+  }
+  iterator end() const {
+    return iterator(tile_, tile_.iLonEnd, tile_.iLatStart);
+  }
+
+ private:
+  tile_struct tile_;
+
+};
+
+// -----------------------------------------------------------------------------
+// Split the lon/lat plane into tiles of (at most) nLonsPerTile x
+// nLatsPerTile columns.  If DoGhostCells is 0, only the physical
+// cells are tiled.
+// -----------------------------------------------------------------------------
+
+inline std::vector<tile_struct> make_tiles(const grid_extents &ext,
+					   long nLonsPerTile,
+					   long nLatsPerTile,
+					   int DoGhostCells) {
+
+  std::vector<tile_struct> tiles;
+  tile_struct tile;
+
+  long iLonStart = ext.iLonStart_, iLonEnd = ext.iLonEnd_ + 1;
+  long iLatStart = ext.iLatStart_, iLatEnd = ext.iLatEnd_ + 1;
+  if (DoGhostCells) {
+    iLonStart = 0;
+    iLonEnd = ext.nLonsG;
+    iLatStart = 0;
+    iLatEnd = ext.nLatsG;
+  }
+
+  if (nLonsPerTile < 1) nLonsPerTile = iLonEnd - iLonStart;
+  if (nLatsPerTile < 1) nLatsPerTile = iLatEnd - iLatStart;
+
+  for (long iLon = iLonStart; iLon < iLonEnd; iLon += nLonsPerTile) {
+    for (long iLat = iLatStart; iLat < iLatEnd; iLat += nLatsPerTile) {
+      tile.iLonStart = iLon;
+      tile.iLonEnd = std::min(iLon + nLonsPerTile, iLonEnd);
+      tile.iLatStart = iLat;
+      tile.iLatEnd = std::min(iLat + nLatsPerTile, iLatEnd);
+      tiles.push_back(tile);
+    }
+  }
+
+  return tiles;
+
+}
+
+// -----------------------------------------------------------------------------
+// Factor nTiles into nLonTiles x nLatTiles, so that the tiles of an
+// nLons x nLats plane are as square as they can be (the edges of a
+// tile, which have to be shared, are then as short as they can be).
+// Each tile has to have at least nMinPerTile cells in each direction.
+// Returns 0 if there is no way to do it.
+// -----------------------------------------------------------------------------
+
+inline int factor_tiles(long nTiles, long nLons, long nLats, long nMinPerTile,
+			long &nLonTiles, long &nLatTiles) {
+
+  float aspect, best_aspect = 0.0;
+  int IsFound = 0;
+
+  for (long nLonT = 1; nLonT <= nTiles; nLonT++) {
+    if (nTiles % nLonT != 0) continue;
+    long nLatT = nTiles / nLonT;
+    if (nLonT * nMinPerTile > nLons || nLatT * nMinPerTile > nLats) continue;
+    aspect = (float(nLons) / nLonT) / (float(nLats) / nLatT);
+    if (aspect < 1.0) aspect = 1.0 / aspect;
+    if (!IsFound || aspect < best_aspect) {
+      nLonTiles = nLonT;
+      nLatTiles = nLatT;
+      best_aspect = aspect;
+      IsFound = 1;
+    }
+  }
+
+  return IsFound;
+
+}
+
+// -----------------------------------------------------------------------------
+// The view itself.
+// -----------------------------------------------------------------------------
+
+template <typename T, int nComponents = 1, int Stagger = 0>
+class Field3D {
+
+ public:
+
+  Field3D(T *data, const grid_extents &extents, long stride = 1)
+    : data_(data),
+      extents_(extents),
+      nAltsS_(extents.nAltsG + Stagger),
+      stride_(stride) {}
+
+  // Index of a grid point.  For scalars at cell centers, this is the
+  // same index as every other _s3gc field:
+  inline long index(long iLon, long iLat, long iAlt) const {
+    FIELD3D_CHECK(iLon, iLat, iAlt, 0);
+    return (iLon * extents_.nLatsG + iLat) * nAltsS_ + iAlt;
+  }
+
+  // Index of a value in the field (for vectors, this is the old ijkl_v3gc):
+  inline long value_index(long iLon, long iLat, long iAlt,
+			  long iComponent = 0) const {
+    FIELD3D_CHECK(iLon, iLat, iAlt, iComponent);
+    return index(iLon, iLat, iAlt) * nComponents + iComponent;
+  }
+
+  inline T &operator()(long iLon, long iLat, long iAlt,
+		       long iComponent = 0) const {
+    return data_[value_index(iLon, iLat, iAlt, iComponent) * stride_];
+  }
+
+  // Start of a column, and the distance between altitudes in it:
+  inline T *column(long iLon, long iLat) const {
+    return data_ + value_index(iLon, iLat, 0) * stride_;
+  }
+  inline long column_stride() const {
+    return nComponents * stride_;
+  }
+
+  std::vector<tile_struct> tiles(long nLonsPerTile,
+				 long nLatsPerTile,
+				 int DoGhostCells) const {
+    return make_tiles(extents_, nLonsPerTile, nLatsPerTile, DoGhostCells);
+  }
+
+  tile_columns columns(const tile_struct &tile) const {
+    return tile_columns(tile);
+  }
+
+  // All of the columns, including the ghost cells:
+  tile_columns columns() const {
+    tile_struct all = {0, extents_.nLonsG, 0, extents_.nLatsG};
+    return tile_columns(all);
+  }
+
+  T *data() const { return data_; }
+  const grid_extents &extents() const { return extents_; }
+  long nAlts() const { return nAltsS_; }
+
+ private:
+
+  T *data_;
+  grid_extents extents_;
+  long nAltsS_;
+  long stride_;
+
+  void check(long iLon, long iLat, long iAlt, long iComponent) const {
+    if (iLon < 0 || iLon >= extents_.nLonsG ||
+	iLat < 0 || iLat >= extents_.nLatsG ||
+	iAlt < 0 || iAlt >= nAltsS_ ||
+	iComponent < 0 || iComponent >= nComponents) {
+      std::cout << "Field3D : index out of bounds!!! "
+		<< "(iLon, iLat, iAlt, iComponent) = ("
+		<< iLon << ", " << iLat << ", " << iAlt << ", "
+		<< iComponent << "), but the field is "
+		<< extents_.nLonsG << " x " << extents_.nLatsG << " x "
+		<< nAltsS_ << " x " << nComponents << "\n";
+      std::abort();
+    }
+  }
+
+};
+
+// -----------------------------------------------------------------------------
+// Field2D is the same sort of view for things that don't change with
+// altitude (_s2gc), like the solar zenith angle.  These are [Lon][Lat],
+// so there is one value per column.
+// -----------------------------------------------------------------------------
+
+template <typename T>
+class Field2D {
+
+ public:
+
+  Field2D(T *data, const grid_extents &extents)
+    : data_(data),
+      extents_(extents) {}
+
+  inline long index(long iLon, long iLat) const {
+    FIELD3D_CHECK(iLon, iLat, 0, 0);
+    return iLon * extents_.nLatsG + iLat;
+  }
+
+  inline T &operator()(long iLon, long iLat) const {
+    return data_[index(iLon, iLat)];
+  }
+
+  // All of the columns, including the ghost cells:
+  tile_columns columns() const {
+    tile_struct all = {0, extents_.nLonsG, 0, extents_.nLatsG};
+    return tile_columns(all);
+  }
+
+  T *data() const { return data_; }
+  const grid_extents &extents() const { return extents_; }
+
+ private:
+
+  T *data_;
+  grid_extents extents_;
+
+  void check(long iLon, long iLat, long iAlt, long iComponent) const {
+    if (iLon < 0 || iLon >= extents_.nLonsG ||
+	iLat < 0 || iLat >= extents_.nLatsG) {
+      std::cout << "Field2D : index out of bounds!!! "
+		<< "(iLon, iLat) = (" << iLon << ", " << iLat
+		<< "), but the field is "
+		<< extents_.nLonsG << " x " << extents_.nLatsG << "\n";
+      std::abort();
+    }
+  }
+
+};
+
+// -----------------------------------------------------------------------------
+// ProfileField is a view of grid geometry that only changes with
+// altitude (_s1gc), like the radius.  Columns with the same geometry
+// share one 1D profile, so the data is [profile][alt], and each column
+// has the number of its profile (iProfile_s2gc in the grid).  Indexing
+// looks just like a 3D field, but column() is what kernels should use,
+// since a profile is small enough to stay in the L1 cache.
+// -----------------------------------------------------------------------------
+
+template <typename T>
+class ProfileField {
+
+ public:
+
+  ProfileField(T *data, const long *iProfile_s2gc, const grid_extents &extents)
+    : data_(data),
+      iProfile_(iProfile_s2gc),
+      extents_(extents) {}
+
+  inline long index(long iLon, long iLat, long iAlt) const {
+    FIELD3D_CHECK(iLon, iLat, iAlt, 0);
+    return iProfile_[iLon * extents_.nLatsG + iLat] * extents_.nAltsG + iAlt;
+  }
+
+  inline T &operator()(long iLon, long iLat, long iAlt) const {
+    return data_[index(iLon, iLat, iAlt)];
+  }
+
+  // The whole profile for a column (nAltsG long):
+  inline T *column(long iLon, long iLat) const {
+    return data_ + index(iLon, iLat, 0);
+  }
+
+  T *data() const { return data_; }
+  const grid_extents &extents() const { return extents_; }
+
+ private:
+
+  T *data_;
+  const long *iProfile_;
+  grid_extents extents_;
+
+  void check(long iLon, long iLat, long iAlt, long iComponent) const {
+    if (iLon < 0 || iLon >= extents_.nLonsG ||
+	iLat < 0 || iLat >= extents_.nLatsG ||
+	iAlt < 0 || iAlt >= extents_.nAltsG) {
+      std::cout << "ProfileField : index out of bounds!!! "
+		<< "(iLon, iLat, iAlt) = ("
+		<< iLon << ", " << iLat << ", " << iAlt
+		<< "), but the grid is "
+		<< extents_.nLonsG << " x " << extents_.nLatsG << " x "
+		<< extents_.nAltsG << "\n";
+      std::abort();
+    }
+  }
+
+};
+
+#endif // AETHER_INCLUDE_FIELD3D_H_
@@ -16,5 +16,6 @@ std::string strip_string_end(std::string instring);
 std::string strip_spaces(std::string instring);
 std::string read_string(std::ifstream &file_ptr, std::string hash);
 int read_int(std::ifstream &file_ptr, std::string hash);
+float read_float(std::ifstream &file_ptr, std::string hash);
 
 #endif // AETHER_INCLUDE_FILE_INPUT_H_
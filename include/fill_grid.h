@@ -9,7 +9,7 @@
 #include "grid.h"
 #include "times.h"
 
-void fill_grid_radius(Grid &gGrid, Planets planet, Inputs input);
+void fill_grid_radius(Grid &gGrid, const Planets &planet, const Inputs &input);
 // void fill_grid_sza(Grid &gGrid, Planets planet, Times time, Inputs input);
 // void fill_grid(Grid &gGrid, Planets planet, Inputs input);
 
@@ -8,6 +8,9 @@
 #include "sizes.h"
 #include "planets.h"
 #include "times.h"
+#include "arena.h"
+#include "field3d.h"
+#include "workers.h"
 
 // We need a naming convention for the variables that are defined on
 // the grid.  These could then match the formulas that are used to find
@@ -18,63 +21,40 @@
   1 - indication of whether variable is scalar (s) or vector (v)
   2 - physical dimensions:
       3 - 3d (e.g., lon, lat, alt or x, y, z)
+      2 - 2d (lon, lat) - the same all the way up the column
+      1 - 1d (alt) - profiles that are shared by columns (see below)
       
 
 
 For example:
   _s3gc : scalar variable, 3d, include ghost cells, cell centers
+  _s2gc : scalar variable, 2d (one value per column), include ghost cells
+  _s1gc : scalar variable, 1d altitude profiles, include ghost cells
   _31ne : 
 
 
  */
 
-// These are mapping functions from 3d to 1d arrays. They have to be
-// pretty precise, which is a bit scary to me.
-//
-// Assume [Lon][Lat][Alt] layout
-
-// Scalars, 3D, Include Ghostcells, Cell Centers:
-#define ijk_geo_s3gc(i,j,k) \
-  ((i)*long(nGeoLatsG)*long(nGeoAltsG) + \
-   (j)*long(nGeoAltsG) + \
-   (k))
-#define ijk_mag_s3gc(i,j,k) \
-  ((i)*long(nMagLatsG)*long(nGeoAltsG) + \
-   (j)*long(nMagAltsG) + \
-   (k))
-
-// Scalars, 3D, Include Ghostcells, Cell Edges (Altitude):
-#define ijk_geo_s3ge3(i,j,k) \
-  ((i)*long(nGeoLatsG)*long(nGeoAltsG+1) + \
-   (j)*long(nGeoAltsG+1) + \
-   (k));
-
-// Vectors, 3D, Include Ghostcells, Cell Centers:
-#define ijkl_geo_v3gc(i,j,k,l) \
-  ((i)*long(nGeoLatsG)*long(nGeoAltsG)*long(3) + \
-   (j)*long(nGeoAltsG)*long(3) + \
-   (k)*long(3) + \
-   (l))
-// Vectors, 3D, Include Ghostcells, Cell Centers:
-#define ijkl_mag_v3gc(i,j,k,l) \
-  ((i)*long(nMagLatsG)*long(nMagAltsG)*long(3) + \
-   (j)*long(nMagAltsG)*long(3) + \
-   (k)*long(3) + \
-   (l))
-
+// The mapping from 3d to 1d arrays is done by Field3D (field3d.h),
+// which is built from the extents of the grid that the variable lives
+// on (geo or mag).  Everything is [Lon][Lat][Alt].
 
 class Grid {
 
 public:
 
-  int get_IsGeoGrid();
+  int get_IsGeoGrid() const;
   void set_IsGeoGrid(int value);
 
-  long get_nPointsInGrid();
+  long get_nPointsInGrid() const;
+
+  // Number of cells in each direction (with and without ghost cells):
+  grid_extents extents;
   
-  // These define the geographic grid:
-  float *geoLon_s3gc, *geoX_s3gc;
-  float *geoLat_s3gc, *geoY_s3gc;
+  // These define the geographic grid.  Longitude and latitude don't
+  // change with altitude, so they are 2D:
+  float *geoLon_s2gc, *geoX_s3gc;
+  float *geoLat_s2gc, *geoY_s3gc;
   float *geoAlt_s3gc, *geoZ_s3gc;
   
   // These define the magnetic grid:
@@ -93,11 +73,33 @@ public:
   std::string latitude_unit = "radians";
   
   // These are derived variables from the grid:
-  float *radius_s3gc;
-  float *radius_sq_s3gc;
-  float *radius_inv_sq_s3gc;
-  float *gravity_s3gc;
-  float *sza_s3gc, *cos_sza_s3gc;
+  float *sza_s2gc, *cos_sza_s2gc;
+
+  // The radius, gravity and cell sizes only depend on the altitudes of
+  // the column and the radius of the planet under it.  On a spherical
+  // planet with the same altitudes everywhere, every column is the
+  // same, so columns that match share one profile.  iProfile_s2gc says
+  // which profile each column uses.  If the geometry is different
+  // everywhere, there are nColumnsG profiles, so this is never bigger
+  // than a 3D field.  Use profile() to get a view of these:
+  long nProfiles;
+  long *iProfile_s2gc;
+  float *radius_s1gc;
+  float *radius_sq_s1gc;
+  float *radius_inv_sq_s1gc;
+  float *gravity_s1gc;
+  float *dalt_center_s1gc;
+  float *dalt_lower_s1gc;
+
+  // Spacing terms for the conduction solver (see conduction_metrics in
+  // solvers.h), which are also only a function of the altitudes:
+  float *conduction_r_s1gc;
+  float *conduction_du12_s1gc;
+  float *conduction_du22_s1gc;
+
+  ProfileField<float> profile(float *field_s1gc) const {
+    return ProfileField<float>(field_s1gc, iProfile_s2gc, extents);
+  }
   
   float *bfield_v3gc;
   float *bfield_mag_s3gc;
@@ -106,19 +108,51 @@ public:
 
   float *alt_edges;
   float *alt_cell_width;
-  float *dalt_center_s3gc;
-  float *dalt_lower_s3gc;
 
-  Grid(int nX, int nY, int nZ);
-
-  void calc_sza(Planets planet, Times time, Report &report);
-  void fill_grid(Planets planet, Report &report);
-  void fill_grid_radius(Planets planet, Report &report);
-  void init_geo_grid(Planets planet, Inputs input, Report &report);
-  void fill_grid_bfield(Planets planet, Inputs input, Report &report);
+  Grid(int nLons, int nLats, int nAlts, int nGCs, Arena &arena);
+  Grid(grid_extents extents_in, Arena &arena);
+
+  // The fields belong to the arena, so a copy would just be a second
+  // set of pointers.  Pass a reference instead:
+  Grid(const Grid &) = delete;
+  Grid &operator=(const Grid &) = delete;
+
+  void calc_sza(Planets &planet,
+		const Times &time,
+		Workers &workers,
+		Report &report,
+		float dt_ahead = 0.0);
+  // calc_sza in two pieces: where the sun is (for all of the columns),
+  // and the SZA of the columns of a tile (see Neutrals, #column_fusion):
+  struct sun_struct {
+    float lon_offset;
+    float sin_dec;
+    float cos_dec;
+  };
+  sun_struct calc_sun(Planets &planet,
+		      const Times &time,
+		      float dt_ahead = 0.0) const;
+  void calc_sza_columns(const sun_struct &sun, const tile_struct &tile);
+  void fill_grid(const Planets &planet, Report &report);
+  void fill_column_geometry(const Planets &planet, Arena &arena, Report &report);
+  void init_geo_grid(const Planets &planet,
+		     const Inputs &input,
+		     Arena &arena,
+		     Report &report);
+  void fill_grid_bfield(const Planets &planet,
+			const Inputs &input,
+			Report &report);
 
  private:
 
+  int calc_stretched_altitudes(const Planets &planet,
+			       const Inputs &input,
+			       std::vector<float> &altitudes,
+			       Report &report);
+  int read_altitude_file(const std::string &alt_file,
+			 std::vector<float> &altitudes,
+			 Report &report);
+
   int IsGeoGrid;
 
 };
@@ -15,10 +15,12 @@ class Indices {
 
   // Public Functions:
 
-  Indices(Inputs args);
+  Indices(const Inputs &args);
+  Indices(const Indices &) = delete;
+  Indices &operator=(const Indices &) = delete;
 
-  float get_f107(double time);
-  float get_f107a(double time);
+  float get_f107(double time) const;
+  float get_f107a(double time) const;
 
  private:
 
@@ -33,14 +35,15 @@ class Indices {
   std::vector<ind_time_pair> f107a;
 
   // This is the method for setting f107 specifically:
-  int set_f107(std::vector<double> time, std::vector<float> f107array);
+  int set_f107(const std::vector<double> &time,
+	       const std::vector<float> &f107array);
 
   // This is the general method for setting indices:
-  int set_index(std::vector<double> time,
-		std::vector<float> indexarray,
+  int set_index(const std::vector<double> &time,
+		const std::vector<float> &indexarray,
 		std::vector<ind_time_pair> &index);
 
-  float get_index(double time, std::vector<ind_time_pair> index);
+  float get_index(double time, const std::vector<ind_time_pair> &index) const;
 
 };
 
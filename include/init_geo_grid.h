@@ -8,7 +8,7 @@
 #include "planets.h"
 #include "grid.h"
 
-void init_geo_grid(Grid &gGrid, Planets planet, Inputs input);
+void init_geo_grid(Grid &gGrid, const Planets &planet, const Inputs &input);
 
 #endif // AETHER_INCLUDE_INIT_GEO_GRID_H_
 
@@ -15,27 +15,53 @@ class Inputs {
 public:
 
   Inputs(Times &time, Report &report);
+
+  // This is passed around everywhere, so make sure that it is never
+  // copied by accident (pass a const reference):
+  Inputs(const Inputs &) = delete;
+  Inputs &operator=(const Inputs &) = delete;
+
   int read(Times &time, Report &report);
-  int get_verbose();
-  float get_dt_euv();
-  float get_n_outputs();
-  float get_dt_output(int iOutput);
-  std::string get_type_output(int iOutput);
-  float get_euv_heating_eff_neutrals();
-  std::string get_euv_model();
-  std::string get_euv_file();
-  std::string get_chemistry_file();
-  std::string get_f107_file();
-  std::string get_planet();
-  std::string get_planetary_file();
-  std::string get_planet_species_file();
-  std::string get_bfield_type();
+
+  // 0 if the input file couldn't be read or had an issue, so the
+  // model shouldn't run.  An option with an issue is printed (with
+  // what it should be) and set back to its default:
+  int is_ok() const;
+  int get_verbose() const;
+  float get_dt_euv() const;
+  std::string get_euv_interpolation() const;
+  float get_n_outputs() const;
+  float get_dt_output(int iOutput) const;
+  std::string get_type_output(int iOutput) const;
+  float get_euv_heating_eff_neutrals() const;
+  std::string get_euv_model() const;
+  std::string get_euv_spectrum_file() const;
+  int get_euv_bins() const;
+  float get_euv_bins_max_error() const;
+  std::string get_euv_file() const;
+  std::string get_chemistry_file() const;
+  std::string get_f107_file() const;
+  std::string get_planet() const;
+  std::string get_planetary_file() const;
+  std::string get_planet_species_file() const;
+  std::string get_bfield_type() const;
+  int get_use_huge_pages() const;
+  std::string get_species_layout() const;
+  int get_nThreads() const;
+  int get_column_fusion() const;
+  std::string get_thermal_conduction() const;
+  std::string get_chapman() const;
   
   // ------------------------------
   // Grid inputs:
 
   struct grid_input_struct {
 
+    // Number of cells (not including ghost cells) in each direction:
+    int nLons;
+    int nLats;
+    int nAlts;
+
     std::string alt_file;
     int IsUniformAlt;
     float alt_min;
@@ -47,24 +73,90 @@ public:
     float lon_max;
   };
 
-  grid_input_struct get_grid_inputs(); 
+  grid_input_struct get_grid_inputs() const; 
+
+  // ------------------------------
+  // Time step inputs (see Times::calc_dt).  If dt_min and dt_max are
+  // the same, that is the time step.  Otherwise, each step is as long
+  // as the limits below let it be (a limit of 0 is turned off):
+
+  struct dt_input_struct {
+
+    float dt_min;
+    float dt_max;
+
+    // Sound speed CFL number (in the vertical):
+    float cfl;
+    // The most that kappa * dt / (rho * cv * dz^2) can be:
+    float diffusion_number;
+    // The most that a species can change (as a fraction) in a step,
+    // where the chemistry is explicit:
+    float chemistry_change;
+  };
+
+  dt_input_struct get_dt_inputs() const;
+
+  // ------------------------------
+  // How often the processes in a step run (see Scheduler).  The EUV
+  // is set with #euv, and the outputs with #output:
+
+  struct schedule_input_struct {
+    std::string process;
+    float cadence;
+    int max_subcycles;
+  };
+
+  std::vector<schedule_input_struct> get_schedule_inputs() const;
   
   int iVerbose;
 
 private:
 
+  int IsOk = 0;
+
   std::string euv_file = "UA/inputs/euv.csv";
   std::string chemistry_file = "UA/inputs/chemistry_earth.csv";
   std::string input_file = "aether.in";
   std::string euv_model = "euvac";
+  // The spectra for #euv_model file (see spectrum_file.h):
+  std::string euv_spectrum_file = "";
+  // How many bins to merge the wavelengths into (0 is all of them),
+  // and how far the heating or ionization can be off (see
+  // Neutrals::merge_euv_bins):
+  int euv_bins = 0;
+  float euv_bins_max_error = 0.05;
   std::string planetary_file = "UA/inputs/orbits.csv";
   std::string planet = "earth";
   std::string f107_file = "";
   std::string planet_species_file = "";
 
   std::string bfield = "none";
+
+  int UseHugePages = 0;
+
+  // How the per-species fields are stored (see arena.h):
+  std::string species_layout = "separate";
+
+  // Number of worker threads that split up the geo grid (see workers.h):
+  int nThreads = 1;
+
+  // The number of columns (next to each other in lat) that each stage
+  // of a step is done on before going on to the next stage, with all
+  // of the stages done on those columns before the next ones (see
+  // advance).  0 does each stage on the whole grid:
+  int nFusedColumns = 0;
+
+  // How T^thermal_exp is done in the thermal conduction (see
+  // Neutrals::calc_thermodynamics): pow, fast or table:
+  std::string thermal_conduction = "fast";
+
+  // How the dayside chapman integrals are done (see
+  // Neutrals::calc_chapman): exact or table:
+  std::string chapman = "exact";
   
   grid_input_struct grid_input;
+  dt_input_struct dt_input;
+  std::vector<schedule_input_struct> schedule_input;
   
   float euv_heating_eff_neutrals;
   float euv_heating_eff_electrons;
@@ -73,6 +165,10 @@ private:
   std::vector<std::string> type_output;
   float dt_euv;
 
+  // What the EUV sources do between the updates every dt_euv (see
+  // calc_euv): hold (stay the same) or interpolate:
+  std::string euv_interpolation = "hold";
+
 };
 
 #endif // AETHER_INCLUDE_INPUTS_H_
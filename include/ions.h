@@ -7,6 +7,7 @@
 #include "inputs.h"
 #include "report.h"
 #include "grid.h"
+#include "arena.h"
 
 class Ions {
 
@@ -19,8 +20,13 @@ class Ions {
     int charge;
     
     int DoAdvect;
-    
+
+    // The species densities are allocated together, so use
+    // density(index), which knows the stride:
     float *density_s3gc;
+    long stride;
+    float &density(long index) const { return density_s3gc[index * stride]; }
+
     float *par_velocity_v3gc;
     float *perp_velocity_v3gc;
 
@@ -32,6 +38,9 @@ class Ions {
     
   };
 
+  // Size of the (geographic) grid that the ions live on:
+  grid_extents extents;
+
   // bulk quantities (states):
   float *density_s3gc;
   float *velocity_v3gc;
@@ -40,14 +49,21 @@ class Ions {
   float *electron_temperature_s3gc;
 
   std::vector<species_chars> species;
+
+  // Stride between grid points in the species densities:
+  long species_stride;
   
   // ------------------------------
   // Functions:
   
-  Ions(Inputs input, Report report);
-  species_chars create_species();
-  int read_planet_file(Inputs input, Report report);
-  void fill_electrons(Grid grid, Report &report);
+  Ions(const Grid &grid, Arena &arena, const Inputs &input, Report &report);
+  Ions(const Ions &) = delete;
+  Ions &operator=(const Ions &) = delete;
+  species_chars create_species(Arena &arena, float *density_s3gc);
+  int read_planet_file(const Inputs &input, Report &report);
+  void fill_electrons(const Grid &grid, Report &report);
+  void fill_electrons_columns(const tile_struct &tile);
+  void fill_electrons_points(long iStart, long iEnd);
 
 };
 #endif // AETHER_INCLUDE_NEUTRALS_H_
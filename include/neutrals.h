@@ -4,13 +4,143 @@
 #ifndef AETHER_INCLUDE_NEUTRALS_H_
 #define AETHER_INCLUDE_NEUTRALS_H_
 
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "constants.h"
+#include "fast_math.h"
 #include "grid.h"
+#include "arena.h"
 #include "euv.h"
 #include "time.h"
 #include "ions.h"
 #include "inputs.h"
 #include "report.h"
 
+// erfc(y) exp(y^2), as fit by Eqn (12) Smith & Smith (JGR 1972,
+// vol. 77, page 3592):
+inline double chapman_erfc(double y) {
+  const double a = 1.06069630;
+  const double b = 0.55643831;
+  const double c = 1.06198960;
+  const double d = 1.72456090;
+  const double f = 0.56498823;
+  const double g = 0.06651874;
+  return (y < 8) ? (a + b*y) / (c + d*y + y*y) : f / (g + y);
+}
+
+// The dayside chapman function Ch(X, sza), with X = r/H, so the
+// slant column is Ch * (the vertical column):
+inline double chapman_dayside(double xp, double cos_sza) {
+  double y = sqrt(0.5 * xp) * fabs(cos_sza);
+  return sqrt(0.5 * pi * xp) * chapman_erfc(y);
+}
+
+// -----------------------------------------------------------------------------
+// Ch(X, sza) on the dayside, in a table, for #chapman table.  Near the
+// terminator, Ch goes like 1 / cos(sza), so the rows are even steps in
+// log(cos(sza)), from cos(sza) = 1e-4 to 1 (the row only has to be
+// found once per column).  X goes from 1 to 2^16, with nPerOctave
+// even steps between each power of 2, so the place in a row comes
+// from the bits of X (no log).  It is made once (see the Neutrals
+// constructor) and then only read, so all of the threads share it.
+//
+// Bilinear interpolation is good to ~4e-5, except in the cells that
+// straddle y = 8, where the fit (chapman_erfc) itself jumps by 2e-3,
+// which is about max_relative_error().  Remember that the EUV goes
+// like exp(-tau), so this gets multiplied by tau deep down!
+// -----------------------------------------------------------------------------
+
+class ChapmanTable {
+
+ public:
+
+  static const long nOctaves = 16;
+  static const long nPerOctave = 32;
+  static const long nXps = nOctaves * nPerOctave + 1;
+  static const long nMus = 513;
+
+  void build();
+  double max_relative_error() const;
+
+  // X has to be in the table, or use chapman_dayside:
+  bool covers(double xp) const { return xp >= 1.0 && xp < 65536.0; }
+
+  // The row (iMu) and weight of cos(sza), which is the same for a
+  // whole column.  Columns too close to the terminator aren't in the
+  // table (false, with the first row), so they have to use
+  // chapman_dayside:
+  bool find_mu(double cos_sza, long &iMu, double &weight) const {
+    double mu = fabs(cos_sza);
+    iMu = 0;
+    weight = 0.0;
+    if (mu < mu_min) return false;
+    double position = (log(mu) - log_mu_min) / dlog_mu;
+    iMu = std::min(long(position), nMus - 2);
+    weight = position - iMu;
+    return true;
+  }
+
+  double lookup(double xp, long iMu, double weight) const {
+    // xp = 2^iExp * m, with 1 <= m < 2:
+    uint64_t bits = double_to_bits(xp);
+    long iExp = long(bits >> 52) - 1023;
+    double m = bits_to_double((bits & 0x000fffffffffffffULL) |
+			      0x3ff0000000000000ULL);
+    double position = (iExp + m - 1.0) * nPerOctave;
+    long iXp = long(position);
+    double w = position - iXp;
+    const float *row = values.data() + iMu * nXps + iXp;
+    double lower = row[0] + w * (row[1] - row[0]);
+    double upper = row[nXps] + w * (row[nXps + 1] - row[nXps]);
+    return lower + weight * (upper - lower);
+  }
+
+ private:
+
+  double mu_min = 1.0e-4;
+  double log_mu_min = log(mu_min);
+  double dlog_mu = -log_mu_min / (nMus - 1);
+  // [iMu][iXp]:
+  std::vector<float> values;
+
+  double mu_of(long iMu) const {
+    return exp(log_mu_min + iMu * dlog_mu);
+  }
+
+  double xp_of(long iXp) const {
+    return ldexp(1.0 + double(iXp % nPerOctave) / nPerOctave,
+		 iXp / nPerOctave);
+  }
+
+};
+
+// -----------------------------------------------------------------------------
+// The EUV wavelengths in one column, to merge into fewer bins (see
+// merge_euv_waves and Neutrals::merge_euv_bins).  Per wavelength: the
+// intensity at the top, and the cross section of each absorber
+// [iWave][iAbsorber] and each rate [iWave][iRate] (the first nAbsorbers
+// rates are the heating, the rest are the ionizations).  Per altitude,
+// going up: the vertical column of each absorber above it
+// [iAbsorber][iZ], and the density that goes with each rate
+// [iRate][iZ].  merge_euv_waves fills in the rest: the wavelengths
+// in each bin, the cross sections [iBin][iAbsorber] and rates
+// [iBin][iRate] of the bins, and the worst errors that they make.
+// -----------------------------------------------------------------------------
+
+struct euv_merge_struct {
+  long nWaves, nAbsorbers, nRates, nZ;
+  std::vector<double> intensity, sigma, rates;
+  std::vector<double> column, density_rate;
+
+  std::vector<std::vector<long>> bins;
+  std::vector<double> bin_sigma, bin_rates;
+  double heating_error, ionization_error;
+};
+
+void merge_euv_waves(euv_merge_struct &merge, int nBins, float max_error);
+
 class Neutrals {
 
  public:
@@ -22,8 +152,16 @@ class Neutrals {
     float vibe;
 
     int DoAdvect;
-    
+
+    // All of the species densities (and chapman integrals) are
+    // allocated together (see Arena::allocate_species), so the value
+    // at a grid point (index) is at density_s3gc[index * stride].
+    // Use density(index) and chapman(index) to get at them:
     float *density_s3gc;
+    long stride;
+    float &density(long index) const { return density_s3gc[index * stride]; }
+    float &chapman(long index) const { return chapman_s3gc[index * stride]; }
+
     float *velocity_v3gc;
 
     std::vector<float> diff0;
@@ -32,6 +170,7 @@ class Neutrals {
 
     float thermal_cond;
     float thermal_exp;
+    int iThermalExpGroup;  // see thermal_exp_groups
 
     int iEuvAbsId_;
     int nEuvIonSpecies;
@@ -50,6 +189,9 @@ class Neutrals {
     
   };
   
+  // Size of the (geographic) grid that the neutrals live on:
+  grid_extents extents;
+
   // bulk quantities (states):
   float *density_s3gc;
   float *velocity_v3gc;
@@ -64,9 +206,14 @@ class Neutrals {
   float *Cv_s3gc;
   float *gamma_s3gc;
   float *kappa_s3gc;
+  float *rho_cv_s3gc;
 
   std::vector<species_chars> neutrals;
 
+  // Stride between grid points in the species fields (1, unless the
+  // species are interleaved):
+  long species_stride;
+
   float max_chapman = 1.0e26;
 
   // Source terms:
@@ -74,11 +221,126 @@ class Neutrals {
   float *heating_euv_s3gc;
   float *conduction_s3gc;
 
+  // Per-thread work space for calc_conduction (see solver_conduction_batch):
+  std::vector<float> conduction_scratch;
+
+  // and the smallest dt limit that each thread found:
+  std::vector<float> dt_limit_scratch;
+
+  // and for calc_chapman:
+  std::vector<double> chapman_scratch;
+  std::vector<long> chapman_below_scratch;
+
+  // The species that absorb EUV (iEuvAbsId_ > -1, see pair_euv):
+  std::vector<int> absorbers;
+
+  // pair_euv also packs the cross sections into dense [iWave][i]
+  // matrices, so that the optical depths and the rates in a column are
+  // small matrix products (see calc_ionization_heating):
+  long nEuvWaves = 0;
+  // The absorption cross sections of the absorbers, [iWave][iAbsorber]:
+  std::vector<float> euv_absorption;
+  // What each wavelength's intensity gives, [iWave][iRate]: first the
+  // heating by each absorber (energy * absorption cross section), then
+  // each of the ionizations (ionization cross section).  Each rate is
+  // in units of its biggest value (euv_rate_units), so that it is ~1,
+  // and the products with the intensities don't go denormal:
+  std::vector<float> euv_rates;
+  std::vector<double> euv_rate_units;
+  long nEuvRates = 0;
+  // The neutral that is ionized, and the ion that is made, for each
+  // of the ionizations:
+  std::vector<int> ionization_neutral, ionization_ion;
+
+  // With #euv_bins, the wavelengths are merged into fewer bins (see
+  // merge_euv_bins), and then the [iWave] above is the bin.  The bin
+  // of each wavelength, and the intensity in each bin at the top:
+  std::vector<long> euv_bin_of_wave;
+  std::vector<float> euv_bin_intensity;
+  // The intensity at the top for this update (per [iWave], see
+  // prepare_ionization_heating):
+  const float *euv_intensity_top = NULL;
+
+  // Per-thread columns for calc_ionization_heating (the chapman
+  // integrals, the intensities and the rates), and where each
+  // wavelength is cut off:
+  std::vector<float> euv_scratch;
+  std::vector<long> euv_cut_scratch;
+
+  // Below an optical depth of euv_tau_max (exp(-80) = 2e-35), the EUV
+  // intensity is taken to be 0:
+  float euv_tau_max = 80.0;
+
+  // For each column (Field2D order), calc_chapman finds the lowest
+  // altitude that can see the sun (nAltsG if none of them can, which
+  // is in the shadow of the planet), and how much work the column is
+  // for calc_ionization_heating (which goes to the workers, so the
+  // threads get the same amount of sunlit columns):
+  std::vector<long> euv_first_lit;
+  std::vector<float> euv_column_costs;
+
+  // calc_ionization_heating also keeps the lowest altitude in each
+  // column with any EUV sources (nAltsG if there are none):
+  std::vector<long> euv_column_bottom;
+
+  // With #euv interpolate, calc_euv keeps two sets of the EUV sources:
+  // the ones for where the sun was at the last update, and the ones
+  // for where it will be at the next.  Each step goes between the two
+  // in time.  Only the fields that the EUV makes something in are
+  // kept (euv_source_fields, [iField][point]: the heating, the neutrals
+  // that are ionized, and the ions that are made):
+  struct euv_sources_struct {
+    double time = -1.0;
+    std::vector<float> fields;
+    std::vector<long> bottom;
+  };
+  std::string euv_interpolation;
+  std::vector<float *> euv_source_fields;
+  euv_sources_struct euv_sources_then, euv_sources_next;
+
+  // The thermal conduction is sum(N * thermal_cond * T^thermal_exp),
+  // but there are only a few different thermal_exps, so the species
+  // are put into groups with the same thermal_exp, and T^thermal_exp
+  // is done once for each group:
+  struct thermal_exp_group {
+    float thermal_exp;
+    std::vector<int> species;
+    // With #thermal_conduction table, T^thermal_exp at
+    // table_temperature_min + i * table_dtemperature:
+    std::vector<double> table;
+  };
+  std::vector<thermal_exp_group> thermal_exp_groups;
+  std::string thermal_conduction_method;
+
+  // exact or table (#chapman):
+  std::string chapman_method;
+  ChapmanTable chapman_table;
+
+  // Linear interpolation of T^p (0 < p < 1) is off by at most
+  // p (1-p) / 8 * (dT / T)^2, which is < 3e-6 at 100 K.  Columns
+  // with temperatures outside of the table use fast_pow:
+  float table_temperature_min = 100.0;
+  float table_dtemperature = 1.0;
+  long nTable_temperatures = 4901;
+
+  // T^thermal_exp in a column for each group, for each thread:
+  std::vector<double> thermodynamics_scratch;
+
+  // Anything that changes the species densities or the temperature
+  // has to call state_changed(), so that calc_thermodynamics knows
+  // that it has to do something:
+  long iStateVersion = 1;
+  long iThermodynamicsVersion = 0;
+  void state_changed() { iStateVersion++; }
+  int needs_thermodynamics() const {
+    return iThermodynamicsVersion != iStateVersion;
+  }
+
   float heating_efficiency;
   
   // This is an initial temperature profile, read in through the
   // planet.in file:
-  float *initial_temperatures, *initial_altitudes;
+  std::vector<float> initial_temperatures, initial_altitudes;
   int nInitial_temps=0;
 
   // names and units
@@ -94,22 +356,104 @@ class Neutrals {
   // ------------------------------
   // Functions:
   
-  Neutrals(Grid grid, Inputs input, Report report);
-  species_chars create_species();
-  int read_planet_file(Inputs input, Report report);
-  int initial_conditions(Grid grid, Inputs input, Report report);
+  Neutrals(const Grid &grid, Arena &arena, const Inputs &input, Report &report);
+  Neutrals(const Neutrals &) = delete;
+  Neutrals &operator=(const Neutrals &) = delete;
+  species_chars create_species(Arena &arena,
+			       float *density_s3gc,
+			       float *chapman_s3gc);
+  int read_planet_file(const Inputs &input, Report &report);
+  void group_thermal_exps(const Inputs &input, Report &report);
+  int initial_conditions(const Grid &grid, const Inputs &input, Report &report);
   float calc_scale_height(int iSpecies,
 			  long index,
-			  Grid grid);
-  int pair_euv(Euv euv, Ions ions, Report report);
-  void calc_mass_density(Report &report);
-  void calc_specific_heat(Report &report);
-  void calc_chapman(Grid grid, Report &report);
-  void calc_ionization_heating(Euv euv, Ions &ions, Report &report);
-  void calc_conduction(Grid grid, Times time, Report &report);
-  void add_sources(Times time, Report &report);
+			  float gravity);
+  int pair_euv(const Euv &euv, const Ions &ions, Report &report);
+  void set_euv_rates(const std::vector<double> &rates);
+  int merge_euv_bins(const Euv &euv,
+		     const Grid &grid,
+		     int nBins,
+		     float max_error,
+		     Report &report);
+  // Each stage of a step below is done on the whole grid by the
+  // workers, or (with #column_fusion, see advance) a few columns at a
+  // time, with all of the stages done on those columns before going
+  // on.  For that, each stage is split into prepare_ (once, for the
+  // step), _columns (on the columns of a tile, by thread iThread) and
+  // finish_ (once, after all of the columns), and the stage itself
+  // just calls them.
+  void calc_thermodynamics(Workers &workers, Report &report);
+  void prepare_thermodynamics(int nThreads);
+  void calc_thermodynamics_columns(const tile_struct &tile, int iThread);
+  void calc_chapman(const Grid &grid, Workers &workers, Report &report);
+  void prepare_chapman(int nThreads);
+  void calc_chapman_columns(const Grid &grid,
+			    const tile_struct &tile,
+			    int iThread,
+			    Report &report);
+  void calc_ionization_heating(const Euv &euv,
+			       Ions &ions,
+			       Workers &workers,
+			       Report &report);
+  void prepare_ionization_heating(const Euv &euv, int nThreads);
+  void calc_ionization_heating_columns(Ions &ions,
+				       const tile_struct &tile,
+				       int iThread,
+				       Report &report);
+  void save_euv_sources(euv_sources_struct &sources,
+			double time_of_sources,
+			Workers &workers);
+  void save_euv_sources_columns(euv_sources_struct &sources,
+				const tile_struct &tile);
+  void interpolate_euv_sources(const Times &time,
+			       Workers &workers,
+			       Report &report);
+  float get_euv_weight(const Times &time) const;
+  void interpolate_euv_sources_columns(float weight, const tile_struct &tile);
+  // The dT/dt of an implicit conduction step of dt (which is held
+  // between runs, see Scheduler):
+  void calc_conduction(const Grid &grid,
+		       float dt,
+		       Workers &workers,
+		       Report &report);
+  void prepare_conduction(int nThreads);
+  void calc_conduction_columns(const Grid &grid,
+			       float dt,
+			       const tile_struct &tile,
+			       int iThread,
+			       Report &report);
+  // The largest dt that the conduction and the sound speed allow on
+  // this processor (see Inputs::dt_input_struct):
+  float calc_dt_limit(const Grid &grid,
+		      float cfl,
+		      float diffusion_number,
+		      Workers &workers,
+		      Report &report);
+  void prepare_dt_limit(int nThreads);
+  void calc_dt_limit_columns(const Grid &grid,
+			     float cfl,
+			     float diffusion_number,
+			     const tile_struct &tile,
+			     int iThread);
+  float finish_dt_limit() const;
+  void add_sources(float dt, Workers &workers, Report &report);
+  void add_sources_columns(float dt, const tile_struct &tile);
   
 };
+
+// On the nightside, the path to the sun from radius[iAlt] goes down to
+// a tangent point before it comes back up.  This finds the altitude
+// just below the tangent point (iBelow, or -1 if the path goes into
+// the planet), and how far above that altitude the tangent point is
+// (dy), for each altitude from nGCs up.  The tangent point only goes
+// up as the altitude goes up, so this is one sweep up the column,
+// which is O(nAlts) (walking down from each altitude is O(nAlts^2)):
+void calc_tangent_points(const float *radius,
+			 float sza,
+			 long nGCs,
+			 long nAlts,
+			 long *iBelow,
+			 double *dy);
   
 
 
@@ -10,13 +10,15 @@
 #include "../include/planets.h"
 #include "../include/inputs.h"
 #include "../include/report.h"
+#include "../include/parallel.h"
 
-int output(Neutrals neutrals,
-	   Ions ions,
-	   Grid grid,
-	   Times time,
-	   Planets planet,
-	   Inputs args,
+int output(const Neutrals &neutrals,
+	   const Ions &ions,
+	   const Grid &grid,
+	   const Times &time,
+	   const Planets &planet,
+	   const Inputs &args,
+	   Parallel &parallel,
 	   Report &report);
 
 
@@ -0,0 +1,131 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#ifndef AETHER_INCLUDE_PARALLEL_H_
+#define AETHER_INCLUDE_PARALLEL_H_
+
+#include <vector>
+
+#ifdef AETHER_USE_MPI
+#include <mpi.h>
+#endif
+
+#include "sizes.h"
+#include "inputs.h"
+#include "report.h"
+
+// -----------------------------------------------------------------------------
+// With MPI (make MPI=1), the geo grid is cut into lon/lat blocks, one
+// per process, and each process only has its own block (plus the
+// nGeoGhosts halo around it).  The halo cells that are inside of the
+// whole grid belong to the neighboring blocks, so they are filled by
+// sending the edges of each block to its neighbors.  The halo cells
+// at the edges of the whole grid are filled in by each process, just
+// like they are without MPI.
+//
+// The exchange doesn't wait: start_halo_exchange sends the edges and
+// returns, so the model can keep working on the interior, and
+// finish_halo_exchange waits for the neighbors and fills in the halo.
+// Fields are exchanged in groups (e.g., all of the densities), since
+// they are done at different times in a step.
+//
+// Without MPI, there is one process with the whole grid, and all of
+// this does nothing.  Run with, e.g., mpirun -np 4 ./aether.exe
+// -----------------------------------------------------------------------------
+
+class Parallel {
+
+ public:
+
+  // The groups of fields that are exchanged together:
+  static const int temperature_halo = 0;
+  static const int density_halo = 1;
+  static const int nHaloGroups = 2;
+
+  Parallel(Report &report);
+  ~Parallel();
+
+  // MPI can only be set up once, so this can't be copied:
+  Parallel(const Parallel &) = delete;
+  Parallel &operator=(const Parallel &) = delete;
+
+  // Cut the whole grid into blocks and return the extents of the block
+  // that this process owns:
+  grid_extents decompose(Inputs::grid_input_struct grid_input,
+			 long nGCs,
+			 Report &report,
+			 int &iErr);
+
+  // Add a field (or one species in a set of species, see arena.h) to a
+  // halo group.  The field has to be the size of the block:
+  void add_halo_field(int iGroup, float *field, long stride = 1);
+  void start_halo_exchange(int iGroup, Report &report);
+  void finish_halo_exchange(int iGroup, Report &report);
+
+  // These are over all of the processes, and every process gets the
+  // answer:
+  double sum(double value);
+  double max(double value);
+  double min(double value);
+
+  // Put a 3D field from all of the blocks together into the whole grid
+  // (with ghost cells) on the root process.  Every process has to call
+  // this.  On the root, this returns the whole field (which may be in
+  // global_s3gc), and on the other processes it returns nullptr:
+  float *gather_s3gc(float *field_s3gc,
+		     const grid_extents &extents,
+		     std::vector<float> &global_s3gc);
+
+  // Timing summary over all of the processes (on the root):
+  void times(Report &report);
+
+  int get_iRank();
+  int get_nRanks();
+  int is_root();
+  grid_extents get_global_extents();
+
+ private:
+
+  // The neighbors, in this order.  Each direction is next to its
+  // opposite, so the opposite of iDirection is iDirection ^ 1:
+  static const int iWest_ = 0;
+  static const int iEast_ = 1;
+  static const int iSouth_ = 2;
+  static const int iNorth_ = 3;
+  static const int nDirections = 4;
+
+  int iRank, nRanks;
+  long nRanksLon, nRanksLat;
+  long iRankLon, iRankLat;
+  grid_extents global_extents;
+  grid_extents block_extents;
+
+  // -1 if there is no neighbor (the edge of the whole grid):
+  int neighbors[nDirections];
+
+  struct halo_field_struct {
+    float *field;
+    long stride;
+  };
+
+  struct halo_group_struct {
+    std::vector<halo_field_struct> fields;
+    std::vector<float> send_buffers[nDirections];
+    std::vector<float> receive_buffers[nDirections];
+    int IsExchanging;
+#ifdef AETHER_USE_MPI
+    std::vector<MPI_Request> requests;
+#endif
+  };
+
+  halo_group_struct halo_groups[nHaloGroups];
+
+  grid_extents block_of_rank(long iRankLon_in, long iRankLat_in);
+  void slab(int iDirection, int IsHalo,
+	    long &iLonStart, long &iLonEnd,
+	    long &iLatStart, long &iLatEnd);
+  void copy_slab(halo_group_struct &group, int iDirection, int IsHalo);
+
+};
+
+#endif // AETHER_INCLUDE_PARALLEL_H_
@@ -13,25 +13,29 @@
 class Planets {
 
  public:
-  Planets(Inputs args, Report report);
-  float get_star_to_planet_dist(Times time);
-  float get_orbit_angle(Times time);
-  float get_declination(Times time);
-  float get_mu();
-  float get_radius(float latitude);
-  float get_longitude_offset(Times time);
-  float get_sin_dec(Times time);
-  float get_cos_dec(Times time);
-
-  std::vector<float> get_dipole_center();
-  float get_dipole_rotation();
-  float get_dipole_tilt();
-  float get_dipole_strength();
+  Planets(const Inputs &args, Report &report);
+  Planets(const Planets &) = delete;
+  Planets &operator=(const Planets &) = delete;
+
+  float get_star_to_planet_dist(const Times &time);
+  float get_orbit_angle(const Times &time);
+  float get_declination(const Times &time);
+  float get_mu() const;
+  float get_radius(float latitude) const;
+  float get_longitude_offset(const Times &time);
+  float get_sin_dec(const Times &time);
+  float get_cos_dec(const Times &time);
+  float get_length_of_day() const;
+
+  std::vector<float> get_dipole_center() const;
+  float get_dipole_rotation() const;
+  float get_dipole_tilt() const;
+  float get_dipole_strength() const;
   
  private:
 
-  int set_planet(Inputs args, Report report);
-  int update(Times time);
+  int set_planet(const Inputs &args, Report &report);
+  int update(const Times &time);
 
   struct planet_chars {
 
@@ -88,7 +92,7 @@ class Planets {
 
   planet_chars planet;
 
-  int read_file(Inputs args, Report report);
+  int read_file(const Inputs &args, Report &report);
 
 };
 
@@ -14,17 +14,41 @@ public:
   // Functions:
 
   Report();
+
+  // The timings are kept in here, so there should only be one:
+  Report(const Report &) = delete;
+  Report &operator=(const Report &) = delete;
+
   void set_verbose(int input);
-  void print(int iLevel, std::string output_string);
+  void print(int iLevel, const std::string &output_string);
   int test_verbose(int iLevel);
   int get_verbose();
-  void enter(std::string, int &iFunction);
-  void exit(std::string);
+  void enter(const std::string &input, int &iFunction);
+  void exit(const std::string &input);
   void times();
+
+  // A line to print under an entry in the timing summary (e.g., how
+  // often it runs, see Scheduler::add_notes).  iFunction is from enter:
+  void set_note(int iFunction, const std::string &note);
+
+  // About how many bytes an entry moves through memory each time it
+  // is called (e.g., calc_step_traffic), so that the timing summary
+  // can give the time per call and the bandwidth that goes with it:
+  void set_nBytes(int iFunction, double nBytes);
+
+  // With MPI, only the root process (iRank = 0) prints anything, and
+  // the timings can be put together over all of the processes (see
+  // Parallel::times):
+  void set_iRank(int iRank_in);
+  std::vector<float> get_timings();
+  void times(std::vector<float> timing_max,
+	     std::vector<float> timing_mean,
+	     int nProcesses);
   
 private:
 
   int iVerbose;  
+  int iRank;
   
   struct item_struct {
 
@@ -35,6 +59,8 @@ private:
     int iLevel;
     int iStringPosBefore;
     int iLastEntry;
+    std::string note;
+    double nBytes;
 
   };
   
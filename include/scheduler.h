@@ -0,0 +1,98 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#ifndef AETHER_INCLUDE_SCHEDULER_H_
+#define AETHER_INCLUDE_SCHEDULER_H_
+
+#include <string>
+
+#include "times.h"
+#include "report.h"
+
+// -----------------------------------------------------------------------------
+// The scheduler says when each process in a step (see advance) runs,
+// and how long a step it takes when it does.  Each process has a
+// cadence (in s), and runs on the first step and then once every
+// cadence (0 is every step).  There are two kinds of processes:
+//
+//   - Ones that make rates (SZA, EUV, conduction) hold them between
+//     the times that they run.  Conduction is implicit, so it is done
+//     over the cadence, since that is how long its rate is used for.
+//
+//   - Ones that integrate (sources, chemistry) catch up on all of the
+//     time since they last ran, so nothing is lost.  They always run
+//     on the step that reaches the intermediate time (and the end).
+//
+// A process can also take up to max_subcycles sub-steps each time it
+// runs (only the chemistry does this), so a stiff process doesn't
+// drag the whole time step down.  It takes as few as it can, given the
+// longest sub-step that it said it can take (get_nSubcycles).
+//
+// Each process is timed as its own entry in the Report, and the
+// cadence and number of runs are put next to it (notes), so they show
+// up in the timing summary.  Everything runs every step by default.
+// -----------------------------------------------------------------------------
+
+class Scheduler {
+
+ public:
+
+  static const int sza_process = 0;
+  static const int euv_process = 1;
+  static const int conduction_process = 2;
+  static const int sources_process = 3;
+  static const int chemistry_process = 4;
+  static const int output_process = 5;
+  static const int nProcesses = 6;
+
+  Scheduler();
+
+  // The process called name (as in #schedule), or -1 if there isn't one:
+  int find_process(const std::string &name) const;
+  void set_process(int iProcess, float cadence, int max_subcycles);
+
+  // 1 if the process runs in this step (after Times::calc_dt):
+  int is_due(int iProcess, const Times &time);
+
+  // How long a step the process takes when it runs in this step:
+  float get_dt(int iProcess, const Times &time) const;
+
+  // The number of sub-steps to take dt in, when the longest sub-step
+  // that the process can take is dt_limit:
+  int get_nSubcycles(int iProcess, float dt, float dt_limit) const;
+
+  // The longest time step the model can take, when the longest
+  // sub-step the process can take is dt_limit.  Processes with a
+  // cadence don't limit it, since they take their own steps:
+  float get_dt_limit(int iProcess, float dt_limit) const;
+
+  // Time the process (as its own Report entry), and when it is done,
+  // remember that it has done this step (in nSubcycles sub-steps):
+  void start(int iProcess, Report &report);
+  void stop(int iProcess, const Times &time, int nSubcycles, Report &report);
+  // The same as stop, for a process that isn't timed by itself (since
+  // it is mixed in with the others, see #column_fusion):
+  void done(int iProcess, const Times &time, int nSubcycles);
+
+  // Put the cadences and runs in the Report (for the timing summary):
+  void add_notes(Report &report) const;
+
+ private:
+
+  std::string names[nProcesses];
+  int IsIntegrator[nProcesses];
+  float cadence[nProcesses];
+  int max_subcycles[nProcesses];
+
+  // When the process runs next (-1 is the first step), and where it
+  // has integrated to:
+  double next_run[nProcesses];
+  double done_to[nProcesses];
+
+  long nRuns[nProcesses];
+  long nSubcyclesTotal[nProcesses];
+  int iFunction[nProcesses];
+
+};
+
+#endif // AETHER_INCLUDE_SCHEDULER_H_
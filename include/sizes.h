@@ -4,25 +4,12 @@
 #ifndef AETHER_INCLUDE_SIZES_H_
 #define AETHER_INCLUDE_SIZES_H_
 
-// This is for the geographic grid:
+// This is for the geographic grid.  The number of cells in each
+// direction is set at run time (#grid in aether.in), so only the
+// number of ghost cells is fixed here:
 
 #define nGeoGhosts 2
 
-#define nGeoAlts 50
-#define nGeoAltsG nGeoGhosts + nGeoAlts + nGeoGhosts
-#define iGeoAltStart_ nGeoGhosts // Inclusive!!!
-#define iGeoAltEnd_ nGeoGhosts + nGeoAlts - 1 // Inclusive!!!
-
-#define nGeoLons 18
-#define nGeoLonsG nGeoGhosts + nGeoLons + nGeoGhosts
-#define iGeoLonStart_ nGeoGhosts // Inclusive!!!
-#define iGeoLonEnd_ nGeoGhosts + nGeoLons - 1 // Inclusive!!!
-
-#define nGeoLats 36
-#define nGeoLatsG nGeoGhosts + nGeoLats + nGeoGhosts
-#define iGeoLatStart_ nGeoGhosts // Inclusive!!!
-#define iGeoLatEnd_ nGeoGhosts + nGeoLats - 1 // Inclusive!!!
-
 // This is for the magnetic grid:
 
 #define nMagGhosts 2
@@ -47,4 +34,84 @@
 #define nCharsShort 20
 #define nCharsLong 400
 
+// -----------------------------------------------------------------------------
+// The extents of a grid.  These used to be the nGeoLons, nGeoLats and
+// nGeoAlts macros, but they are now set when the grid is
+// created, so one executable can run any resolution.  Everything is
+// [Lon][Lat][Alt], with the altitude changing the fastest.
+// -----------------------------------------------------------------------------
+
+struct grid_extents {
+
+  // Number of cells, not including ghost cells:
+  long nLons;
+  long nLats;
+  long nAlts;
+
+  // Number of ghost cells on each side:
+  long nGCs;
+
+  // Number of cells, including ghost cells:
+  long nLonsG;
+  long nLatsG;
+  long nAltsG;
+
+  // Total number of cells (including ghost cells):
+  long nPointsG;
+
+  // Number of columns (lon x lat, including ghost cells):
+  long nColumnsG;
+
+  // First and last physical cell in each direction:
+  long iLonStart_, iLonEnd_; // Inclusive!!!
+  long iLatStart_, iLatEnd_; // Inclusive!!!
+  long iAltStart_, iAltEnd_; // Inclusive!!!
+
+  // With MPI, each process has a block of the whole grid (see
+  // parallel.h).  These are the number of cells in the whole grid (not
+  // including ghost cells), and the cell in the whole grid where this
+  // block starts.  Without MPI, the block is the whole grid:
+  long nLonsGlobal, nLatsGlobal;
+  long iLonOffset, iLatOffset;
+
+  grid_extents() : grid_extents(1, 1, 1, 0) {}
+
+  grid_extents(long nLons_in, long nLats_in, long nAlts_in, long nGCs_in) {
+    nLons = nLons_in;
+    nLats = nLats_in;
+    nAlts = nAlts_in;
+    nGCs = nGCs_in;
+    nLonsG = nGCs + nLons + nGCs;
+    nLatsG = nGCs + nLats + nGCs;
+    nAltsG = nGCs + nAlts + nGCs;
+    nPointsG = nLonsG * nLatsG * nAltsG;
+    nColumnsG = nLonsG * nLatsG;
+    iLonStart_ = nGCs;
+    iLonEnd_ = nGCs + nLons - 1;
+    iLatStart_ = nGCs;
+    iLatEnd_ = nGCs + nLats - 1;
+    iAltStart_ = nGCs;
+    iAltEnd_ = nGCs + nAlts - 1;
+    nLonsGlobal = nLons;
+    nLatsGlobal = nLats;
+    iLonOffset = 0;
+    iLatOffset = 0;
+  }
+
+  // Some loops (e.g., calc_conduction) stop before the last physical
+  // lon and lat of the whole grid.  In a block, they go up to (but not
+  // including) these, so only the block on that edge leaves it out.
+  // A direction with only one cell (e.g., #grid 1 36 50) keeps it, so
+  // there is still a column to do:
+  long iLonStop() const {
+    return iLonEnd_ +
+      (iLonOffset + nLons == nLonsGlobal && nLonsGlobal > 1 ? 0 : 1);
+  }
+  long iLatStop() const {
+    return iLatEnd_ +
+      (iLatOffset + nLats == nLatsGlobal && nLatsGlobal > 1 ? 0 : 1);
+  }
+
+};
+
 #endif // AETHER_INCLUDE_SIZES_H_
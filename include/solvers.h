@@ -6,12 +6,68 @@
 
 #include "sizes.h"
 
-int solver_conduction(float value[nGeoAltsG],
-		      float lambda[nGeoAltsG],
-		      float front[nGeoAltsG],
+// The conduction solver works on one column (nAlts includes the ghost
+// cells).  Common column lengths are dispatched to versions of the
+// solver that are compiled for that length, everything else goes
+// through solver_conduction_generic.  r, du12 and du22 describe the
+// altitude spacing of the column (see conduction_metrics), and are
+// stored with the grid's altitude profiles:
+
+int conduction_metrics(float *dalt_lower,
+		       float *r,
+		       float *du12,
+		       float *du22,
+		       long nAlts);
+
+int solver_conduction(float *value,
+		      float *lambda,
+		      float *front,
 		      float dt,
-		      float dalt_lower[nGeoAltsG],
-		      float *conduction);
+		      float *r,
+		      float *du12,
+		      float *du22,
+		      float *conduction,
+		      long nAlts);
+
+int solver_conduction_generic(float *value,
+			      float *lambda,
+			      float *front,
+			      float dt,
+			      float *r,
+			      float *du12,
+			      float *du22,
+			      float *conduction,
+			      long nAlts);
+
+// The batched conduction solver does nLanes columns at once, with one
+// column in each lane of the vector registers (so the tridiagonal
+// sweeps, which go up and down a column and can't be vectorized within
+// a column, are vectorized across columns).  Each lane points straight
+// into the fields and the grid's profiles, so nothing is copied into a
+// column first.  The coefficients are built as the forward sweep goes
+// up the column.  conduction gets dT/dt (not dT, like
+// solver_conduction), and lambda is kappa * radius_sq.  work has to
+// hold 2 * nLanes * nAlts floats.
+
+const int nConductionLanes = 8;
+
+template <int nLanes>
+struct conduction_batch_struct {
+  const float *temperature[nLanes];
+  const float *kappa[nLanes];
+  const float *rho_cv[nLanes];
+  const float *radius_sq[nLanes];
+  const float *r[nLanes];
+  const float *du12[nLanes];
+  const float *du22[nLanes];
+  float *conduction[nLanes];
+};
+
+template <int nLanes>
+int solver_conduction_batch(const conduction_batch_struct<nLanes> &batch,
+			    float dt,
+			    long nAlts,
+			    float *work);
 
 float solver_chemistry(float old_density,
 		       float source,
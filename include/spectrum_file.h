@@ -0,0 +1,66 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#ifndef AETHER_INCLUDE_SPECTRUM_FILE_H_
+#define AETHER_INCLUDE_SPECTRUM_FILE_H_
+
+#include <string>
+#include <cstdint>
+
+#include "report.h"
+
+// -----------------------------------------------------------------------------
+// A time series of solar spectra at 1 AU (photons/m2/s in each of the
+// wavelength bins of the euv file), for #euv_model file.  It is
+// binary, so nothing has to be parsed, and it is memory mapped, so
+// only the records around the current time are ever read in (a
+// multi-day run at a high cadence doesn't have to fit in memory).
+// python/write_spectrum_file.py makes these.  The layout is:
+//
+//   char    magic[8] = "AETHSPEC"
+//   int64   nWavelengths
+//   int64   nRecords
+//   and nRecords of:
+//     double  time (s since reference_year, like Times::get_current)
+//     float   intensity[nWavelengths]
+//
+// with the times going up.
+// -----------------------------------------------------------------------------
+
+class SpectrumFile {
+
+ public:
+
+  SpectrumFile();
+  ~SpectrumFile();
+  SpectrumFile(const SpectrumFile &) = delete;
+  SpectrumFile &operator=(const SpectrumFile &) = delete;
+
+  // Map the file, and check that it has nWavelengths_in bins:
+  int open(const std::string &file, long nWavelengths_in, Report &report);
+  void close();
+
+  long get_nRecords() const { return nRecords; }
+  double get_time(long iRecord) const;
+  const float *intensity(long iRecord) const;
+
+  // The records on either side of time: time is between iRecord and
+  // iRecord+1, weight of the way (held at the first or last record
+  // outside of the file).  The search starts from the last one, since
+  // the time only goes up a step at a time:
+  void find(double time, long &iRecord, float &weight);
+
+ private:
+
+  const char *data;
+  size_t nBytes;
+  long nWavelengths;
+  long nRecords;
+  long record_size;
+  long iRecordLast;
+
+  static const long header_size = 8 + 2 * sizeof(int64_t);
+
+};
+
+#endif // AETHER_INCLUDE_SPECTRUM_FILE_H_
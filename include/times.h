@@ -12,22 +12,29 @@ class Times {
 public:
 
   Times();
+  Times(const Times &) = delete;
+  Times &operator=(const Times &) = delete;
   void increment_time();
   void increment_intermediate(double dt);
   void display();
-  void set_times(std::vector<int> itime);
-  void set_end_time(std::vector<int> itime);
-  double get_current();
-  double get_end();
-  std::string get_YMD_HMS();
-  double get_intermediate();
-  float get_dt();
-  float get_orbittime();
-  double get_julian_day();
+  void set_times(const std::vector<int> &itime);
+  void set_end_time(const std::vector<int> &itime);
+  double get_current() const;
+  double get_end() const;
+  std::string get_YMD_HMS() const;
+  double get_intermediate() const;
+  float get_dt() const;
+  float get_orbittime() const;
+  double get_julian_day() const;
 
-  int check_time_gate(float dt_check);
+  int check_time_gate(float dt_check) const;
 
-  void calc_dt();
+  // The time step stays between dt_min and dt_max (see calc_dt), and
+  // the steps land right on each time gate that is added (e.g., the
+  // outputs), on the intermediate time and on the end:
+  void set_dt_bounds(float dt_min_in, float dt_max_in);
+  void add_time_gate(double dt_gate);
+  void calc_dt(float dt_limit);
   
 private:
   
@@ -39,7 +46,13 @@ private:
   double simulation;
   long iStep;
 
-  float dt;
+  // dt is a double so the steps add up to the gates exactly (the
+  // physics gets a float from get_dt):
+  double dt;
+  double dt_min;
+  double dt_max;
+  double simulation_next;
+  std::vector<double> time_gates;
 
   // Derived variables from the current time:
   std::vector<int> iCurrent;
@@ -4,6 +4,10 @@
 #ifndef AETHER_INCLUDE_TRANSFORM_H_
 #define AETHER_INCLUDE_TRANSFORM_H_
 
+#include <vector>
+
+#include "sizes.h"
+
 void transform_llr_to_xyz(float llr_in[3], float xyz_out[3]);
 void transform_rot_z(float xyz_in[3], float angle_in, float xyz_out[3]);
 void transform_rot_y(float xyz_in[3], float angle_in, float xyz_out[3]);
@@ -23,9 +27,13 @@ void vector_diff(float vect_in_1[3],
 
 void get_vector_component(float *vector_in_v3gc,
 			  int iComponent,
-			  int IsGeoGrid,
+			  grid_extents extents,
 			  float *component_out_s3gc);
 
+void expand_s2gc_to_s3gc(float *field_in_s2gc,
+			 grid_extents extents,
+			 float *field_out_s3gc);
+
 
 #endif // AETHER_INCLUDE_TRANSFORM_H_
 
@@ -0,0 +1,121 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#ifndef AETHER_INCLUDE_WORKERS_H_
+#define AETHER_INCLUDE_WORKERS_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "sizes.h"
+#include "field3d.h"
+#include "report.h"
+
+// -----------------------------------------------------------------------------
+// The workers split the geo grid into lon/lat tiles (one per thread),
+// and each thread owns its tile for the whole run.  The threads are
+// started once and wait for work, so a kernel hands a function to
+// run(), and every thread calls it on its own tile:
+//
+//   workers.run([&](const tile_struct &tile, int iThread) {
+//     for (column_struct column : temperature.columns(tile))
+//       ... the column ...
+//   });
+//
+// The tiles cover all of the columns, including the ghost columns
+// around the grid (the nGeoGhosts halo), so kernels that work
+// everywhere don't have to do anything special at the edges.  A
+// kernel that needs neighboring columns can read them (the memory is
+// shared), but it can only write to its own tile.  The calling thread
+// is thread 0, so with one thread (#threads in aether.in, the
+// default) there are no extra threads at all.
+// -----------------------------------------------------------------------------
+
+class Workers {
+
+ public:
+
+  Workers(int nThreads_in, const grid_extents &extents_in, Report &report);
+  ~Workers();
+
+  // The threads point at this object, so it can't be copied:
+  Workers(const Workers &) = delete;
+  Workers &operator=(const Workers &) = delete;
+
+  // Run the kernel on every tile, and wait until all of them are done.
+  // The kernel is anything that can be called with (tile, iThread),
+  // like a lambda.  The threads call it through a pointer, so it isn't
+  // copied, and nothing is allocated (unlike std::function):
+  template <typename Kernel>
+  void run(const Kernel &kernel) {
+    run_kernel(&call_kernel<Kernel>, &kernel, tiles);
+  }
+
+  // The same, but for a kernel that has a lot more work to do in some
+  // columns than others (like the EUV, which has nothing to do at
+  // night).  column_costs is a hint of how much work each column is
+  // (in Field2D order, nColumnsG of them).  Instead of the threads'
+  // own tiles, the grid is cut into a lon stripe for each thread, with
+  // about the same cost in each.  The stripes move around, so the
+  // thread that does a column isn't always the one that touched it
+  // first:
+  template <typename Kernel>
+  void run(const Kernel &kernel, const std::vector<float> &column_costs) {
+    make_tiles_for_costs(column_costs);
+    run_kernel(&call_kernel<Kernel>, &kernel, cost_tiles);
+  }
+
+  // Zero a new field with each thread touching its own tile first, so
+  // the pages end up close to the thread that uses them (this is
+  // what the arena calls, see Arena::set_first_touch).  Fields that
+  // aren't the size of the grid are just zeroed here:
+  void first_touch(float *field, long nPoints, long nValuesPerPoint);
+
+  int get_nThreads();
+  tile_struct get_tile(int iThread);
+
+ private:
+
+  int nThreads;
+  grid_extents extents;
+  std::vector<tile_struct> tiles;
+
+  // The stripes for run with costs, and the cost of each lon:
+  std::vector<tile_struct> cost_tiles;
+  std::vector<double> lon_costs;
+  const std::vector<tile_struct> *tiles_now;
+
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable start_work;
+  std::condition_variable work_done;
+
+  typedef void (*kernel_caller)(const void *kernel,
+				const tile_struct &tile,
+				int iThread);
+
+  template <typename Kernel>
+  static void call_kernel(const void *kernel,
+			  const tile_struct &tile,
+			  int iThread) {
+    (*static_cast<const Kernel *>(kernel))(tile, iThread);
+  }
+
+  kernel_caller caller_now;
+  const void *kernel_now;
+  long iKernel;
+  int nBusy;
+  int IsDone;
+
+  void make_tiles_for_threads(Report &report);
+  void make_tiles_for_costs(const std::vector<float> &column_costs);
+  void work(int iThread);
+  void run_kernel(kernel_caller caller,
+		  const void *kernel,
+		  const std::vector<tile_struct> &tiles_to_run);
+
+};
+
+#endif // AETHER_INCLUDE_WORKERS_H_
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+
+# (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+# Full license can be found in License.md
+
+# Run Aether (built with make MPI=1) with mpirun on more and more
+# processes, and show how each function in the timing summary scales.
+#
+#   strong : the same grid on every number of processes, so the time
+#            should go down as 1/N (speedup = t1 / tN)
+#   weak   : the grid grows with the number of processes, so each
+#            process always has the same size block, and the time
+#            should stay the same (efficiency = t1 / tN)
+#
+# Run this in a run directory (see make rundir), e.g.:
+#   python ../python/run_scaling.py -np 1 2 4 8 -mode weak
+
+import argparse
+import re
+import shutil
+import subprocess
+
+def get_args():
+
+    parser = argparse.ArgumentParser(description =
+                                     'Strong or weak scaling of Aether')
+    parser.add_argument('-np', nargs = '+', type = int,
+                        default = [1, 2, 4],
+                        help = 'numbers of processes to run with')
+    parser.add_argument('-mode', default = 'strong',
+                        choices = ['strong', 'weak'])
+    parser.add_argument('-grid', nargs = 3, type = int,
+                        default = [18, 36, 50],
+                        help = 'nLons nLats nAlts (for one process if weak)')
+    parser.add_argument('-exe', default = './aether.exe')
+    parser.add_argument('-mpirun', default = 'mpirun',
+                        help = 'mpirun command (with any options)')
+
+    return parser.parse_args()
+
+# ----------------------------------------------------------------------
+# Split nProcs into nLon x nLat, as square as it can be (like the model)
+# ----------------------------------------------------------------------
+
+def factor(nProcs):
+    nLon = int(nProcs ** 0.5)
+    while (nProcs % nLon != 0):
+        nLon = nLon - 1
+    return nLon, nProcs // nLon
+
+# ----------------------------------------------------------------------
+# Get the time of each entry in the timing summary.  With more than one
+# process, this is the slowest process.
+# ----------------------------------------------------------------------
+
+def read_timings(output):
+    timings = {}
+    entry = ''
+    for line in output.split('\n'):
+        if (line.startswith('>')):
+            entry = line.strip()
+        m = re.match(r'\s*timing_total \(s\) : (\S+)', line)
+        if (m and entry):
+            timings[entry] = float(m.group(1))
+    return timings
+
+def run_one(args, nProcs):
+
+    nLons, nLats, nAlts = args.grid
+    if (args.mode == 'weak'):
+        nLonBlocks, nLatBlocks = factor(nProcs)
+        nLons = nLons * nLonBlocks
+        nLats = nLats * nLatBlocks
+
+    # The last #grid in aether.in wins, so just add one on the end:
+    shutil.copy('aether.in', 'aether.in.scaling')
+    with open('aether.in', 'a') as fp:
+        fp.write('\n#grid\n%d\n%d\n%d\n' % (nLons, nLats, nAlts))
+
+    command = args.mpirun.split() + ['-np', str(nProcs), args.exe]
+    try:
+        result = subprocess.run(command, capture_output = True, text = True)
+    finally:
+        shutil.move('aether.in.scaling', 'aether.in')
+
+    if (result.returncode != 0):
+        print('Run on', nProcs, 'processes failed:')
+        print(result.stdout[-2000:])
+        return {}
+
+    print('Ran on %3d processes (%d x %d x %d grid)' %
+          (nProcs, nLons, nLats, nAlts))
+    return read_timings(result.stdout)
+
+args = get_args()
+
+all_timings = {}
+for nProcs in args.np:
+    all_timings[nProcs] = run_one(args, nProcs)
+
+nFirst = args.np[0]
+entries = list(all_timings[nFirst].keys())
+
+if (args.mode == 'strong'):
+    title = 'speedup'
+else:
+    title = 'efficiency'
+
+print('\n%s scaling (time in s, %s relative to %d processes)' %
+      (args.mode, title, nFirst))
+width = max([len(entry) for entry in entries] + [20]) + 2
+print('function'.ljust(width) +
+      ''.join(['%12s' % ('np=' + str(n)) for n in args.np]))
+
+for entry in entries:
+    times = ''
+    ratios = ''
+    for nProcs in args.np:
+        t = all_timings[nProcs].get(entry, 0.0)
+        t1 = all_timings[nFirst][entry]
+        times = times + '%12.3f' % t
+        if (t > 0.0 and t1 > 0.0):
+            ratio = t1 / t
+            if (args.mode == 'strong'):
+                # The ideal speedup is nProcs / nFirst:
+                ratios = ratios + '%12.2f' % ratio
+            else:
+                ratios = ratios + '%11.0f%%' % (100.0 * ratio)
+        else:
+            ratios = ratios + '%12s' % '-'
+    print(entry.ljust(width) + times)
+    print(('  ' + title).ljust(width) + ratios)
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+
+# (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+# Full license can be found in License.md
+
+# Make a binary spectrum file for #euv_model file (see
+# include/spectrum_file.h) from a text file with one spectrum on each
+# line:
+#
+#   yyyy mm dd hh mm ss  intensity_1 ... intensity_nWavelengths
+#
+# where the intensities are at 1 AU (photons/m2/s), in the same
+# wavelength bins as the euv file (UA/inputs/euv.csv), and the times
+# go up.  Lines that start with # are skipped.  e.g.:
+#   python write_spectrum_file.py spectra.txt spectra.bin
+
+import argparse
+import struct
+import sys
+
+# These have to be the same as time_int_to_real in time_conversion.cpp:
+reference_year = 1965
+seconds_per_day = 86400.0
+seconds_per_year = 365.0 * seconds_per_day
+days_before_month = [0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334]
+
+def time_int_to_real(year, month, day, hour, minute, second):
+    nYears = year - reference_year
+    nLeaps = nYears // 4
+    nDays = days_before_month[month - 1] + day - 1
+    if year % 4 == 0 and month > 2:
+        nDays += 1
+    return (second + minute * 60.0 + hour * 3600.0 +
+            (nDays + nLeaps) * seconds_per_day + nYears * seconds_per_year)
+
+def get_args():
+
+    parser = argparse.ArgumentParser(description =
+                                     'Make a binary Aether spectrum file')
+    parser.add_argument('text_file', help = 'spectra, one time per line')
+    parser.add_argument('spectrum_file', help = 'binary file to write')
+
+    return parser.parse_args()
+
+args = get_args()
+
+times = []
+spectra = []
+with open(args.text_file) as text:
+    for line in text:
+        items = line.split()
+        if len(items) == 0 or items[0].startswith('#'):
+            continue
+        itime = [int(item) for item in items[0:6]]
+        times.append(time_int_to_real(*itime))
+        spectra.append([float(item) for item in items[6:]])
+
+nWavelengths = len(spectra[0])
+for iRecord in range(len(spectra)):
+    if len(spectra[iRecord]) != nWavelengths:
+        sys.exit('Line %d has %d wavelengths, not %d' %
+                 (iRecord + 1, len(spectra[iRecord]), nWavelengths))
+    if iRecord > 0 and times[iRecord] <= times[iRecord - 1]:
+        sys.exit('The times have to go up (line %d)' % (iRecord + 1))
+
+with open(args.spectrum_file, 'wb') as out:
+    out.write(b'AETHSPEC')
+    out.write(struct.pack('<qq', nWavelengths, len(spectra)))
+    for time, spectrum in zip(times, spectra):
+        out.write(struct.pack('<d', time))
+        out.write(struct.pack('<%df' % nWavelengths, *spectrum))
+
+print('Wrote %d spectra of %d wavelengths to %s' %
+      (len(spectra), nWavelengths, args.spectrum_file))
@@ -9,32 +9,42 @@
 #include "../include/inputs.h"
 #include "../include/report.h"
 
-void Neutrals::add_sources( Times time, Report &report) {
+void Neutrals::add_sources(float dt,
+			   Workers &workers,
+			   Report &report) {
 
-  std::string function="add_sources";
+  static std::string function="add_sources";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
-  long iLon, iLat, iAlt, index;
+  workers.run([&](const tile_struct &tile, int iThread) {
+    add_sources_columns(dt, tile);
+  });
 
-  float dt = time.get_dt();
-  
-  for (iLon = 0; iLon < nGeoLonsG; iLon++) {
-    for (iLat = 0; iLat < nGeoLatsG; iLat++) {
-      for (iAlt = 0; iAlt < nGeoAltsG; iAlt++) {
-	
-	index = ijk_geo_s3gc(iLon,iLat,iAlt);
-
-	temperature_s3gc[index] =
-	  temperature_s3gc[index] +
-	  dt * ( heating_euv_s3gc[index] +
-		 conduction_s3gc[index]);
-
-      }
-    }
-  }
+  state_changed();
   
   report.exit(function);  
   return;
   
 }
+
+void Neutrals::add_sources_columns(float dt, const tile_struct &tile) {
+
+  Field3D<float> temperature(temperature_s3gc, extents);
+
+  long iAlt, index;
+
+  for (column_struct column : temperature.columns(tile)) {
+    for (iAlt = 0; iAlt < extents.nAltsG; iAlt++) {
+      
+      index = temperature.index(column.iLon, column.iLat, iAlt);
+
+      temperature_s3gc[index] =
+	temperature_s3gc[index] +
+	dt * ( heating_euv_s3gc[index] +
+	       conduction_s3gc[index]);
+
+    }
+  }
+
+}
@@ -2,6 +2,11 @@
 // Full license can be found in License.md
 
 #include <iostream>
+#include <algorithm>
+#include <vector>
+#include <set>
+#include <sstream>
+#include <utility>
 
 #include "../include/times.h"
 #include "../include/inputs.h"
@@ -14,7 +19,479 @@
 #include "../include/calc_euv.h"
 #include "../include/report.h"
 #include "../include/output.h"
+#include "../include/workers.h"
+#include "../include/parallel.h"
+#include "../include/allocations.h"
+#include "../include/scheduler.h"
 
+// -----------------------------------------------------------------------------
+// The fields (of nPointsG floats) that each stage of a step goes
+// through, and how many bytes that is for a step.  Done a stage at a
+// time, each stage streams all of its fields through memory.  With
+// #column_fusion, the columns that all of the stages are done on stay
+// in the cache, so each field only goes through memory once for each
+// pass over the grid (see advance_columns).  This only counts fields,
+// for a step that runs everything, so it is an estimate: a field can
+// be in the cache between two stages, or read and written (twice the
+// traffic).  bench_column_fusion (in benchmark.cpp) measures it.
+// -----------------------------------------------------------------------------
+
+typedef std::vector<const float *> field_list;
+
+void add_species_fields(field_list &fields,
+			const Neutrals &neutrals,
+			const std::vector<int> &species) {
+  for (int iSpecies : species)
+    fields.push_back(neutrals.neutrals[iSpecies].density_s3gc);
+}
+
+std::pair<double, double> calc_step_traffic(const Neutrals &neutrals,
+					    const Ions &ions) {
+
+  std::vector<field_list> before_dt(2), step;
+  field_list all_neutrals, absorbers, chapman, neutral_ionization;
+  field_list all_ions, ion_ionization, euv_sources, saved_then, saved_next;
+  int iSpecies;
+
+  for (iSpecies = 0; iSpecies < nSpecies; iSpecies++) {
+    all_neutrals.push_back(neutrals.neutrals[iSpecies].density_s3gc);
+    neutral_ionization.push_back(neutrals.neutrals[iSpecies].ionization_s3gc);
+  }
+  for (iSpecies = 0; iSpecies < nIons; iSpecies++) {
+    all_ions.push_back(ions.species[iSpecies].density_s3gc);
+    ion_ionization.push_back(ions.species[iSpecies].ionization_s3gc);
+  }
+  add_species_fields(absorbers, neutrals, neutrals.absorbers);
+  for (int iA : neutrals.absorbers)
+    chapman.push_back(neutrals.neutrals[iA].chapman_s3gc);
+  long nPoints = neutrals.extents.nPointsG;
+  for (long iField = 0; iField < long(neutrals.euv_source_fields.size());
+       iField++) {
+    euv_sources.push_back(neutrals.euv_source_fields[iField]);
+    saved_then.push_back(neutrals.euv_sources_then.fields.data() +
+			 iField * nPoints);
+    saved_next.push_back(neutrals.euv_sources_next.fields.data() +
+			 iField * nPoints);
+  }
+
+  // calc_thermodynamics and calc_dt_limit:
+  before_dt[0] = all_neutrals;
+  before_dt[0].insert(before_dt[0].end(),
+		      {neutrals.temperature_s3gc, neutrals.density_s3gc,
+		       neutrals.rho_s3gc, neutrals.mean_major_mass_s3gc,
+		       neutrals.pressure_s3gc, neutrals.Cv_s3gc,
+		       neutrals.gamma_s3gc, neutrals.kappa_s3gc,
+		       neutrals.sound_s3gc, neutrals.rho_cv_s3gc});
+  before_dt[1] = {neutrals.rho_cv_s3gc, neutrals.kappa_s3gc,
+		  neutrals.sound_s3gc};
+
+  // calc_chapman and calc_ionization_heating (twice with interpolate,
+  // for now and the next update, each one saved):
+  field_list euv_chapman = absorbers, euv_heating = chapman;
+  euv_chapman.push_back(neutrals.temperature_s3gc);
+  euv_chapman.insert(euv_chapman.end(), chapman.begin(), chapman.end());
+  euv_heating.insert(euv_heating.end(), absorbers.begin(), absorbers.end());
+  add_species_fields(euv_heating, neutrals, neutrals.ionization_neutral);
+  euv_heating.insert(euv_heating.end(),
+		     neutral_ionization.begin(), neutral_ionization.end());
+  euv_heating.insert(euv_heating.end(),
+		     ion_ionization.begin(), ion_ionization.end());
+  euv_heating.push_back(neutrals.heating_euv_s3gc);
+  euv_heating.push_back(neutrals.rho_cv_s3gc);
+  int nEuvUpdates = 1;
+  if (neutrals.euv_interpolation == "interpolate") nEuvUpdates = 2;
+  for (int iUpdate = 0; iUpdate < nEuvUpdates; iUpdate++) {
+    step.push_back(euv_chapman);
+    step.push_back(euv_heating);
+  }
+  if (nEuvUpdates > 1) {
+    field_list save_then = euv_sources, save_next = euv_sources;
+    field_list interpolate = euv_sources;
+    save_then.insert(save_then.end(), saved_then.begin(), saved_then.end());
+    save_next.insert(save_next.end(), saved_next.begin(), saved_next.end());
+    interpolate.insert(interpolate.end(), saved_then.begin(), saved_then.end());
+    interpolate.insert(interpolate.end(), saved_next.begin(), saved_next.end());
+    step.push_back(save_then);
+    step.push_back(save_next);
+    step.push_back(interpolate);
+  }
+
+  // calc_conduction and add_sources:
+  step.push_back({neutrals.temperature_s3gc, neutrals.kappa_s3gc,
+		  neutrals.rho_cv_s3gc, neutrals.conduction_s3gc});
+  step.push_back({neutrals.temperature_s3gc, neutrals.heating_euv_s3gc,
+		  neutrals.conduction_s3gc});
+
+  // fill_electrons and calc_chemistry:
+  field_list electrons = all_ions, chemistry = all_neutrals;
+  electrons.push_back(ions.density_s3gc);
+  electrons.push_back(ions.species[nIons].density_s3gc);
+  step.push_back(electrons);
+  chemistry.insert(chemistry.end(),
+		   neutral_ionization.begin(), neutral_ionization.end());
+  chemistry.insert(chemistry.end(), all_ions.begin(), all_ions.end());
+  chemistry.insert(chemistry.end(),
+		   ion_ionization.begin(), ion_ionization.end());
+  chemistry.insert(chemistry.end(),
+		   {ions.density_s3gc, neutrals.temperature_s3gc,
+		    ions.ion_temperature_s3gc, ions.electron_temperature_s3gc,
+		    neutrals.density_s3gc});
+  step.push_back(chemistry);
+
+  // A stage at a time, and a pass at a time:
+  long nStaged = 0, nFused = 0;
+  for (const std::vector<field_list> *pass : {&before_dt, &step}) {
+    std::set<const float *> fields_in_pass;
+    for (const field_list &stage : *pass) {
+      std::set<const float *> fields_in_stage(stage.begin(), stage.end());
+      nStaged += fields_in_stage.size();
+      fields_in_pass.insert(stage.begin(), stage.end());
+    }
+    nFused += fields_in_pass.size();
+  }
+
+  double nBytesPerField = nPoints * sizeof(float);
+  return std::make_pair(nStaged * nBytesPerField, nFused * nBytesPerField);
+
+}
+
+// -----------------------------------------------------------------------------
+// A step done a stage at a time, with each stage going over the whole
+// grid (with the workers) before the next one starts.
+// -----------------------------------------------------------------------------
+
+int advance_stages(Planets &planet,
+		   Grid &gGrid,
+		   Times &time,
+		   Euv &euv,
+		   Neutrals &neutrals,
+		   Ions &ions,
+		   Chemistry &chemistry,
+		   Indices &indices,
+		   Inputs &input,
+		   Workers &workers,
+		   Parallel &parallel,
+		   Scheduler &scheduler,
+		   Report &report) {
+
+  int iErr=0;
+
+  // The SZA is done before the step is picked, so it uses the time
+  // step from the last one to see if it is due (which is fine, since
+  // it doesn't integrate anything):
+  if (scheduler.is_due(Scheduler::sza_process, time)) {
+    scheduler.start(Scheduler::sza_process, report);
+    gGrid.calc_sza(planet, time, workers, report);
+    scheduler.stop(Scheduler::sza_process, time, 1, report);
+  }
+
+  // The densities from the last step were sent while the output and
+  // the SZA were being done, so they should be here by now (and the
+  // derived quantities have to be redone with the new halo):
+  parallel.finish_halo_exchange(Parallel::density_halo, report);
+  neutrals.state_changed();
+
+  neutrals.calc_thermodynamics(workers, report);
+
+  // The longest sub-step the chemistry can take (from the last step)
+  // is the same on every processor, so they all take the same number:
+  float dt_limit_chemistry = parallel.min(chemistry.get_dt_limit());
+
+  // The step is as long as the conduction, sound speed and chemistry
+  // (with its sub-steps) let it be, on every processor, so they all
+  // take the same step:
+  Inputs::dt_input_struct dt_input = input.get_dt_inputs();
+  float dt_limit = dt_input.dt_max;
+  if (dt_input.dt_max > dt_input.dt_min) {
+    dt_limit = neutrals.calc_dt_limit(gGrid,
+				      dt_input.cfl,
+				      dt_input.diffusion_number,
+				      workers,
+				      report);
+    dt_limit = parallel.min(dt_limit);
+    dt_limit = std::min(dt_limit,
+			scheduler.get_dt_limit(Scheduler::chemistry_process,
+					       dt_limit_chemistry));
+  }
+  time.calc_dt(dt_limit);
+  if (report.test_verbose(2))
+    std::cout << "dt : " << time.get_dt() << " s (limit : "
+	      << dt_limit << " s)\n";
+
+  // The EUV is always timed, since it interpolates between updates:
+  scheduler.start(Scheduler::euv_process, report);
+  iErr = calc_euv(planet,
+		  gGrid,
+		  time,
+		  euv,
+		  neutrals,
+		  ions,
+		  indices,
+		  input,
+		  scheduler.is_due(Scheduler::euv_process, time),
+		  workers,
+		  report);
+  scheduler.stop(Scheduler::euv_process, time, 1, report);
+
+  if (scheduler.is_due(Scheduler::conduction_process, time)) {
+    scheduler.start(Scheduler::conduction_process, report);
+    neutrals.calc_conduction(gGrid,
+			     scheduler.get_dt(Scheduler::conduction_process,
+					      time),
+			     workers,
+			     report);
+    scheduler.stop(Scheduler::conduction_process, time, 1, report);
+  }
+
+  if (scheduler.is_due(Scheduler::sources_process, time)) {
+    scheduler.start(Scheduler::sources_process, report);
+    neutrals.add_sources(scheduler.get_dt(Scheduler::sources_process, time),
+			 workers,
+			 report);
+    scheduler.stop(Scheduler::sources_process, time, 1, report);
+  }
+
+  // The temperature is done for this step, so send it while the
+  // chemistry is going, then send the densities:
+  parallel.start_halo_exchange(Parallel::temperature_halo, report);
+  if (scheduler.is_due(Scheduler::chemistry_process, time)) {
+    scheduler.start(Scheduler::chemistry_process, report);
+    float dt_chemistry = scheduler.get_dt(Scheduler::chemistry_process, time);
+    int nSubcycles =
+      scheduler.get_nSubcycles(Scheduler::chemistry_process,
+			       dt_chemistry,
+			       dt_limit_chemistry);
+    chemistry.calc_chemistry(neutrals,
+			     ions,
+			     dt_chemistry,
+			     nSubcycles,
+			     gGrid,
+			     workers,
+			     report);
+    scheduler.stop(Scheduler::chemistry_process, time, nSubcycles, report);
+  }
+  parallel.finish_halo_exchange(Parallel::temperature_halo, report);
+  neutrals.state_changed();
+  parallel.start_halo_exchange(Parallel::density_halo, report);
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// Run kernel on the blocks of the fused columns in the tiles of the
+// workers.  A block is up to nColumns lats at one lon, which are next
+// to each other in memory.
+// -----------------------------------------------------------------------------
+
+template <typename Kernel>
+void run_blocks(Workers &workers, long nColumns, const Kernel &kernel) {
+  workers.run([&](const tile_struct &tile, int iThread) {
+    tile_struct block;
+    for (long iLon = tile.iLonStart; iLon < tile.iLonEnd; iLon++) {
+      for (long iLat = tile.iLatStart; iLat < tile.iLatEnd; iLat += nColumns) {
+	block.iLonStart = iLon;
+	block.iLonEnd = iLon + 1;
+	block.iLatStart = iLat;
+	block.iLatEnd = std::min(iLat + nColumns, tile.iLatEnd);
+	kernel(block, iThread);
+      }
+    }
+  });
+}
+
+// -----------------------------------------------------------------------------
+// A step done with #column_fusion.  All of the stages that only use
+// their own column are done on a block of columns, one after the
+// other, before going on to the next block, so the block stays in the
+// cache and each field only goes through memory once per pass.  The
+// time step needs the limit from the whole grid (on every processor),
+// so there are two passes: the SZA, thermodynamics and the limit on
+// dt, and then (once dt is known) everything else.  The columns go
+// through the same stages in the same order as in advance_stages, so
+// the answers are the same.
+// -----------------------------------------------------------------------------
+
+int advance_columns(Planets &planet,
+		    Grid &gGrid,
+		    Times &time,
+		    Euv &euv,
+		    Neutrals &neutrals,
+		    Ions &ions,
+		    Chemistry &chemistry,
+		    Indices &indices,
+		    Inputs &input,
+		    Workers &workers,
+		    Parallel &parallel,
+		    Scheduler &scheduler,
+		    Report &report) {
+
+  int iErr=0;
+  long nColumns = input.get_column_fusion();
+  int nThreads = workers.get_nThreads();
+
+  parallel.finish_halo_exchange(Parallel::density_halo, report);
+  neutrals.state_changed();
+
+  // ------------------------------------
+  // The first pass, up to the time step:
+  // ------------------------------------
+
+  static std::string function_dt="advance_columns (dt)";
+  static int iFunction_dt = -1;
+  report.enter(function_dt, iFunction_dt);
+
+  int IsSzaDue = scheduler.is_due(Scheduler::sza_process, time);
+  Grid::sun_struct sun = gGrid.calc_sun(planet, time);
+
+  int DoThermodynamics = neutrals.needs_thermodynamics();
+  if (DoThermodynamics) neutrals.prepare_thermodynamics(nThreads);
+
+  float dt_limit_chemistry = parallel.min(chemistry.get_dt_limit());
+
+  Inputs::dt_input_struct dt_input = input.get_dt_inputs();
+  int DoDtLimit = (dt_input.dt_max > dt_input.dt_min);
+  if (DoDtLimit) neutrals.prepare_dt_limit(nThreads);
+
+  run_blocks(workers, nColumns, [&](const tile_struct &block, int iThread) {
+    if (IsSzaDue) gGrid.calc_sza_columns(sun, block);
+    if (DoThermodynamics) neutrals.calc_thermodynamics_columns(block, iThread);
+    if (DoDtLimit)
+      neutrals.calc_dt_limit_columns(gGrid,
+				     dt_input.cfl,
+				     dt_input.diffusion_number,
+				     block,
+				     iThread);
+  });
+
+  if (IsSzaDue) scheduler.done(Scheduler::sza_process, time, 1);
+  if (DoThermodynamics) neutrals.iThermodynamicsVersion = neutrals.iStateVersion;
+
+  float dt_limit = dt_input.dt_max;
+  if (DoDtLimit) {
+    dt_limit = parallel.min(neutrals.finish_dt_limit());
+    dt_limit = std::min(dt_limit,
+			scheduler.get_dt_limit(Scheduler::chemistry_process,
+					       dt_limit_chemistry));
+  }
+  time.calc_dt(dt_limit);
+  if (report.test_verbose(2))
+    std::cout << "dt : " << time.get_dt() << " s (limit : "
+	      << dt_limit << " s)\n";
+
+  report.exit(function_dt);
+
+  // ------------------------------------
+  // The second pass, the rest of the step:
+  // ------------------------------------
+
+  static std::string function="advance_columns";
+  static int iFunction = -1;
+  report.enter(function, iFunction);
+
+  // The EUV spectrum is the same for all of the columns.  With
+  // interpolate, the sources of the last update (for the sun now)
+  // become the ones to go from, and the new ones are for the sun at
+  // the next update (see calc_euv):
+  int IsEuvDue = scheduler.is_due(Scheduler::euv_process, time);
+  int IsInterpolated = (neutrals.euv_interpolation == "interpolate");
+  int IsFirstEuv = 0;
+  float dt_euv = input.get_dt_euv();
+  Grid::sun_struct sun_next = gGrid.calc_sun(planet, time, dt_euv);
+  if (IsEuvDue) {
+    // Keep an error from the spectrum (the #euv_model file can't be
+    // read), not just the one from scaling it:
+    iErr = euv.calc_spectrum(time, indices, report);
+    if (euv.scale_from_1au(planet, time) > 0) iErr = 1;
+    neutrals.prepare_chapman(nThreads);
+    neutrals.prepare_ionization_heating(euv, nThreads);
+    if (IsInterpolated) {
+      IsFirstEuv = (neutrals.euv_sources_next.time < 0.0);
+      std::swap(neutrals.euv_sources_then, neutrals.euv_sources_next);
+      if (IsFirstEuv) neutrals.euv_sources_then.time = time.get_current();
+      neutrals.euv_sources_next.time = time.get_current() + dt_euv;
+    }
+  }
+  float weight = 0.0;
+  if (IsInterpolated) weight = neutrals.get_euv_weight(time);
+
+  int IsConductionDue = scheduler.is_due(Scheduler::conduction_process, time);
+  float dt_conduction = scheduler.get_dt(Scheduler::conduction_process, time);
+  if (IsConductionDue) neutrals.prepare_conduction(nThreads);
+
+  int IsSourcesDue = scheduler.is_due(Scheduler::sources_process, time);
+  float dt_sources = scheduler.get_dt(Scheduler::sources_process, time);
+
+  int IsChemistryDue = scheduler.is_due(Scheduler::chemistry_process, time);
+  float dt_chemistry = scheduler.get_dt(Scheduler::chemistry_process, time);
+  int nSubcycles = scheduler.get_nSubcycles(Scheduler::chemistry_process,
+					    dt_chemistry,
+					    dt_limit_chemistry);
+  if (IsChemistryDue) chemistry.prepare_chemistry(nThreads);
+
+  run_blocks(workers, nColumns, [&](const tile_struct &block, int iThread) {
+
+    if (IsEuvDue && !IsInterpolated) {
+      neutrals.calc_chapman_columns(gGrid, block, iThread, report);
+      neutrals.calc_ionization_heating_columns(ions, block, iThread, report);
+    }
+
+    if (IsEuvDue && IsInterpolated) {
+      if (IsFirstEuv) {
+	neutrals.calc_chapman_columns(gGrid, block, iThread, report);
+	neutrals.calc_ionization_heating_columns(ions, block, iThread, report);
+	neutrals.save_euv_sources_columns(neutrals.euv_sources_then, block);
+      }
+      gGrid.calc_sza_columns(sun_next, block);
+      neutrals.calc_chapman_columns(gGrid, block, iThread, report);
+      neutrals.calc_ionization_heating_columns(ions, block, iThread, report);
+      neutrals.save_euv_sources_columns(neutrals.euv_sources_next, block);
+      gGrid.calc_sza_columns(sun, block);
+    }
+
+    if (IsInterpolated) neutrals.interpolate_euv_sources_columns(weight, block);
+
+    if (IsConductionDue)
+      neutrals.calc_conduction_columns(gGrid, dt_conduction, block, iThread,
+				       report);
+
+    if (IsSourcesDue) neutrals.add_sources_columns(dt_sources, block);
+
+    if (IsChemistryDue) {
+      ions.fill_electrons_columns(block);
+      chemistry.calc_chemistry_columns(neutrals,
+				       ions,
+				       dt_chemistry,
+				       nSubcycles,
+				       block,
+				       iThread);
+    }
+
+  });
+
+  scheduler.done(Scheduler::euv_process, time, 1);
+  if (IsConductionDue) scheduler.done(Scheduler::conduction_process, time, 1);
+  if (IsSourcesDue) scheduler.done(Scheduler::sources_process, time, 1);
+  if (IsChemistryDue) {
+    chemistry.finish_chemistry(neutrals);
+    scheduler.done(Scheduler::chemistry_process, time, nSubcycles);
+  }
+  neutrals.state_changed();
+
+  report.exit(function);
+
+  parallel.start_halo_exchange(Parallel::temperature_halo, report);
+  parallel.finish_halo_exchange(Parallel::temperature_halo, report);
+  neutrals.state_changed();
+  parallel.start_halo_exchange(Parallel::density_halo, report);
+
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// Take one step (of a length that calc_dt picks), and write the output
+// if it is time.
+// -----------------------------------------------------------------------------
 
 int advance( Planets &planet,
 	     Grid &gGrid,
@@ -25,40 +502,88 @@ int advance( Planets &planet,
 	     Chemistry &chemistry,
 	     Indices &indices,
 	     Inputs &input,
+	     Workers &workers,
+	     Parallel &parallel,
+	     Scheduler &scheduler,
 	     Report &report) {
 
   int iErr=0;
 
-  std::string function="advance";
+  static std::string function="advance";
   static int iFunction = -1;
   report.enter(function, iFunction);
 
+  // Count the heap allocations in the step (see allocations.h).  The
+  // first step sets things up, and the output writes files, so those
+  // are left out:
+  static int IsFirstStep = 1;
+  long nAllocations = get_nAllocations();
+
   time.display();
 
-  gGrid.calc_sza(planet, time, report);
-  neutrals.calc_mass_density(report);
-  neutrals.calc_specific_heat(report);
-  time.calc_dt();
-  
-  iErr = calc_euv(planet,
-		  gGrid,
-		  time,
-		  euv,
-		  neutrals,
-		  ions,
-		  indices,
-		  input,
-		  report);
-  
-  neutrals.calc_conduction(gGrid, time, report);
+  // The step is timed on its own (without the output), under the name
+  // of the way it is done, so the time per step with #column_fusion
+  // can be compared to a run without it.  The traffic is only an
+  // estimate (see calc_step_traffic), but with the time per step, the
+  // summary gives about what bandwidth the step gets:
+  static std::string function_stages="step (a stage at a time)";
+  static int iFunction_stages = -1;
+  static std::string function_fused="step (#column_fusion)";
+  static int iFunction_fused = -1;
+  int IsFused = (input.get_column_fusion() > 0);
 
-  neutrals.add_sources(time, report);
+  if (IsFused)
+    report.enter(function_fused, iFunction_fused);
+  else
+    report.enter(function_stages, iFunction_stages);
+
+  if (IsFirstStep) {
+    std::pair<double, double> nBytes = calc_step_traffic(neutrals, ions);
+    std::ostringstream note;
+    if (IsFused) {
+      note << input.get_column_fusion() << " columns at a time, ~"
+	   << long(nBytes.first / (1024 * 1024))
+	   << " MB/step (estimated) a stage at a time";
+      report.set_nBytes(iFunction_fused, nBytes.second);
+      report.set_note(iFunction_fused, note.str());
+    } else {
+      note << "~" << long(nBytes.second / (1024 * 1024))
+	   << " MB/step (estimated) with #column_fusion";
+      report.set_nBytes(iFunction_stages, nBytes.first);
+      report.set_note(iFunction_stages, note.str());
+    }
+  }
+
+  if (IsFused) {
+    iErr = advance_columns(planet, gGrid, time, euv, neutrals, ions,
+			   chemistry, indices, input, workers, parallel,
+			   scheduler, report);
+    report.exit(function_fused);
+  } else {
+    iErr = advance_stages(planet, gGrid, time, euv, neutrals, ions,
+			  chemistry, indices, input, workers, parallel,
+			  scheduler, report);
+    report.exit(function_stages);
+  }
 
-  chemistry.calc_chemistry(neutrals, ions, time, gGrid, report); 
-  
   time.increment_time();
 
-  iErr = output(neutrals, ions, gGrid, time, planet, input, report);
+  nAllocations = get_nAllocations() - nAllocations;
+  if (is_counting_allocations() && !IsFirstStep && nAllocations > 0) {
+    std::cout << "advance : the time step did " << nAllocations
+	      << " heap allocations!!!\n";
+    iErr = 1;
+  }
+  IsFirstStep = 0;
+
+  // The output has its own times (#output), so it is checked every step:
+  if (scheduler.is_due(Scheduler::output_process, time)) {
+    scheduler.start(Scheduler::output_process, report);
+    int iErrOutput =
+      output(neutrals, ions, gGrid, time, planet, input, parallel, report);
+    if (iErrOutput > 0) iErr = iErrOutput;
+    scheduler.stop(Scheduler::output_process, time, 1, report);
+  }
 
   report.exit(function);
   return iErr;
@@ -0,0 +1,63 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+#include "../include/allocations.h"
+
+#ifdef AETHER_COUNT_ALLOCATIONS
+
+static std::atomic<long> nAllocations(0);
+
+// -----------------------------------------------------------------------------
+// Replace the global new and delete with ones that count
+// -----------------------------------------------------------------------------
+
+void *operator new(std::size_t nBytes) {
+  nAllocations++;
+  void *memory = malloc(nBytes > 0 ? nBytes : 1);
+  if (memory == NULL) throw std::bad_alloc();
+  return memory;
+}
+
+void *operator new[](std::size_t nBytes) {
+  return operator new(nBytes);
+}
+
+void operator delete(void *memory) noexcept {
+  free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+  free(memory);
+}
+
+void operator delete(void *memory, std::size_t nBytes) noexcept {
+  free(memory);
+}
+
+void operator delete[](void *memory, std::size_t nBytes) noexcept {
+  free(memory);
+}
+
+int is_counting_allocations() {
+  return 1;
+}
+
+long get_nAllocations() {
+  return nAllocations;
+}
+
+#else
+
+int is_counting_allocations() {
+  return 0;
+}
+
+long get_nAllocations() {
+  return 0;
+}
+
+#endif
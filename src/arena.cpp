@@ -0,0 +1,239 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+
+#include "../include/inputs.h"
+#include "../include/report.h"
+#include "../include/arena.h"
+
+// -----------------------------------------------------------------------------
+// Initialize the arena.  No memory is taken until the first field.
+// -----------------------------------------------------------------------------
+
+Arena::Arena(const Inputs &input, Report &report) {
+
+  UseHugePages = input.get_use_huge_pages();
+
+  // Slabs are a bunch of huge pages, so that a slab never shares a
+  // huge page with something else:
+  slab_size = 8 * huge_page;
+
+  nFields = 0;
+  nBytesFields = 0;
+
+  first_touch = nullptr;
+
+  if (UseHugePages) report.print(2, "Arena will use huge pages");
+
+  species_layout = separate_layout;
+  if (input.get_species_layout() == "species_major")
+    species_layout = species_major_layout;
+  if (input.get_species_layout() == "interleaved")
+    species_layout = interleaved_layout;
+
+  report.print(2, "Arena species layout : " + input.get_species_layout());
+
+}
+
+// -----------------------------------------------------------------------------
+// Free all of the slabs.  All of the fields are gone after this!
+// -----------------------------------------------------------------------------
+
+Arena::~Arena() {
+
+  for (int iSlab = 0; iSlab < slabs.size(); iSlab++)
+    free(slabs[iSlab].start);
+  slabs.clear();
+
+}
+
+// -----------------------------------------------------------------------------
+// Set how new fields are touched for the first time (see arena.h)
+// -----------------------------------------------------------------------------
+
+void Arena::set_first_touch(touch_function toucher) {
+  first_touch = toucher;
+}
+
+// -----------------------------------------------------------------------------
+// Get a new slab that can hold at least nBytesNeeded
+// -----------------------------------------------------------------------------
+
+Arena::slab_struct Arena::new_slab(long nBytesNeeded) {
+
+  slab_struct slab;
+  void *start = NULL;
+
+  slab.nBytes = slab_size;
+  if (nBytesNeeded > slab.nBytes)
+    slab.nBytes = ((nBytesNeeded + huge_page - 1) / huge_page) * huge_page;
+  slab.nBytesUsed = 0;
+
+  long slab_alignment = alignment;
+  if (UseHugePages) slab_alignment = huge_page;
+
+  if (posix_memalign(&start, slab_alignment, slab.nBytes) != 0) {
+    std::cout << "Arena::new_slab : could not allocate "
+	      << slab.nBytes << " bytes!!!\n";
+    start = NULL;
+    slab.nBytes = 0;
+  }
+
+#ifdef MADV_HUGEPAGE
+  // This is only advice, so if the kernel can't do it, that is ok:
+  if (UseHugePages && start != NULL)
+    madvise(start, slab.nBytes, MADV_HUGEPAGE);
+#endif
+
+  slab.start = (char*) start;
+
+  return slab;
+
+}
+
+// -----------------------------------------------------------------------------
+// Get a new field with nPoints * nValuesPerPoint floats.  The field is
+// zeroed by the first touch function.
+// -----------------------------------------------------------------------------
+
+float *Arena::allocate(long nPoints, long nValuesPerPoint) {
+
+  float *field =
+    (float*) allocate_bytes(nPoints * nValuesPerPoint * sizeof(float));
+
+  if (field == NULL) return NULL;
+
+  zero(field, nPoints, nValuesPerPoint);
+
+  nFields++;
+
+  return field;
+
+}
+
+// -----------------------------------------------------------------------------
+// Zero a new field with the first touch function, if there is one
+// -----------------------------------------------------------------------------
+
+void Arena::zero(float *field, long nPoints, long nValuesPerPoint) {
+
+  if (first_touch)
+    first_touch(field, nPoints, nValuesPerPoint);
+  else
+    memset(field, 0, nPoints * nValuesPerPoint * sizeof(float));
+
+}
+
+// -----------------------------------------------------------------------------
+// Get a zeroed array of indices
+// -----------------------------------------------------------------------------
+
+long *Arena::allocate_indices(long nIndices) {
+
+  long *indices = (long*) allocate_bytes(nIndices * sizeof(long));
+
+  if (indices != NULL) memset(indices, 0, nIndices * sizeof(long));
+
+  return indices;
+
+}
+
+// -----------------------------------------------------------------------------
+// Take nBytes (rounded up to the alignment) out of the current slab,
+// getting a new slab if it doesn't fit.
+// -----------------------------------------------------------------------------
+
+char *Arena::allocate_bytes(long nBytes) {
+
+  // Round up, so that the next field is aligned too:
+  nBytes = ((nBytes + alignment - 1) / alignment) * alignment;
+
+  if (slabs.size() == 0 ||
+      slabs.back().nBytesUsed + nBytes > slabs.back().nBytes)
+    slabs.push_back(new_slab(nBytes));
+
+  slab_struct &slab = slabs.back();
+
+  if (slab.start == NULL) return NULL;
+
+  char *start = slab.start + slab.nBytesUsed;
+  slab.nBytesUsed = slab.nBytesUsed + nBytes;
+  nBytesFields = nBytesFields + nBytes;
+
+  return start;
+
+}
+
+// -----------------------------------------------------------------------------
+// Get nTotalSpecies fields of nPoints each, in the species layout.  Returns
+// the stride between grid points.
+// -----------------------------------------------------------------------------
+
+long Arena::allocate_species(long nPoints,
+			     long nTotalSpecies,
+			     std::vector<float*> &fields) {
+
+  long iSpecies, stride = 1;
+  float *tensor;
+
+  fields.resize(nTotalSpecies);
+
+  if (species_layout == species_major_layout) {
+    // Pad each species out to a cache line, so they are all aligned:
+    long nPointsPadded = alignment / sizeof(float);
+    nPointsPadded = ((nPoints + nPointsPadded - 1) / nPointsPadded) *
+      nPointsPadded;
+    // Each species is a field of its own (not nTotalSpecies values
+    // per point), so each one is touched by the threads that own its
+    // columns.  The padding is just zeroed:
+    tensor = (float*) allocate_bytes(nPointsPadded * nTotalSpecies *
+				     sizeof(float));
+    for (iSpecies = 0; iSpecies < nTotalSpecies; iSpecies++) {
+      fields[iSpecies] = tensor + iSpecies * nPointsPadded;
+      if (tensor == NULL) continue;
+      zero(fields[iSpecies], nPoints, 1);
+      memset(fields[iSpecies] + nPoints, 0,
+	     (nPointsPadded - nPoints) * sizeof(float));
+    }
+    if (tensor != NULL) nFields++;
+  } else if (species_layout == interleaved_layout) {
+    tensor = allocate(nPoints, nTotalSpecies);
+    for (iSpecies = 0; iSpecies < nTotalSpecies; iSpecies++)
+      fields[iSpecies] = tensor + iSpecies;
+    stride = nTotalSpecies;
+  } else {
+    for (iSpecies = 0; iSpecies < nTotalSpecies; iSpecies++)
+      fields[iSpecies] = allocate(nPoints);
+  }
+
+  return stride;
+
+}
+
+// -----------------------------------------------------------------------------
+// Which species layout the arena uses (see arena.h)
+// -----------------------------------------------------------------------------
+
+int Arena::get_species_layout() {
+  return species_layout;
+}
+
+// -----------------------------------------------------------------------------
+// Number of bytes in all of the fields
+// -----------------------------------------------------------------------------
+
+long Arena::get_nBytes() {
+  return nBytesFields;
+}
+
+// -----------------------------------------------------------------------------
+// Number of fields
+// -----------------------------------------------------------------------------
+
+long Arena::get_nFields() {
+  return nFields;
+}
@@ -0,0 +1,711 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+#include "../include/sizes.h"
+#include "../include/solvers.h"
+#include "../include/report.h"
+#include "../include/workers.h"
+#include "../include/neutrals.h"
+#include "../include/constants.h"
+
+// -----------------------------------------------------------------------------
+// Wall time in seconds since the given start:
+// -----------------------------------------------------------------------------
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// -----------------------------------------------------------------------------
+// Time the conduction solver on a thermosphere-like column, through
+// the compiled-for-this-size path and the generic (any size) path.
+// -----------------------------------------------------------------------------
+
+void bench_solver_conduction(long nAlts, long nColumns, Report &report) {
+
+  std::vector<float> temp(nAlts), lambda(nAlts), rhocv(nAlts);
+  std::vector<float> dalt_lower(nAlts), conduction(nAlts);
+  std::vector<float> r(nAlts), du12(nAlts), du22(nAlts);
+  float dt = 5.0;
+  long iAlt, iColumn;
+
+  for (iAlt = 0; iAlt < nAlts; iAlt++) {
+    temp[iAlt] = 200.0 + 600.0 * float(iAlt) / float(nAlts);
+    lambda[iAlt] = 5.6e-4 * 50.0 * 4.1e13;
+    rhocv[iAlt] = 1.0e-6 * 1.0e3 * 4.1e13;
+    dalt_lower[iAlt] = 2500.0;
+  }
+
+  // The grid does this once per altitude profile, so it isn't timed:
+  conduction_metrics(dalt_lower.data(), r.data(), du12.data(), du22.data(),
+		     nAlts);
+
+  std::string sizes = " (nAlts = " + std::to_string(nAlts) + ")";
+
+  std::string function = "solver_conduction" + sizes;
+  static int iFunction = -1;
+  report.enter(function, iFunction);
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  for (iColumn = 0; iColumn < nColumns; iColumn++) {
+    conduction.assign(nAlts, 0.0);
+    solver_conduction(temp.data(), lambda.data(), rhocv.data(), dt,
+		      r.data(), du12.data(), du22.data(),
+		      conduction.data(), nAlts);
+  }
+  double walltime = seconds_since(start);
+  report.exit(function);
+  std::cout << "solver_conduction" << sizes << " : "
+	    << nColumns / walltime << " columns/s\n";
+
+  function = "solver_conduction_generic" + sizes;
+  static int iFunctionGeneric = -1;
+  report.enter(function, iFunctionGeneric);
+  start = std::chrono::steady_clock::now();
+  for (iColumn = 0; iColumn < nColumns; iColumn++) {
+    conduction.assign(nAlts, 0.0);
+    solver_conduction_generic(temp.data(), lambda.data(), rhocv.data(), dt,
+			      r.data(), du12.data(), du22.data(),
+		      conduction.data(), nAlts);
+  }
+  walltime = seconds_since(start);
+  report.exit(function);
+  std::cout << "solver_conduction_generic" << sizes << " : "
+	    << nColumns / walltime << " columns/s\n";
+
+}
+
+// -----------------------------------------------------------------------------
+// Columns/s of calc_conduction's two ways of doing a block of
+// nPool columns (like a tile), over and over: one column at a time
+// (copy the column in, scale it by radius squared, solver_conduction,
+// copy dT/dt back out, which is how calc_conduction used to do it),
+// and nLanes columns at a time with solver_conduction_batch, straight
+// from the fields.  The difference is the largest difference in dT/dt
+// between the two.
+// -----------------------------------------------------------------------------
+
+template <int nLanes>
+double time_conduction_batch(std::vector<float> &temperature,
+			     std::vector<float> &kappa,
+			     std::vector<float> &rho_cv,
+			     std::vector<float> &conduction,
+			     std::vector<float> &radius_sq,
+			     std::vector<float> &r,
+			     std::vector<float> &du12,
+			     std::vector<float> &du22,
+			     float dt,
+			     long nAlts,
+			     long nPool,
+			     long nRepeats) {
+
+  conduction_batch_struct<nLanes> batch;
+  std::vector<float> work(2 * nLanes * nAlts);
+
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  for (long iRepeat = 0; iRepeat < nRepeats; iRepeat++) {
+    for (long iColumn = 0; iColumn < nPool; iColumn += nLanes) {
+      for (int iLane = 0; iLane < nLanes; iLane++) {
+	long index = (iColumn + iLane) * nAlts;
+	batch.temperature[iLane] = temperature.data() + index;
+	batch.kappa[iLane] = kappa.data() + index;
+	batch.rho_cv[iLane] = rho_cv.data() + index;
+	batch.conduction[iLane] = conduction.data() + index;
+	batch.radius_sq[iLane] = radius_sq.data();
+	batch.r[iLane] = r.data();
+	batch.du12[iLane] = du12.data();
+	batch.du22[iLane] = du22.data();
+      }
+      solver_conduction_batch(batch, dt, nAlts, work.data());
+    }
+  }
+  return seconds_since(start);
+
+}
+
+void bench_solver_conduction_batch(long nAlts, long nColumns,
+				   Report &report) {
+
+  // A multiple of 16, so all of the lanes are used:
+  const long nPool = 256;
+  long nRepeats = nColumns / nPool, iColumn, iAlt, index;
+  std::vector<float> temperature(nPool * nAlts), kappa(nPool * nAlts);
+  std::vector<float> rho_cv(nPool * nAlts), conduction(nPool * nAlts);
+  std::vector<float> reference(nPool * nAlts);
+  std::vector<float> radius_sq(nAlts), dalt_lower(nAlts, 2500.0);
+  std::vector<float> r(nAlts), du12(nAlts), du22(nAlts);
+  std::vector<float> temp(nAlts), lambda(nAlts), rhocv(nAlts), column(nAlts);
+  float dt = 5.0;
+
+  conduction_metrics(dalt_lower.data(), r.data(), du12.data(), du22.data(),
+		     nAlts);
+
+  // A thermosphere-like column, with enough curvature in the
+  // temperature (and little enough rho * cv) that the conduction isn't
+  // just round off:
+  for (iColumn = 0; iColumn < nPool; iColumn++)
+    for (iAlt = 0; iAlt < nAlts; iAlt++) {
+      index = iColumn * nAlts + iAlt;
+      temperature[index] = 1000.0 - 800.0 * exp(-iAlt / 15.0) +
+	0.1 * iColumn;
+      kappa[index] = 5.6e-4 * pow(temperature[index], 0.69);
+      rho_cv[index] = 1.0e-9 * exp(-iAlt / 10.0);
+      radius_sq[iAlt] = 4.1e13;
+    }
+
+  nColumns = nRepeats * nPool;
+  std::string sizes = " (nAlts = " + std::to_string(nAlts) + ")";
+
+  std::string function = "conduction_by_column" + sizes;
+  static int iFunction = -1;
+  report.enter(function, iFunction);
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  for (long iRepeat = 0; iRepeat < nRepeats; iRepeat++) {
+    for (iColumn = 0; iColumn < nPool; iColumn++) {
+      for (iAlt = 0; iAlt < nAlts; iAlt++) {
+	index = iColumn * nAlts + iAlt;
+	rhocv[iAlt] = rho_cv[index] * radius_sq[iAlt];
+	lambda[iAlt] = kappa[index] * radius_sq[iAlt];
+	temp[iAlt] = temperature[index];
+	column[iAlt] = 0.0;
+      }
+      solver_conduction(temp.data(), lambda.data(), rhocv.data(), dt,
+			r.data(), du12.data(), du22.data(),
+			column.data(), nAlts);
+      for (iAlt = 0; iAlt < nAlts; iAlt++)
+	reference[iColumn * nAlts + iAlt] = column[iAlt] / dt;
+    }
+  }
+  double walltime_column = seconds_since(start);
+  report.exit(function);
+
+  function = "solver_conduction_batch<8>" + sizes;
+  static int iFunction8 = -1;
+  report.enter(function, iFunction8);
+  double walltime_8 =
+    time_conduction_batch<8>(temperature, kappa, rho_cv, conduction,
+			     radius_sq, r, du12, du22, dt, nAlts,
+			     nPool, nRepeats);
+  report.exit(function);
+
+  function = "solver_conduction_batch<16>" + sizes;
+  static int iFunction16 = -1;
+  report.enter(function, iFunction16);
+  double walltime_16 =
+    time_conduction_batch<16>(temperature, kappa, rho_cv, conduction,
+			      radius_sq, r, du12, du22, dt, nAlts,
+			      nPool, nRepeats);
+  report.exit(function);
+
+  double difference = 0.0, largest = 0.0;
+  for (index = 0; index < nPool * nAlts; index++) {
+    difference = std::max(difference,
+			  double(fabs(conduction[index] - reference[index])));
+    largest = std::max(largest, double(fabs(reference[index])));
+  }
+
+  std::cout << "conduction" << sizes << " : by column "
+	    << nColumns / walltime_column << " columns/s, batch<8> "
+	    << nColumns / walltime_8 << " columns/s, batch<16> "
+	    << nColumns / walltime_16 << " columns/s, speedup "
+	    << walltime_column / std::min(walltime_8, walltime_16)
+	    << ", difference " << difference / largest << "\n";
+
+}
+
+// -----------------------------------------------------------------------------
+// Strong scaling of the workers: the same grid (nLons x nLats x nAlts)
+// is split between 1, 2, 4, ... 64 threads, and each thread does a
+// column kernel like the model's (a power of the temperature and the
+// conduction solver) on its own tile.  The fields are first touched
+// by the threads that use them, like in the model.  On a machine with
+// fewer cores than threads, the efficiency will drop off after the
+// number of cores.
+// -----------------------------------------------------------------------------
+
+void bench_workers(long nLons, long nLats, long nAlts, long nSteps,
+		   Report &report) {
+
+  grid_extents extents(nLons, nLats, nAlts, nGeoGhosts);
+  long nAltsG = extents.nAltsG;
+  long nPoints = extents.nPointsG;
+
+  std::vector<float> dalt_lower(nAltsG, 2500.0);
+  std::vector<float> r(nAltsG), du12(nAltsG), du22(nAltsG);
+  conduction_metrics(dalt_lower.data(), r.data(), du12.data(), du22.data(),
+		     nAltsG);
+
+  std::cout << "Workers scaling (" << nLons << " x " << nLats << " x "
+	    << nAlts << ", " << std::thread::hardware_concurrency()
+	    << " cores) :\n";
+
+  double walltime_one = 0.0;
+
+  for (int nThreads = 1; nThreads <= 64; nThreads = nThreads * 2) {
+
+    Workers workers(nThreads, extents, report);
+
+    // Not a std::vector, since that would touch all of the memory here:
+    std::unique_ptr<float[]> temperature_s3gc(new float[nPoints]);
+    std::unique_ptr<float[]> kappa_s3gc(new float[nPoints]);
+    std::unique_ptr<float[]> conduction_s3gc(new float[nPoints]);
+    workers.first_touch(temperature_s3gc.get(), nPoints, 1);
+    workers.first_touch(kappa_s3gc.get(), nPoints, 1);
+    workers.first_touch(conduction_s3gc.get(), nPoints, 1);
+
+    Field3D<float> temperature(temperature_s3gc.get(), extents);
+
+    workers.run([&](const tile_struct &tile, int iThread) {
+      for (column_struct column : temperature.columns(tile))
+	for (long iAlt = 0; iAlt < nAltsG; iAlt++)
+	  temperature(column.iLon, column.iLat, iAlt) =
+	    200.0 + 600.0 * float(iAlt) / float(nAltsG);
+    });
+
+    std::string function =
+      "bench_workers (nThreads = " + std::to_string(nThreads) + ")";
+    static int iFunction = -1;
+    report.enter(function, iFunction);
+    std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+
+    for (long iStep = 0; iStep < nSteps; iStep++) {
+      workers.run([&](const tile_struct &tile, int iThread) {
+	std::vector<float> rhocv(nAltsG, 1.0e-6 * 1.0e3 * 4.1e13);
+	std::vector<float> lambda(nAltsG);
+	for (column_struct column : temperature.columns(tile)) {
+	  float *temp = temperature.column(column.iLon, column.iLat);
+	  float *kappa = kappa_s3gc.get() +
+	    temperature.index(column.iLon, column.iLat, 0);
+	  float *conduction = conduction_s3gc.get() +
+	    temperature.index(column.iLon, column.iLat, 0);
+	  for (long iAlt = 0; iAlt < nAltsG; iAlt++) {
+	    kappa[iAlt] = 5.6e-4 * pow(temp[iAlt], 0.69);
+	    lambda[iAlt] = kappa[iAlt] * 4.1e13;
+	  }
+	  solver_conduction(temp, lambda.data(), rhocv.data(), 5.0,
+			    r.data(), du12.data(), du22.data(),
+			    conduction, nAltsG);
+	}
+      });
+    }
+
+    double walltime = seconds_since(start);
+    report.exit(function);
+    if (nThreads == 1) walltime_one = walltime;
+
+    std::cout << "  nThreads = " << workers.get_nThreads() << " : "
+	      << nSteps * extents.nColumnsG / walltime << " columns/s, "
+	      << "speedup " << walltime_one / walltime << ", "
+	      << "efficiency "
+	      << walltime_one / walltime / workers.get_nThreads() << "\n";
+
+  }
+
+}
+
+// -----------------------------------------------------------------------------
+// The nightside tangent points of a column, by walking down the column
+// from each altitude (how calc_chapman used to do it, which is
+// O(nAlts^2)), and by the sweep up the column in calc_tangent_points
+// (O(nAlts)).  This is for the columns past the terminator that are
+// still in the sun up high, which is where the walks are.
+// -----------------------------------------------------------------------------
+
+void bench_tangent_points(long nAlts, long nColumns, Report &report) {
+
+  long nGCs = nGeoGhosts, iAlt, iiAlt, iColumn, iSum = 0;
+  std::vector<float> radius(nAlts);
+  std::vector<long> iBelow(nAlts);
+  std::vector<double> dy(nAlts);
+  std::vector<float> szas(nColumns);
+  double y;
+
+  for (iAlt = 0; iAlt < nAlts; iAlt++)
+    radius[iAlt] = 6372.0e3 + 100.0e3 + 2500.0 * iAlt;
+  for (iColumn = 0; iColumn < nColumns; iColumn++)
+    szas[iColumn] = pi/2 + 0.4 * float(iColumn % 100) / 100.0;
+
+  std::string sizes = " (nAlts = " + std::to_string(nAlts) + ")";
+
+  std::string function = "tangent_points_walk" + sizes;
+  static int iFunction = -1;
+  report.enter(function, iFunction);
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  for (iColumn = 0; iColumn < nColumns; iColumn++) {
+    for (iAlt = nGCs; iAlt < nAlts; iAlt++) {
+      y = radius[iAlt] * fabs(cos(szas[iColumn] - pi/2));
+      iBelow[iAlt] = -1;
+      if (y > radius[nGCs]) {
+	iiAlt = iAlt;
+	while (radius[iiAlt-1] > y) iiAlt--;
+	iBelow[iAlt] = iiAlt - 1;
+	dy[iAlt] = y - radius[iiAlt - 1];
+      }
+      iSum = iSum + iBelow[iAlt];
+    }
+  }
+  double walltime_walk = seconds_since(start);
+  report.exit(function);
+
+  function = "tangent_points_sweep" + sizes;
+  static int iFunctionSweep = -1;
+  report.enter(function, iFunctionSweep);
+  start = std::chrono::steady_clock::now();
+  for (iColumn = 0; iColumn < nColumns; iColumn++) {
+    calc_tangent_points(radius.data(), szas[iColumn], nGCs, nAlts,
+			iBelow.data(), dy.data());
+    for (iAlt = nGCs; iAlt < nAlts; iAlt++) iSum = iSum - iBelow[iAlt];
+  }
+  double walltime_sweep = seconds_since(start);
+  report.exit(function);
+
+  // (iSum is 0 if they agree, and keeps the loops from being thrown
+  // away by the compiler)
+  std::cout << "tangent points" << sizes << " : walk "
+	    << nColumns / walltime_walk << " columns/s, sweep "
+	    << nColumns / walltime_sweep << " columns/s, speedup "
+	    << walltime_walk / walltime_sweep
+	    << (iSum == 0 ? "" : " (they don't agree!)") << "\n";
+
+}
+
+// -----------------------------------------------------------------------------
+// The dayside chapman integrals of a column (for one species), with
+// the erfc fit (#chapman exact) and with the table (#chapman table),
+// the way calc_chapman does them.  X goes from ~2000 at the bottom to
+// ~50 at the top, and the sza goes from 0 to 89 degrees.
+// -----------------------------------------------------------------------------
+
+void bench_chapman(long nAlts, long nColumns, Report &report) {
+
+  long iAlt, iColumn, iMu;
+  std::vector<double> xp(nAlts), integral(nAlts), erfcy(nAlts);
+  std::vector<float> chapman(nAlts);
+  std::vector<float> cos_szas(nColumns);
+  double y, weight, sum_exact = 0.0, sum_table = 0.0;
+  ChapmanTable table;
+
+  table.build();
+  for (iAlt = 0; iAlt < nAlts; iAlt++) {
+    xp[iAlt] = 2000.0 * exp(-3.7 * iAlt / nAlts);
+    integral[iAlt] = 1.0e20 * exp(-0.2 * iAlt);
+  }
+  for (iColumn = 0; iColumn < nColumns; iColumn++)
+    cos_szas[iColumn] = cos(89.0 * dtor * float(iColumn % 100) / 100.0);
+
+  std::string sizes = " (nAlts = " + std::to_string(nAlts) + ")";
+
+  std::string function = "chapman_exact" + sizes;
+  static int iFunction = -1;
+  report.enter(function, iFunction);
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  for (iColumn = 0; iColumn < nColumns; iColumn++) {
+    for (iAlt = 0; iAlt < nAlts; iAlt++) {
+      y = sqrt(0.5 * xp[iAlt]) * fabs(cos_szas[iColumn]);
+      erfcy[iAlt] = chapman_erfc(y);
+    }
+    for (iAlt = 0; iAlt < nAlts; iAlt++)
+      chapman[iAlt] = integral[iAlt] * sqrt(0.5 * pi * xp[iAlt]) * erfcy[iAlt];
+    sum_exact = sum_exact + chapman[nAlts / 2];
+  }
+  double walltime_exact = seconds_since(start);
+  report.exit(function);
+
+  function = "chapman_table" + sizes;
+  static int iFunctionTable = -1;
+  report.enter(function, iFunctionTable);
+  start = std::chrono::steady_clock::now();
+  for (iColumn = 0; iColumn < nColumns; iColumn++) {
+    table.find_mu(cos_szas[iColumn], iMu, weight);
+    for (iAlt = 0; iAlt < nAlts; iAlt++)
+      chapman[iAlt] = integral[iAlt] * table.lookup(xp[iAlt], iMu, weight);
+    sum_table = sum_table + chapman[nAlts / 2];
+  }
+  double walltime_table = seconds_since(start);
+  report.exit(function);
+
+  std::cout << "chapman" << sizes << " : exact "
+	    << nColumns / walltime_exact << " columns/s, table "
+	    << nColumns / walltime_table << " columns/s, speedup "
+	    << walltime_exact / walltime_table << ", difference "
+	    << fabs(sum_table / sum_exact - 1.0) << "\n";
+
+}
+
+// -----------------------------------------------------------------------------
+// A step like the model's, done a stage at a time (each stage goes over
+// the whole grid with the workers before the next one starts) and with
+// column fusion (all of the stages on a block of columns before going
+// on to the next block, like advance_columns).  The stages are a power
+// of the temperature and rho * cv (thermodynamics), the conduction
+// solver, adding the sources to the temperature, and a chemistry-like
+// update of the densities.  Each way starts from the same state, so
+// they should give the same answers.  The traffic is counted like in
+// calc_step_traffic (in advance.cpp): the fields that each stage uses
+// a stage at a time, or the fields that the step uses when fused.
+// -----------------------------------------------------------------------------
+
+void bench_column_fusion(long nLons, long nLats, long nAlts, long nSteps,
+			 Report &report) {
+
+  const long nDensities = 6;
+  grid_extents extents(nLons, nLats, nAlts, nGeoGhosts);
+  long nAltsG = extents.nAltsG;
+  long nPoints = extents.nPointsG;
+  float dt = 5.0;
+
+  Workers workers(std::thread::hardware_concurrency(), extents, report);
+  int nThreads = workers.get_nThreads();
+
+  std::vector<float> dalt_lower(nAltsG, 2500.0);
+  std::vector<float> r(nAltsG), du12(nAltsG), du22(nAltsG);
+  conduction_metrics(dalt_lower.data(), r.data(), du12.data(), du22.data(),
+		     nAltsG);
+  std::vector<float> lambda(nThreads * nAltsG), rhocv(nThreads * nAltsG);
+
+  // temperature, kappa, rho_cv, conduction, heating, then the
+  // densities and their production.  Not std::vectors, so that the
+  // workers touch them first:
+  const long nFields = 5 + 2 * nDensities;
+  std::vector<std::unique_ptr<float[]>> fields(nFields);
+  for (long iField = 0; iField < nFields; iField++) {
+    fields[iField].reset(new float[nPoints]);
+    workers.first_touch(fields[iField].get(), nPoints, 1);
+  }
+  float *temperature_s3gc = fields[0].get();
+  Field3D<float> temperature(temperature_s3gc, extents);
+  float *kappa_s3gc = fields[1].get();
+  float *rho_cv_s3gc = fields[2].get();
+  float *conduction_s3gc = fields[3].get();
+  float *heating_s3gc = fields[4].get();
+  float *density_s3gc[nDensities], *production_s3gc[nDensities];
+  for (long iDensity = 0; iDensity < nDensities; iDensity++) {
+    density_s3gc[iDensity] = fields[5 + iDensity].get();
+    production_s3gc[iDensity] = fields[5 + nDensities + iDensity].get();
+  }
+
+  // The fields each stage uses, and the ones the step uses:
+  long nFieldsStaged = (3 + nDensities) + 4 + 4 + (1 + 2 * nDensities);
+  double nBytesStaged = double(nFieldsStaged) * nPoints * sizeof(float);
+  double nBytesFused = double(nFields) * nPoints * sizeof(float);
+
+  auto initialize = [&](const tile_struct &tile, int iThread) {
+    for (column_struct column : temperature.columns(tile))
+      for (long iAlt = 0; iAlt < nAltsG; iAlt++) {
+	long index = temperature.index(column.iLon, column.iLat, iAlt);
+	temperature_s3gc[index] = 1000.0 - 800.0 * exp(-iAlt / 15.0) +
+	  0.1 * column.iLat;
+	kappa_s3gc[index] = 0.0;
+	rho_cv_s3gc[index] = 0.0;
+	conduction_s3gc[index] = 0.0;
+	heating_s3gc[index] = 1.0e-9 * exp(-iAlt / 10.0);
+	for (long iDensity = 0; iDensity < nDensities; iDensity++) {
+	  density_s3gc[iDensity][index] =
+	    1.0e17 * exp(-iAlt / (8.0 + iDensity));
+	  production_s3gc[iDensity][index] = 1.0e9 * exp(-iAlt / 20.0);
+	}
+      }
+  };
+
+  // The stages, each on the columns of a tile (or a block):
+  auto thermodynamics = [&](const tile_struct &tile, int iThread) {
+    for (column_struct column : temperature.columns(tile)) {
+      long index = temperature.index(column.iLon, column.iLat, 0);
+      for (long iAlt = 0; iAlt < nAltsG; iAlt++, index++) {
+	float rho = 0.0;
+	for (long iDensity = 0; iDensity < nDensities; iDensity++)
+	  rho += density_s3gc[iDensity][index] * (16.0 + iDensity) * amu;
+	kappa_s3gc[index] = 5.6e-4 * pow(temperature_s3gc[index], 0.69);
+	rho_cv_s3gc[index] = 1.5 * boltzmanns_constant / (16.0 * amu) * rho;
+      }
+    }
+  };
+
+  auto conduction = [&](const tile_struct &tile, int iThread) {
+    float *lambda_thread = lambda.data() + iThread * nAltsG;
+    float *rhocv_thread = rhocv.data() + iThread * nAltsG;
+    for (column_struct column : temperature.columns(tile)) {
+      long index = temperature.index(column.iLon, column.iLat, 0);
+      for (long iAlt = 0; iAlt < nAltsG; iAlt++) {
+	lambda_thread[iAlt] = kappa_s3gc[index + iAlt] * 4.1e13;
+	rhocv_thread[iAlt] = rho_cv_s3gc[index + iAlt] * 4.1e13;
+	conduction_s3gc[index + iAlt] = 0.0;
+      }
+      solver_conduction(temperature.column(column.iLon, column.iLat),
+			lambda_thread, rhocv_thread, dt,
+			r.data(), du12.data(), du22.data(),
+			conduction_s3gc + index, nAltsG);
+    }
+  };
+
+  auto add_sources = [&](const tile_struct &tile, int iThread) {
+    for (column_struct column : temperature.columns(tile)) {
+      long index = temperature.index(column.iLon, column.iLat, 0);
+      for (long iAlt = 0; iAlt < nAltsG; iAlt++, index++)
+	temperature_s3gc[index] += conduction_s3gc[index] +
+	  dt * heating_s3gc[index] / rho_cv_s3gc[index];
+    }
+  };
+
+  auto chemistry = [&](const tile_struct &tile, int iThread) {
+    float loss[nDensities];
+    for (column_struct column : temperature.columns(tile)) {
+      long index = temperature.index(column.iLon, column.iLat, 0);
+      for (long iAlt = 0; iAlt < nAltsG; iAlt++, index++) {
+	float rate = 1.0e-24 * sqrt(temperature_s3gc[index] / 300.0);
+	for (long iDensity = 0; iDensity < nDensities; iDensity++)
+	  loss[iDensity] = rate * density_s3gc[iDensity][index] *
+	    density_s3gc[(iDensity + 1) % nDensities][index];
+	for (long iDensity = 0; iDensity < nDensities; iDensity++)
+	  density_s3gc[iDensity][index] +=
+	    dt * (production_s3gc[iDensity][index] - loss[iDensity]);
+      }
+    }
+  };
+
+  std::string sizes = " (" + std::to_string(nLons) + " x " +
+    std::to_string(nLats) + " x " + std::to_string(nAlts) + ", " +
+    std::to_string(nThreads) + " threads)";
+
+  // A stage at a time, which is the answer to compare to:
+  workers.run(initialize);
+  std::string function = "column_fusion (a stage at a time)" + sizes;
+  static int iFunctionStaged = -1;
+  report.enter(function, iFunctionStaged);
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  for (long iStep = 0; iStep < nSteps; iStep++) {
+    workers.run(thermodynamics);
+    workers.run(conduction);
+    workers.run(add_sources);
+    workers.run(chemistry);
+  }
+  double walltime_staged = seconds_since(start);
+  report.exit(function);
+
+  std::vector<std::vector<float>> reference(nFields);
+  for (long iField = 0; iField < nFields; iField++)
+    reference[iField].assign(fields[iField].get(),
+			     fields[iField].get() + nPoints);
+
+  std::cout << "column_fusion" << sizes << " :\n"
+	    << "  a stage at a time : "
+	    << 1000.0 * walltime_staged / nSteps << " ms/step, ~"
+	    << nBytesStaged / (1024 * 1024) << " MB/step, ~"
+	    << nBytesStaged * nSteps / walltime_staged / 1.0e9 << " GB/s\n";
+
+  // Fused, in blocks of nColumns lats at one lon (like run_blocks in
+  // advance.cpp):
+  for (long nColumns : {1, 4, 16}) {
+
+    workers.run(initialize);
+    function = "column_fusion (" + std::to_string(nColumns) +
+      " columns)" + sizes;
+    static int iFunctionFused = -1;
+    report.enter(function, iFunctionFused);
+    start = std::chrono::steady_clock::now();
+    for (long iStep = 0; iStep < nSteps; iStep++) {
+      workers.run([&](const tile_struct &tile, int iThread) {
+	tile_struct block;
+	for (long iLon = tile.iLonStart; iLon < tile.iLonEnd; iLon++)
+	  for (long iLat = tile.iLatStart; iLat < tile.iLatEnd;
+	       iLat += nColumns) {
+	    block.iLonStart = iLon;
+	    block.iLonEnd = iLon + 1;
+	    block.iLatStart = iLat;
+	    block.iLatEnd = std::min(iLat + nColumns, tile.iLatEnd);
+	    thermodynamics(block, iThread);
+	    conduction(block, iThread);
+	    add_sources(block, iThread);
+	    chemistry(block, iThread);
+	  }
+      });
+    }
+    double walltime = seconds_since(start);
+    report.exit(function);
+
+    double difference = 0.0;
+    for (long iField = 0; iField < nFields; iField++)
+      for (long index = 0; index < nPoints; index++)
+	if (reference[iField][index] != 0.0)
+	  difference =
+	    std::max(difference,
+		     double(fabs(fields[iField][index] /
+				 reference[iField][index] - 1.0)));
+
+    std::cout << "  " << nColumns << " columns at a time : "
+	      << 1000.0 * walltime / nSteps << " ms/step, ~"
+	      << nBytesFused / (1024 * 1024) << " MB/step, ~"
+	      << nBytesFused * nSteps / walltime / 1.0e9 << " GB/s, speedup "
+	      << walltime_staged / walltime << ", difference "
+	      << difference << "\n";
+
+  }
+
+}
+
+int main() {
+
+  int iErr = 0;
+  Report report;
+
+  // ------------------------------------------------------------
+  // Column solvers for the common grid sizes:
+  // ------------------------------------------------------------
+
+  bench_solver_conduction(50 + 2 * nGeoGhosts, 200000, report);
+  bench_solver_conduction(100 + 2 * nGeoGhosts, 100000, report);
+
+  // ------------------------------------------------------------
+  // calc_conduction, a column at a time and batched:
+  // ------------------------------------------------------------
+
+  bench_solver_conduction_batch(50 + 2 * nGeoGhosts, 200000, report);
+  bench_solver_conduction_batch(100 + 2 * nGeoGhosts, 100000, report);
+
+  // ------------------------------------------------------------
+  // Nightside chapman tangent points:
+  // ------------------------------------------------------------
+
+  bench_tangent_points(50 + 2 * nGeoGhosts, 200000, report);
+  bench_tangent_points(200 + 2 * nGeoGhosts, 50000, report);
+
+  // ------------------------------------------------------------
+  // Dayside chapman integrals, with the fit and the table:
+  // ------------------------------------------------------------
+
+  bench_chapman(50 + 2 * nGeoGhosts, 200000, report);
+
+  // ------------------------------------------------------------
+  // Shared-memory scaling over a 2 degree grid:
+  // ------------------------------------------------------------
+
+  bench_workers(180, 90, 50, 5, report);
+
+  // ------------------------------------------------------------
+  // A step a stage at a time and with column fusion, on the same grid:
+  // ------------------------------------------------------------
+
+  bench_column_fusion(180, 90, 50, 10, report);
+
+  report.times();
+
+  return iErr;
+
+}
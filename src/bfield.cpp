@@ -10,11 +10,11 @@
 bfield_info_type get_bfield(float lon,
 			    float lat,
 			    float alt,
-			    Planets planet,
-			    Inputs input,
+			    const Planets &planet,
+			    const Inputs &input,
 			    Report &report) {
 
-  std::string function = "get_bfield";
+  static std::string function = "get_bfield";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
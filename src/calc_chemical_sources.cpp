@@ -3,81 +3,44 @@
 
 #include <iostream>
 
-#include "../include/report.h"
 #include "../include/chemistry.h"
 
-void Chemistry::calc_chemical_sources(float *neutral_density,
-				      float *ion_density,
-				      float Tn,
-				      float Ti,
-				      float Te,
-				      Report &report) {
+void Chemistry::calc_chemical_sources(const float *density,
+				      sources_and_losses_type
+				      &sources_and_losses) const {
 
-  std::string function = "Chemistry::calc_chemical_sources";
-  static int iFunction = -1;
-  report.enter(function, iFunction);  
+  // This is called at every grid point, from many threads at once, so
+  // it doesn't go through the report.  The tables are compiled in
+  // compile_reactions, so each reaction is a product of its reactants
+  // (gathered from density), and then added to its sources and losses
+  // (scattered into the values), with nothing to check on the way:
 
-  long iReaction, iLoss, iSource;
-  float change, rate;
-  int IsNeutral, id_;
-  
-  for (iReaction = 0; iReaction < nReactions; iReaction++) {
-
-    // std::cout << "iReaction : " << iReaction << " " << nReactions << "\n";
-    // display_reaction(reactions[iReaction]);
-    
-    // First calculate reaction rate:
-
-    rate = reactions[iReaction].rate;
-
-    // Second calculate the amount of change:
-
-    change = rate;
-    for (iLoss = 0; iLoss < reactions[iReaction].nLosses; iLoss++) {
-
-      IsNeutral = reactions[iReaction].losses_IsNeutral[iLoss];
-      id_ = reactions[iReaction].losses_ids[iLoss];
-      
-      if (IsNeutral) change = change * neutral_density[id_];
-      else change = change * ion_density[id_];
-      
-    }
+  const float *rates = reaction_rates.data();
+  const int *reactant_first = reactant_start.data();
+  const int *reactant = reactant_ids.data();
+  const int *target_first = target_start.data();
+  const int *target = target_ids.data();
+  const float *coef = target_coefs.data();
+  float *values = sources_and_losses.values;
 
-    // Third add change to the different consituents:
+  long iReaction, iReactant, iTarget;
+  float change;
 
-    for (iLoss = 0; iLoss < reactions[iReaction].nLosses; iLoss++) {
-
-      IsNeutral = reactions[iReaction].losses_IsNeutral[iLoss];
-      id_ = reactions[iReaction].losses_ids[iLoss];
-
-      if (IsNeutral)
-	sources_and_losses.neutral_losses[id_] = 
-	  sources_and_losses.neutral_losses[id_] + change;
-      else
-	sources_and_losses.ion_losses[id_] = 
-	  sources_and_losses.ion_losses[id_] + change;
-
-    }
+  for (iReaction = 0; iReaction < nReactions; iReaction++) {
 
-    for (iSource = 0; iSource < reactions[iReaction].nSources; iSource++) {
+    change = rates[iReaction];
+    for (iReactant = reactant_first[iReaction];
+	 iReactant < reactant_first[iReaction + 1];
+	 iReactant++)
+      change = change * density[reactant[iReactant]];
 
-      IsNeutral = reactions[iReaction].sources_IsNeutral[iSource];
-      id_ = reactions[iReaction].sources_ids[iSource];
-      
-      if (IsNeutral)
-	sources_and_losses.neutral_sources[id_] = 
-	  sources_and_losses.neutral_sources[id_] + change;
-      else
-	sources_and_losses.ion_sources[id_] = 
-	  sources_and_losses.ion_sources[id_] + change;
+    for (iTarget = target_first[iReaction];
+	 iTarget < target_first[iReaction + 1];
+	 iTarget++)
+      values[target[iTarget]] = values[target[iTarget]] + coef[iTarget] * change;
 
-    }
-    
   }
   
-  report.exit(function);
-
   return;
 
 }
-
@@ -2,6 +2,7 @@
 // Full license can be found in License.md
 
 #include <iostream>
+#include <algorithm>
 
 #include "../include/sizes.h"
 
@@ -13,79 +14,112 @@
 #include "../include/report.h"
 #include "../include/solvers.h"
 
+// -----------------------------------------------------------------------------
+// Do the chemistry for a step of dt, in nSubcycles sub-steps (see
+// Scheduler).  The sub-steps are all done in a cell before going on to
+// the next one.  This also finds the longest sub-step that the
+// chemistry can take next time (get_dt_limit).  Where the losses are
+// bigger than the sources, solver_chemistry is implicit, so it is fine
+// with any dt.  Where they aren't, it is explicit, so dt is limited so
+// that the density changes by less than chemistry_change (as a
+// fraction) in a sub-step.  Species that are a small part of the
+// total (neutral or ion) density are in equilibrium (and jump around
+// when the EUV changes), so their change is measured against
+// minor_fraction of the total, so they don't hold the whole model back.
+// -----------------------------------------------------------------------------
+
 void Chemistry::calc_chemistry(Neutrals &neutrals,
 			       Ions &ions,
-			       Times time,
-			       Grid grid,
+			       float dt_step,
+			       int nSubcycles,
+			       const Grid &grid,
+			       Workers &workers,
 			       Report &report) {
 
-  long nLons, nLats, nAlts, iLon, iLat, iAlt, index;
-  int iSpecies;
-
-  std::string function = "Chemistry::calc_chemistry";
+  static std::string function = "Chemistry::calc_chemistry";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
-  if (grid.get_IsGeoGrid()) {
-    nLons = nGeoLonsG;
-    nLats = nGeoLatsG;
-    nAlts = nGeoAltsG;
-  } else {
-    nLons = nMagLonsG;
-    nLats = nMagLatsG;
-    nAlts = nMagAltsG;
-  }
-
-  float neutral_density[nSpecies];
-  float ion_density[nIons+1];  // add one for electron density
-  float neutral_sources[nSpecies];
-  float neutral_losses[nSpecies];
-  float ion_sources[nIons];
-  float ion_losses[nIons];
-
-  float Tn, Te, Ti;
-
-  float dt = time.get_dt();
-  float old_density, source, loss, new_density;
-  float heat_neutrals, heat_ions, heat_electrons;
-  
   // ------------------------------------
   // Calculate electron densities
   // ------------------------------------
 
   ions.fill_electrons(grid, report);
 
+  prepare_chemistry(workers.get_nThreads());
+
+  workers.run([&](const tile_struct &tile, int iThread) {
+    calc_chemistry_columns(neutrals, ions, dt_step, nSubcycles, tile, iThread);
+  });
+
+  finish_chemistry(neutrals);
+  
+  report.exit(function);
+  return;
+}
+
+// Each thread finds the smallest time to change in the columns that
+// it does:
+
+void Chemistry::prepare_chemistry(int nThreads) {
+  dt_limit_scratch.resize(nThreads);
+  for (float &time_thread : dt_limit_scratch) time_thread = 1.0e30;
+}
+
+void Chemistry::calc_chemistry_columns(Neutrals &neutrals,
+				       Ions &ions,
+				       float dt_step,
+				       int nSubcycles,
+				       const tile_struct &tile,
+				       int iThread) {
+
+  long nAlts = ions.extents.nAltsG;
+
+  float dt = dt_step / nSubcycles;
+
+  Field3D<float> electrons(ions.density_s3gc, ions.extents);
+
+  const float minor_fraction = 0.1;
+
   // Don't do chemistry in the ghostcells!
 
-  for (iLon = 0; iLon < nLons; iLon++) {
-    for (iLat = 0; iLat < nLats; iLat++) {
-      for (iAlt = 0; iAlt < nAlts; iAlt++) {
+  long iAlt, index;
+  int iSpecies, iSubcycle;
 
-	if (grid.get_IsGeoGrid()) {
-	  index = ijk_geo_s3gc(iLon,iLat,iAlt);
-	} else {
-	  index = ijk_mag_s3gc(iLon,iLat,iAlt);
-	}
+  // All of the species at a grid point, in the order of the
+  // chemistry (see chemistry.h), with the electrons last:
+  float density[nChemSpecies];
+  float *ion_density = density + iFirstIon;
 
-	// Use the private variable sources_and_losses, so we don't
-	// have to pass it around
+  float old_density, source, loss;
+  float floor, time_to_change = dt_limit_scratch[iThread];
 
-	for (iSpecies=0; iSpecies < nSpecies; iSpecies++) {
-	  neutral_density[iSpecies] = neutrals.neutrals[iSpecies].density_s3gc[index];
-	  sources_and_losses.neutral_losses[iSpecies] = neutrals.neutrals[iSpecies].ionization_s3gc[index];
-	  sources_and_losses.neutral_sources[iSpecies] = 0.0;
-	}
+  // Each thread has its own sources and losses, so they can be
+  // filled in at the same time:
+  sources_and_losses_type sources_and_losses;
 
-	for (iSpecies=0; iSpecies < nIons; iSpecies++) {
-	  ion_density[iSpecies] = ions.species[iSpecies].density_s3gc[index];
-	  sources_and_losses.ion_sources[iSpecies] = ions.species[iSpecies].ionization_s3gc[index];
-	  sources_and_losses.ion_losses[iSpecies] = 0.0;
-	}
-	ion_density[nIons] = ions.density_s3gc[index];
+  for (column_struct column : electrons.columns(tile)) {
+    for (iAlt = 0; iAlt < nAlts; iAlt++) {
+
+      index = electrons.index(column.iLon, column.iLat, iAlt);
+
+      for (iSpecies=0; iSpecies < nSpecies; iSpecies++)
+	density[iSpecies] = neutrals.neutrals[iSpecies].density(index);
+      for (iSpecies=0; iSpecies < nIons; iSpecies++)
+	ion_density[iSpecies] = ions.species[iSpecies].density(index);
+      density[iElectrons] = ions.density_s3gc[index];
 
-	Tn = neutrals.temperature_s3gc[index];
-	Ti = ions.ion_temperature_s3gc[index];
-	Te = ions.electron_temperature_s3gc[index];
+      for (iSubcycle = 0; iSubcycle < nSubcycles; iSubcycle++) {
+
+	// The EUV takes away neutrals and makes ions:
+	for (iSpecies=0; iSpecies < nChemSpecies; iSpecies++) {
+	  sources_and_losses.loss(iSpecies) = 0.0;
+	  sources_and_losses.source(iSpecies) = 0.0;
+	}
+	for (iSpecies=0; iSpecies < nSpecies; iSpecies++)
+	  sources_and_losses.loss(iSpecies) = neutrals.neutrals[iSpecies].ionization_s3gc[index];
+	for (iSpecies=0; iSpecies < nIons; iSpecies++)
+	  sources_and_losses.source(iFirstIon + iSpecies) = ions.species[iSpecies].ionization_s3gc[index];
 
 	// If we wanted to do a higher-order solver, we would probably
 	// put it starting here: (If we do that, we may want to have a
@@ -93,31 +127,64 @@ void Chemistry::calc_chemistry(Neutrals &neutrals,
 	// this outside of the higher-order solver, since the reaction
 	// rates involve a lot of powers, which seem like there are
 	// quite slow in C.)
-	
-	calc_chemical_sources(neutral_density,
-			      ion_density,
-			      Tn, Ti, Te, report);
-	
+      
+	calc_chemical_sources(density, sources_and_losses);
+      
 	for (iSpecies=0; iSpecies < nSpecies; iSpecies++) {
-	  old_density = neutral_density[iSpecies];
-	  source = sources_and_losses.neutral_sources[iSpecies];
-	  loss = sources_and_losses.neutral_losses[iSpecies];
-	  neutrals.neutrals[iSpecies].density_s3gc[index] =
-	    solver_chemistry(old_density, source, loss, dt);
+	  old_density = density[iSpecies];
+	  source = sources_and_losses.source(iSpecies);
+	  loss = sources_and_losses.loss(iSpecies);
+	  density[iSpecies] = solver_chemistry(old_density, source, loss, dt);
+	  if (chemistry_change > 0.0 && source > loss) {
+	    floor = minor_fraction * neutrals.density_s3gc[index];
+	    time_to_change = std::min(time_to_change,
+				      std::max(old_density, floor) /
+				      (source - loss));
+	  }
 	}
 
-	for (iSpecies=0; iSpecies < nIons; iSpecies++) {
-	  old_density = ion_density[iSpecies];
-	  source = sources_and_losses.ion_sources[iSpecies];
-	  loss = sources_and_losses.ion_losses[iSpecies];
-	  ions.species[iSpecies].density_s3gc[index] =
-	    solver_chemistry(old_density, source, loss, dt);
+	for (iSpecies=iFirstIon; iSpecies < iElectrons; iSpecies++) {
+	  old_density = density[iSpecies];
+	  source = sources_and_losses.source(iSpecies);
+	  loss = sources_and_losses.loss(iSpecies);
+	  density[iSpecies] = solver_chemistry(old_density, source, loss, dt);
+	  if (chemistry_change > 0.0 && source > loss) {
+	    floor = minor_fraction * density[iElectrons];
+	    time_to_change = std::min(time_to_change,
+				      std::max(old_density, floor) /
+				      (source - loss));
+	  }
 	}
-	
+
+	// The electrons follow the ions (as in fill_electrons) for the
+	// next sub-step:
+	if (iSubcycle < nSubcycles - 1) {
+	  density[iElectrons] = 0.0;
+	  for (iSpecies=0; iSpecies < nIons; iSpecies++)
+	    density[iElectrons] = density[iElectrons] + ion_density[iSpecies];
+	}
+
       }
+
+      for (iSpecies=0; iSpecies < nSpecies; iSpecies++)
+	neutrals.neutrals[iSpecies].density(index) = density[iSpecies];
+      for (iSpecies=0; iSpecies < nIons; iSpecies++)
+	ions.species[iSpecies].density(index) = ion_density[iSpecies];
+      
     }
   }
-  
-  report.exit(function);
-  return;
+
+  dt_limit_scratch[iThread] = time_to_change;
+
+}
+
+void Chemistry::finish_chemistry(Neutrals &neutrals) {
+
+  dt_limit = 1.0e30;
+  if (chemistry_change > 0.0)
+    for (float time_thread : dt_limit_scratch)
+      dt_limit = std::min(dt_limit, chemistry_change * time_thread);
+
+  neutrals.state_changed();
+
 }
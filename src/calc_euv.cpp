@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <utility>
 
 #include "../include/times.h"
 #include "../include/inputs.h"
@@ -12,35 +13,70 @@
 #include "../include/neutrals.h"
 #include "../include/ions.h"
 
-int calc_euv( Planets planet,
-	      Grid grid,
-	      Times time,
+int calc_euv( Planets &planet,
+	      Grid &grid,
+	      const Times &time,
 	      Euv &euv,
 	      Neutrals &neutrals,
 	      Ions &ions,
-	      Indices indices,
-	      Inputs args,
+	      const Indices &indices,
+	      const Inputs &args,
+	      int IsDue,
+	      Workers &workers,
 	      Report &report) {
   
   int iErr=0;
   
-  if (time.check_time_gate(args.get_dt_euv())) {
+  if (IsDue) {
 
-    std::string function="Euv::calc_euv";
+    static std::string function="Euv::calc_euv";
     static int iFunction = -1;
     report.enter(function, iFunction);  
     
-    // Chapman integrals for EUV energy deposition:
-    neutrals.calc_chapman(grid, report);
-  
-    iErr = euv.euvac(time, indices, report);
-    iErr = euv.scale_from_1au(planet, time);
-  
-    neutrals.calc_ionization_heating(euv, ions, report);
+    // Keep an error from the spectrum (the #euv_model file can't be
+    // read), not just the one from scaling it:
+    iErr = euv.calc_spectrum(time, indices, report);
+    if (euv.scale_from_1au(planet, time) > 0) iErr = 1;
+
+    if (neutrals.euv_interpolation == "hold") {
+
+      // Chapman integrals for EUV energy deposition:
+      neutrals.calc_chapman(grid, workers, report);
+      neutrals.calc_ionization_heating(euv, ions, workers, report);
+
+    } else if (neutrals.euv_interpolation == "interpolate") {
+
+      // The sources for where the sun is now.  After the first time,
+      // these were done at the last update (for the sun at this one),
+      // so they just move over:
+      if (neutrals.euv_sources_next.time < 0.0) {
+	neutrals.calc_chapman(grid, workers, report);
+	neutrals.calc_ionization_heating(euv, ions, workers, report);
+	neutrals.save_euv_sources(neutrals.euv_sources_next,
+				  time.get_current(),
+				  workers);
+      }
+      std::swap(neutrals.euv_sources_then, neutrals.euv_sources_next);
+
+      // and for where the sun will be at the next update (with the
+      // densities of now, which don't change much in dt_euv).  The
+      // SZA is put back after:
+      grid.calc_sza(planet, time, workers, report, args.get_dt_euv());
+      neutrals.calc_chapman(grid, workers, report);
+      neutrals.calc_ionization_heating(euv, ions, workers, report);
+      neutrals.save_euv_sources(neutrals.euv_sources_next,
+				time.get_current() + args.get_dt_euv(),
+				workers);
+      grid.calc_sza(planet, time, workers, report);
+
+    }
 
     report.exit(function);
   }
 
+  if (neutrals.euv_interpolation == "interpolate")
+    neutrals.interpolate_euv_sources(time, workers, report);
+
   return iErr;
 
 }
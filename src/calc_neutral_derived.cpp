@@ -3,6 +3,8 @@
 
 #include <cmath>
 #include <iostream>
+#include <vector>
+#include <algorithm>
 
 #include "../include/constants.h"
 #include "../include/neutrals.h"
@@ -10,109 +12,260 @@
 #include "../include/report.h"
 #include "../include/time.h"
 #include "../include/solvers.h"
+#include "../include/fast_math.h"
 
 //----------------------------------------------------------------------
-//
+// All of the thermodynamic quantities that come from the species
+// densities and the temperature (the bulk density, rho, mean mass,
+// pressure, Cv, gamma, kappa, sound speed and rho * Cv).  This is done
+// in one pass, a column at a time, so each species density is only
+// read from memory once (the column is small enough to stay in the
+// cache while it is used over and over).  If nothing has called
+// state_changed() since the last time, everything is still good, so
+// this doesn't do anything.
 //----------------------------------------------------------------------
 
-void Neutrals::calc_mass_density(Report &report) {
+void Neutrals::calc_thermodynamics(Workers &workers, Report &report) {
 
-  long iLon, iLat, iAlt, index, iSpecies;
-
-  std::string function="Neutrals::calc_mass_density";
+  static std::string function="Neutrals::calc_thermodynamics";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
-  for (iLon = 0; iLon < nGeoLonsG; iLon++) {
-    for (iLat = 0; iLat < nGeoLatsG; iLat++) {
-      for (iAlt = 0; iAlt < nGeoAltsG; iAlt++) {
-	
-	index = ijk_geo_s3gc(iLon,iLat,iAlt);
-
-	density_s3gc[index] = 0.0;
-	rho_s3gc[index] = 0.0;
-
-	for (iSpecies=0; iSpecies < nSpecies; iSpecies++) {
-	  density_s3gc[index] = density_s3gc[index] +
-	    neutrals[iSpecies].density_s3gc[index];
-	  rho_s3gc[index] = rho_s3gc[index] +
-	    neutrals[iSpecies].mass *
-	    neutrals[iSpecies].density_s3gc[index];
+  if (!needs_thermodynamics()) {
+    report.exit(function);
+    return;
+  }
+
+  prepare_thermodynamics(workers.get_nThreads());
+
+  workers.run([&](const tile_struct &tile, int iThread) {
+    calc_thermodynamics_columns(tile, iThread);
+  });
+
+  iThermodynamicsVersion = iStateVersion;
+
+  report.exit(function);
+  return;
+  
+}
+
+void Neutrals::prepare_thermodynamics(int nThreads) {
+  thermodynamics_scratch.resize(nThreads * thermal_exp_groups.size() *
+				extents.nAltsG);
+}
+
+//----------------------------------------------------------------------
+// The thermodynamics of the columns of a tile.  The altitude loops are
+// on the inside, so that they can be vectorized.  (gcc won't vectorize
+// a loop with too many fields in it, so some are split up.  This
+// doesn't cost anything, since the column is in the cache.)
+//----------------------------------------------------------------------
+
+void Neutrals::calc_thermodynamics_columns(const tile_struct &tile,
+					   int iThread) {
+
+  long nAlts = extents.nAltsG;
+  long nGroups = thermal_exp_groups.size();
+
+  Field3D<float> temperature_field(temperature_s3gc, extents);
+
+  int IsTable = (thermal_conduction_method == "table");
+  int IsPow = (thermal_conduction_method == "pow");
+
+  long iAlt, iStart, iT, stride;
+  double r, x;
+  float mass, vibe, thermal_cond;
+  float *density, *rho, *mean_mass, *pressure, *Cv, *gamma, *kappa;
+  float *sound, *rho_cv, *temperature, *species_density;
+  double *t_to_p;
+  double *t_to_ps = thermodynamics_scratch.data() + iThread * nGroups * nAlts;
+
+  for (column_struct column : temperature_field.columns(tile)) {
+
+    // The fields in this column:
+    iStart = temperature_field.index(column.iLon, column.iLat, 0);
+    density = density_s3gc + iStart;
+    rho = rho_s3gc + iStart;
+    mean_mass = mean_major_mass_s3gc + iStart;
+    pressure = pressure_s3gc + iStart;
+    Cv = Cv_s3gc + iStart;
+    gamma = gamma_s3gc + iStart;
+    kappa = kappa_s3gc + iStart;
+    sound = sound_s3gc + iStart;
+    rho_cv = rho_cv_s3gc + iStart;
+    temperature = temperature_s3gc + iStart;
+
+    // T^thermal_exp for each group (see neutrals.h):
+    for (long iGroup = 0; iGroup < nGroups; iGroup++) {
+      const thermal_exp_group &group = thermal_exp_groups[iGroup];
+      t_to_p = t_to_ps + iGroup * nAlts;
+      if (IsPow) {
+	for (iAlt = 0; iAlt < nAlts; iAlt++)
+	  t_to_p[iAlt] = pow(double(temperature[iAlt]),
+			     double(group.thermal_exp));
+      } else if (IsTable) {
+	// (This can't be vectorized, since each point looks up a
+	// different place in the table):
+	const double *table = group.table.data();
+	for (iAlt = 0; iAlt < nAlts; iAlt++) {
+	  x = (temperature[iAlt] - table_temperature_min) /
+	    table_dtemperature;
+	  if (x >= 0 && x < nTable_temperatures - 1) {
+	    iT = long(x);
+	    t_to_p[iAlt] = table[iT] + (table[iT+1] - table[iT]) * (x - iT);
+	  } else {
+	    t_to_p[iAlt] = fast_pow(temperature[iAlt], group.thermal_exp);
+	  }
 	}
+      } else {
+	for (iAlt = 0; iAlt < nAlts; iAlt++)
+	  t_to_p[iAlt] = fast_pow(temperature[iAlt], group.thermal_exp);
+      }
+    }
 
-	mean_major_mass_s3gc[index] = rho_s3gc[index] / density_s3gc[index];
-	pressure_s3gc[index] =
-	  density_s3gc[index] *
-	  boltzmanns_constant *
-	  temperature_s3gc[index];
+    for (iAlt = 0; iAlt < nAlts; iAlt++) {
+      density[iAlt] = 0.0;
+      rho[iAlt] = 0.0;
+      Cv[iAlt] = 0.0;
+      gamma[iAlt] = 0.0;
+      kappa[iAlt] = 0.0;
+    }
+
+    // Add up the species (each one is only read from memory once):
+    for (int iSpecies=0; iSpecies < nSpecies; iSpecies++) {
+
+      const species_chars &species = neutrals[iSpecies];
+      stride = species.stride;
+      species_density = species.density_s3gc + iStart * stride;
+      mass = species.mass;
+      vibe = species.vibe;
+      thermal_cond = species.thermal_cond;
+      t_to_p = t_to_ps + species.iThermalExpGroup * nAlts;
+
+      for (iAlt = 0; iAlt < nAlts; iAlt++) {
+	density[iAlt] = density[iAlt] + species_density[iAlt * stride];
+	rho[iAlt] = rho[iAlt] + mass * species_density[iAlt * stride];
+      }
+      for (iAlt = 0; iAlt < nAlts; iAlt++) {
+	Cv[iAlt] = Cv[iAlt] +
+	  (vibe - 2) *
+	  species_density[iAlt * stride] *
+	  boltzmanns_constant / mass;
+	gamma[iAlt] = gamma[iAlt] +
+	  species_density[iAlt * stride] / (vibe-2);
       }
+      for (iAlt = 0; iAlt < nAlts; iAlt++)
+	kappa[iAlt] = kappa[iAlt] +
+	  species_density[iAlt * stride] *
+	  thermal_cond *
+	  t_to_p[iAlt];
+
     }
+
+    for (iAlt = 0; iAlt < nAlts; iAlt++) {
+      mean_mass[iAlt] = rho[iAlt] / density[iAlt];
+      pressure[iAlt] = density[iAlt] * boltzmanns_constant * temperature[iAlt];
+    }
+    for (iAlt = 0; iAlt < nAlts; iAlt++)
+      Cv[iAlt] = Cv[iAlt] / (2*density[iAlt]);
+    for (iAlt = 0; iAlt < nAlts; iAlt++)
+      gamma[iAlt] = gamma[iAlt] * 2.0 / density[iAlt] + 1.0;
+    for (iAlt = 0; iAlt < nAlts; iAlt++)
+      kappa[iAlt] = kappa[iAlt] / density[iAlt];
+    for (iAlt = 0; iAlt < nAlts; iAlt++)
+      rho_cv[iAlt] = rho[iAlt] * Cv[iAlt];
+
+    // The sqrt needs -fno-math-errno (see the Makefile) to be vectorized:
+    for (iAlt = 0; iAlt < nAlts; iAlt++) {
+      r = gamma[iAlt] *
+	boltzmanns_constant *
+	temperature[iAlt] /
+	mean_mass[iAlt];
+      sound[iAlt] = sqrt(r);
+    }
+
   }
-    
-  report.exit(function);
-  return;
-  
+
 }
-  
+
 //----------------------------------------------------------------------
-//
+// The tangent points of a nightside column (see neutrals.h)
 //----------------------------------------------------------------------
 
-void Neutrals::calc_specific_heat(Report &report) {
+void calc_tangent_points(const float *radius,
+			 float sza,
+			 long nGCs,
+			 long nAlts,
+			 long *iBelow,
+			 double *dy) {
+
+  // (This has to be fabs: abs is the int version, which made every
+  // nightside point look like it was in the shadow of the planet)
+  double cos_tangent = fabs(cos(sza - pi/2));
+  double y;
+
+  // The first altitude above the tangent point (at most iAlt, since
+  // y <= radius[iAlt]):
+  long iAbove = nGCs + 1;
+
+  for (long iAlt = nGCs; iAlt < nAlts; iAlt++) {
+
+    y = radius[iAlt] * cos_tangent;
+
+    // This sort of assumes that nGCs >= 2:
+    if (y > radius[nGCs]) {
+      while (iAbove < iAlt && radius[iAbove] <= y) iAbove++;
+      iBelow[iAlt] = iAbove - 1;
+      dy[iAlt] = y - radius[iBelow[iAlt]];
+    } else {
+      // This says that we are in the shadow of the planet:
+      iBelow[iAlt] = -1;
+      dy[iAlt] = 0.0;
+    }
 
-  long iLon, iLat, iAlt, index, iSpecies;
+  }
 
-  double t, p, r;
-  
-  std::string function="Neutrals::calc_specific_heat";
-  static int iFunction = -1;
-  report.enter(function, iFunction);  
+}
 
-  for (iLon = 0; iLon < nGeoLonsG; iLon++) {
-    for (iLat = 0; iLat < nGeoLatsG; iLat++) {
-      for (iAlt = 0; iAlt < nGeoAltsG; iAlt++) {
-	
-	index = ijk_geo_s3gc(iLon,iLat,iAlt);
-
-	Cv_s3gc[index] = 0.0;
-	gamma_s3gc[index] = 0.0;
-	kappa_s3gc[index] = 0.0;
-
-	t = temperature_s3gc[index];
-		
-	for (iSpecies=0; iSpecies < nSpecies; iSpecies++) {
-	  p = neutrals[iSpecies].thermal_exp;
-	  r = pow(t,p); // temp ^ exp; <--- This line slows the code way down.
-	  Cv_s3gc[index] = Cv_s3gc[index] +
-	    (neutrals[iSpecies].vibe - 2) *
-	    neutrals[iSpecies].density_s3gc[index] *
-	    boltzmanns_constant / neutrals[iSpecies].mass;
-	  gamma_s3gc[index] = gamma_s3gc[index] +
-	    neutrals[iSpecies].density_s3gc[index] / (neutrals[iSpecies].vibe-2);
-	  kappa_s3gc[index] = kappa_s3gc[index] +
-	    neutrals[iSpecies].density_s3gc[index] *
-	    neutrals[iSpecies].thermal_cond *
-	    r;
-	}
+//----------------------------------------------------------------------
+// Fill in the chapman table (see neutrals.h)
+//----------------------------------------------------------------------
 
-	Cv_s3gc[index] = Cv_s3gc[index] / (2*density_s3gc[index]);
-	gamma_s3gc[index] = gamma_s3gc[index] * 2.0 / density_s3gc[index] + 1.0;
-	kappa_s3gc[index] = kappa_s3gc[index] / density_s3gc[index];
+void ChapmanTable::build() {
+  values.resize(nMus * nXps);
+  for (long iMu = 0; iMu < nMus; iMu++)
+    for (long iXp = 0; iXp < nXps; iXp++)
+      values[iMu * nXps + iXp] = chapman_dayside(xp_of(iXp), mu_of(iMu));
+}
 
-	r = gamma_s3gc[index] *
-	  boltzmanns_constant *
-	  temperature_s3gc[index] /
-	  mean_major_mass_s3gc[index];
-	
-	sound_s3gc[index] = sqrt(r); // <---- Same with this line
+//----------------------------------------------------------------------
+// How far off the table is from chapman_dayside.  Bilinear
+// interpolation is worst in the middle of the cells, so this checks
+// there (and a quarter of the way across).
+//----------------------------------------------------------------------
 
+double ChapmanTable::max_relative_error() const {
+
+  double max_error = 0.0, xp, mu, exact, error, weight;
+  long iMu;
+
+  for (long iM = 0; iM < nMus - 1; iM++) {
+    for (double fm : {0.25, 0.5}) {
+      mu = exp(log_mu_min + (iM + fm) * dlog_mu);
+      find_mu(mu, iMu, weight);
+      for (long iXp = 0; iXp < nXps - 1; iXp++) {
+	for (double fx : {0.25, 0.5}) {
+	  xp = xp_of(iXp) + fx * (xp_of(iXp + 1) - xp_of(iXp));
+	  exact = chapman_dayside(xp, mu);
+	  error = fabs(lookup(xp, iMu, weight) / exact - 1.0);
+	  if (error > max_error) max_error = error;
+	}
       }
     }
   }
 
-  report.exit(function);
-  return;
-  
+  return max_error;
+
 }
 
 //----------------------------------------------------------------------
@@ -122,10 +275,7 @@ void Neutrals::calc_specific_heat(Report &report) {
 // this is taken from Smith and Smith, JGR 1972, vol. 77, page 3592
 // ----------------------------------------------------------------------
 
-void Neutrals::calc_chapman(Grid grid, Report &report) {
-
-  long iAlt, iLon, iLat, index, indexp;
-  float H;  // scale height
+void Neutrals::calc_chapman(const Grid &grid, Workers &workers, Report &report) {
 
   // This is all from Smith and Smith, JGR 1972, vol. 77, page 3592
   // "Numerical evaluation of chapman's grazing incidence integral ch(X,x)"
@@ -135,411 +285,786 @@ void Neutrals::calc_chapman(Grid grid, Report &report) {
   //
   // Also Updated the Grazing Integral for SZA > 90.0
   // We now do log-linear interpolation for smoother transitions
-  
-  double a = 1.06069630;
-  double b = 0.55643831;
-  double c = 1.06198960;
-  double d = 1.72456090;
-  double f = 0.56498823;
-  double g = 0.06651874;
-
-  double integral[nGeoAltsG], xp[nGeoAltsG], erfcy[nGeoAltsG];
-  double log_int[nGeoAltsG];
-  double y, dy;
+  //
+  // With #chapman table, the dayside uses chapman_table instead of
+  // the erfc fit.
 
-  float Hp_up, Hp_dn, grad_hs, grad_xp, grad_in, Hg, Xg, in, int_g, int_p;
-  long index_bottom, iindex, iindexp, iiAlt;
-    
-  std::string function="Neutrals::calc_chapman";
+  static std::string function="Neutrals::calc_chapman";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
-  for (int iSpecies=0; iSpecies < nSpecies; iSpecies++) {
+  prepare_chapman(workers.get_nThreads());
 
-    for (iLon = 0; iLon < nGeoLonsG; iLon++) {
-      for (iLat = 0; iLat < nGeoLatsG; iLat++) {
+  workers.run([&](const tile_struct &tile, int iThread) {
+    calc_chapman_columns(grid, tile, iThread, report);
+  });
+    
+  report.exit(function);
+  return;
+  
+}
 
-	iAlt = nGeoAltsG-1;
+// All of the absorbers in a column are done together, going down the
+// column once.  The columns of the absorbers are interleaved
+// ([iAlt][iAbsorber]), so the loops over the absorbers (on the inside)
+// can be vectorized.  Only the species that absorb EUV need chapman
+// integrals, since nothing else uses them.  Each thread has its own
+// columns (like calc_conduction):
+
+void Neutrals::prepare_chapman(int nThreads) {
+  long nAlts = extents.nAltsG;
+  chapman_scratch.resize(nThreads * (4 * absorbers.size() + 1) * nAlts);
+  chapman_below_scratch.resize(nThreads * nAlts);
+}
 
-	index = ijk_geo_s3gc(iLon,iLat,iAlt);
-	
-	// The integral from the top to infinity is the density * H (scale height)
-	// So calculate the scale height:
+void Neutrals::calc_chapman_columns(const Grid &grid,
+				    const tile_struct &tile,
+				    int iThread,
+				    Report &report) {
 
-	H = calc_scale_height(iSpecies, index, grid);
-    
-	integral[iAlt] = neutrals[iSpecies].density_s3gc[index] * H;
-	log_int[iAlt] = log(integral[iAlt]);
+  long nAlts = extents.nAltsG;
+  long nGCs = extents.nGCs;
+  long nAbsorbers = absorbers.size();
 
-	// if we wanted to do this properly, then the integral should be
-	// with cell edge values and the distances from cell centers to
-	// cell centers. But, we are approximating here:
+  Field3D<float> temperature(temperature_s3gc, extents);
+  Field2D<float> sza(grid.sza_s2gc, extents);
+  Field2D<float> cos_sza(grid.cos_sza_s2gc, extents);
 
-	for (int iAlt=nGeoAltsG-1; iAlt>=0; iAlt--) {
+  long nChapmanScratch = (4 * nAbsorbers + 1) * nAlts;
+  bool UseTable = (chapman_method == "table");
 
-	  index = ijk_geo_s3gc(iLon,iLat,iAlt);
-	  indexp = ijk_geo_s3gc(iLon,iLat,iAlt+1);
+  long iAlt, iA, iAA, iAAp, iiAlt, index, iColumn, iFirstLit;
+  int iSpecies;
+  float H, t, Hp_up, Hp_dn, grad_hs, grad_xp, grad_in, Hg, Xg, in;
+  float int_g, int_p;
+  double y, dy;
+  float *radius, *gravity, *dalt_lower;
+  float column_sza, column_cos_sza;
+  int IsDay, DoErfc, InTable;
+  // Only used with InTable, but find_mu isn't called for every column:
+  long iMu = 0;
+  double mu_weight = 0.0;
+
+  double *integral = chapman_scratch.data() + iThread * nChapmanScratch;
+  double *log_int = integral + nAlts * nAbsorbers;
+  double *xp = log_int + nAlts * nAbsorbers;
+  double *erfcy = xp + nAlts * nAbsorbers;
+  // The tangent points of the column (see calc_tangent_points):
+  double *dy_tangent = erfcy + nAlts * nAbsorbers;
+  long *iBelow = chapman_below_scratch.data() + iThread * nAlts;
+
+  // The densities and masses of the absorbers:
+  float *densities[nSpecies];
+  long strides[nSpecies];
+  float masses[nSpecies];
+
+  for (iA = 0; iA < nAbsorbers; iA++) {
+    iSpecies = absorbers[iA];
+    strides[iA] = neutrals[iSpecies].stride;
+    masses[iA] = neutrals[iSpecies].mass;
+  }
 
-	  if (iAlt < nGeoAltsG-1) {
-	    integral[iAlt] = integral[iAlt+1] +
-	      neutrals[iSpecies].density_s3gc[index] * grid.dalt_lower_s3gc[indexp];
-	    log_int[iAlt] = log(integral[iAlt]);
-	  }
+  for (column_struct column : temperature.columns(tile)) {
+
+    // The geometry of this column:
+    radius = grid.profile(grid.radius_s1gc).column(column.iLon, column.iLat);
+    gravity = grid.profile(grid.gravity_s1gc).column(column.iLon, column.iLat);
+    dalt_lower =
+      grid.profile(grid.dalt_lower_s1gc).column(column.iLon, column.iLat);
+    column_sza = sza(column.iLon, column.iLat);
+    column_cos_sza = cos_sza(column.iLon, column.iLat);
+
+    IsDay = (column_sza < pi/2 || column_sza > 3*pi/2);
+    InTable = (IsDay && UseTable &&
+	       chapman_table.find_mu(column_cos_sza, iMu, mu_weight));
+    DoErfc = !InTable;
+
+    index = temperature.index(column.iLon, column.iLat, 0);
+    for (iA = 0; iA < nAbsorbers; iA++)
+      densities[iA] = neutrals[absorbers[iA]].density_s3gc + index * strides[iA];
+
+    // The integral from the top to infinity is the density * H
+    // (scale height, which is the same as calc_scale_height):
+    iAlt = nAlts-1;
+    t = temperature_s3gc[index + iAlt];
+    for (iA = 0; iA < nAbsorbers; iA++) {
+      iAA = iAlt * nAbsorbers + iA;
+      H = boltzmanns_constant * t / masses[iA] / gravity[iAlt];
+      integral[iAA] = densities[iA][iAlt * strides[iA]] * H;
+    }
 
-	  H = calc_scale_height(iSpecies, index, grid);
-      
-	  xp[iAlt] = grid.radius_s3gc[index] / H;
+    // if we wanted to do this properly, then the integral should be
+    // with cell edge values and the distances from cell centers to
+    // cell centers. But, we are approximating here:
 
-	  // Eqn (10) Smith & Smith
-	  y = sqrt(0.5 * xp[iAlt]) * fabs(grid.cos_sza_s3gc[index]);
+    for (iAlt = nAlts-1; iAlt >= 0; iAlt--) {
 
-	  // Eqn (12) Smith and Smith
-	  if (y < 8) erfcy[iAlt] = (a + b*y) / (c + d*y + y*y);
-	  else erfcy[iAlt] = f / (g + y);
+      t = temperature_s3gc[index + iAlt];
 
+      if (iAlt < nAlts-1) {
+	for (iA = 0; iA < nAbsorbers; iA++) {
+	  iAA = iAlt * nAbsorbers + iA;
+	  integral[iAA] = integral[iAA + nAbsorbers] +
+	    densities[iA][iAlt * strides[iA]] * dalt_lower[iAlt+1];
 	}
-    
-	// Don't need chapman integrals in the lower ghostcells:
+      }
+
+      for (iA = 0; iA < nAbsorbers; iA++) {
+	iAA = iAlt * nAbsorbers + iA;
+	H = boltzmanns_constant * t / masses[iA] / gravity[iAlt];
+	xp[iAA] = radius[iAlt] / H;
+      }
 
-	for (int iAlt=0; iAlt < nGeoGhosts; iAlt++) { 
-	  index = ijk_geo_s3gc(iLon,iLat,iAlt);
-	  neutrals[iSpecies].chapman_s3gc[index] = max_chapman;
+      if (DoErfc) {
+	for (iA = 0; iA < nAbsorbers; iA++) {
+	  iAA = iAlt * nAbsorbers + iA;
+	  // Eqn (10) Smith & Smith
+	  y = sqrt(0.5 * xp[iAA]) * fabs(column_cos_sza);
+	  erfcy[iAA] = chapman_erfc(y);
 	}
-	
-	// Rest of domain:
+      }
 
-	for (int iAlt=nGeoGhosts; iAlt < nGeoAltsG; iAlt++) {
+    }
 
-	  index = ijk_geo_s3gc(iLon,iLat,iAlt);
+    // On the nightside of the terminator, the tangent points are the
+    // same for all of the species, and the integrals are interpolated
+    // in log (only the nightside needs the logs):
+    if (!IsDay) {
+      calc_tangent_points(radius, column_sza, nGCs, nAlts,
+			  iBelow, dy_tangent);
+      for (iAA = 0; iAA < nAlts * nAbsorbers; iAA++)
+	log_int[iAA] = log(integral[iAA]);
+    }
 
-	  // This is on the dayside:
-	  if (grid.sza_s3gc[index] < pi/2 || grid.sza_s3gc[index] > 3*pi/2) {
+    // The shadow of the planet is the bottom of the column (if any
+    // of it), and the EUV only has to be done above that:
+    iFirstLit = 0;
+    if (!IsDay) {
+      iFirstLit = nGCs;
+      while (iFirstLit < nAlts && iBelow[iFirstLit] < 0) iFirstLit++;
+    }
+    iColumn = sza.index(column.iLon, column.iLat);
+    euv_first_lit[iColumn] = iFirstLit;
+    euv_column_costs[iColumn] = 1.0 + (nAlts - iFirstLit);
 
-	    neutrals[iSpecies].chapman_s3gc[index] =
-	      integral[iAlt] * sqrt(0.5 * pi * xp[iAlt]) * erfcy[iAlt];
+    for (iA = 0; iA < nAbsorbers; iA++) {
 
-	  } else {
+      species_chars &species = neutrals[absorbers[iA]];
 
-	    // This is on the nghtside of the terminator:
+      // Don't need chapman integrals in the lower ghostcells:
+      for (iAlt = 0; iAlt < nGCs; iAlt++)
+	species.chapman(index + iAlt) = max_chapman;
 
-	    y = grid.radius_s3gc[index] * abs(cos(grid.sza_s3gc[index]-pi/2));
+      for (iAlt = nGCs; iAlt < nAlts; iAlt++) {
 
-	    // This sort of assumes that nGeoGhosts >= 2:
-	    index_bottom = ijk_geo_s3gc(iLon,iLat,nGeoGhosts);
-	    if (y > grid.radius_s3gc[index_bottom]) {
+	iAA = iAlt * nAbsorbers + iA;
 
-	      iiAlt = iAlt;
-	      iindex = ijk_geo_s3gc(iLon,iLat,iiAlt-1);
-	      while (grid.radius_s3gc[iindex]>y) {
-		iiAlt--;
-		iindex = ijk_geo_s3gc(iLon,iLat,iiAlt-1);
-	      }
-	      iiAlt--;
+	if (InTable) {
 
-	      iindexp = ijk_geo_s3gc(iLon,iLat,iiAlt+1);
-	      iindex = ijk_geo_s3gc(iLon,iLat,iiAlt);
+	  // (erfcy isn't done for these columns):
+	  if (chapman_table.covers(xp[iAA]))
+	    species.chapman(index + iAlt) =
+	      integral[iAA] * chapman_table.lookup(xp[iAA], iMu, mu_weight);
+	  else
+	    species.chapman(index + iAlt) =
+	      integral[iAA] * chapman_dayside(xp[iAA], column_cos_sza);
 
-	      Hp_up = calc_scale_height(iSpecies, iindexp, grid);
-	      Hp_dn = calc_scale_height(iSpecies, iindex, grid);
+	} else if (IsDay) {
 
-	      // make sure to use the proper cell spacing (iiAlt+1 & lower):
-	      grad_hs = (Hp_up - Hp_dn) / grid.dalt_lower_s3gc[iindexp];
-	      grad_xp = (xp[iiAlt+1]-xp[iiAlt]) / grid.dalt_lower_s3gc[iindexp];
-	      grad_in = (log_int[iiAlt+1] - log_int[iiAlt]) / grid.dalt_lower_s3gc[iindexp];
-	  
-	      // Linearly interpolate H and X:
-	      dy = y - grid.radius_s3gc[iindex];
-	      Hg = Hp_dn + grad_hs * dy;
-	      Xg = xp[iiAlt] + grad_xp * dy;
-	      in = log_int[iiAlt] + grad_in * dy;
+	  species.chapman(index + iAlt) =
+	    integral[iAA] * sqrt(0.5 * pi * xp[iAA]) * erfcy[iAA];
 
-	      int_g = exp(in);
-	      int_p = integral[iAlt];
-	      // Equation (19) Smith & Smith
-	      neutrals[iSpecies].chapman_s3gc[index] =
-		sqrt(0.5 * pi * Xg) * (2.0 * int_g - int_p * erfcy[iAlt]);
+	} else if (iBelow[iAlt] >= 0) {
 
-	      if (neutrals[iSpecies].chapman_s3gc[index] > max_chapman)
-		neutrals[iSpecies].chapman_s3gc[index] = max_chapman;
-	  
-	    } else {
+	  iiAlt = iBelow[iAlt];
+	  iAAp = (iiAlt+1) * nAbsorbers + iA;
 
-	      // This says that we are in the shadow of the planet:
+	  Hp_up = boltzmanns_constant * temperature_s3gc[index + iiAlt + 1] /
+	    masses[iA] / gravity[iiAlt+1];
+	  Hp_dn = boltzmanns_constant * temperature_s3gc[index + iiAlt] /
+	    masses[iA] / gravity[iiAlt];
 
-	      neutrals[iSpecies].chapman_s3gc[index] = max_chapman;
+	  // make sure to use the proper cell spacing (iiAlt+1 & lower):
+	  grad_hs = (Hp_up - Hp_dn) / dalt_lower[iiAlt+1];
+	  grad_xp = (xp[iAAp] - xp[iAAp - nAbsorbers]) / dalt_lower[iiAlt+1];
+	  grad_in =
+	    (log_int[iAAp] - log_int[iAAp - nAbsorbers]) / dalt_lower[iiAlt+1];
 
-	    }
+	  // Linearly interpolate H and X:
+	  dy = dy_tangent[iAlt];
+	  Hg = Hp_dn + grad_hs * dy;
+	  Xg = xp[iAAp - nAbsorbers] + grad_xp * dy;
+	  in = log_int[iAAp - nAbsorbers] + grad_in * dy;
 
-	  }
+	  int_g = exp(in);
+	  int_p = integral[iAA];
+	  // Equation (19) Smith & Smith
+	  species.chapman(index + iAlt) =
+	    sqrt(0.5 * pi * Xg) * (2.0 * int_g - int_p * erfcy[iAA]);
 
-	  if (report.test_verbose(10))
-	    std::cout << "iSpecies, iAlt, chap : " << iSpecies << " " << iAlt << " " <<
-	      grid.sza_s3gc[index]*rtod << " " << 
-	      xp[iAlt] << " " << 
-	      erfcy[iAlt] << " " << 
-	      neutrals[iSpecies].chapman_s3gc[index] << " " << integral[iAlt] << "\n";
+	  if (species.chapman(index + iAlt) > max_chapman)
+	    species.chapman(index + iAlt) = max_chapman;
 
-	} // iAlt
+	} else {
+
+	  // This says that we are in the shadow of the planet:
+	  species.chapman(index + iAlt) = max_chapman;
+
+	}
+
+	if (report.test_verbose(10))
+	  std::cout << "iSpecies, iAlt, chap : " << absorbers[iA] << " "
+		    << iAlt << " " << column_sza*rtod << " "
+		    << xp[iAA] << " " << erfcy[iAA] << " "
+		    << species.chapman(index + iAlt) << " "
+		    << integral[iAA] << "\n";
+
+      }
+
+    }
+
+  }
 
-      } // iLat
-    } // iLon
-    
-  } // iSpecies
-    
-  report.exit(function);
-  return;
-  
 }
 
 // -----------------------------------------------------------------------------
 // Calculate thermal conduction
 // -----------------------------------------------------------------------------
 
-void Neutrals::calc_conduction(Grid grid, Times time, Report &report) {
-
-  float prandtl[nGeoAltsG];
-  float rhocv[nGeoAltsG];
-  float lambda[nGeoAltsG];
-  float conduction[nGeoAltsG];
-  float temp[nGeoAltsG];
-  float dalt_lower[nGeoAltsG];
-  float dt;
-  
-  long iLon, iLat, iAlt, index;
+void Neutrals::calc_conduction(const Grid &grid,
+			       float dt,
+			       Workers &workers,
+			       Report &report) {
 
-  std::string function="Neutrals::calc_conduction";
+  static std::string function="Neutrals::calc_conduction";
   static int iFunction = -1;
   report.enter(function, iFunction);  
-  
-  for (iLon = 0; iLon < nGeoLonsG; iLon++) {
-    for (iLat = 0; iLat < nGeoLatsG; iLat++) {
-      for (iAlt=0; iAlt < nGeoAltsG; iAlt++) {
-	index = ijk_geo_s3gc(iLon,iLat,iAlt);
-	conduction_s3gc[index] = 0.0;
+
+  prepare_conduction(workers.get_nThreads());
+
+  workers.run([&](const tile_struct &tile, int iThread) {
+    calc_conduction_columns(grid, dt, tile, iThread, report);
+  });
+
+  report.exit(function);
+
+}
+
+// Each thread gets its own piece of the scratch space (for the batched
+// solver), which is only allocated the first time through:
+
+void Neutrals::prepare_conduction(int nThreads) {
+  conduction_scratch.resize(nThreads * 2 * nConductionLanes * extents.nAltsG);
+}
+
+void Neutrals::calc_conduction_columns(const Grid &grid,
+				       float dt,
+				       const tile_struct &tile,
+				       int iThread,
+				       Report &report) {
+
+  long nAlts = extents.nAltsG;
+
+  Field3D<float> temperature(temperature_s3gc, extents);
+  Field3D<float> conduction(conduction_s3gc, extents);
+  ProfileField<float> radius_sq = grid.profile(grid.radius_sq_s1gc);
+  ProfileField<float> conduction_r = grid.profile(grid.conduction_r_s1gc);
+  ProfileField<float> conduction_du12 =
+    grid.profile(grid.conduction_du12_s1gc);
+  ProfileField<float> conduction_du22 =
+    grid.profile(grid.conduction_du22_s1gc);
+
+  long nConductionScratch = 2 * nConductionLanes * nAlts;
+
+  float *work = conduction_scratch.data() + iThread * nConductionScratch;
+  conduction_batch_struct<nConductionLanes> batch;
+  long iLon, iLat, iAlt, index;
+  int iLane = 0;
+
+  // The ghost columns of this tile don't get any conduction:
+  for (column_struct column : temperature.columns(tile)) {
+    if (column.iLon >= extents.iLonStart_ &&
+	column.iLon <= extents.iLonEnd_ &&
+	column.iLat >= extents.iLatStart_ &&
+	column.iLat <= extents.iLatEnd_) continue;
+    float *ghost = conduction.column(column.iLon, column.iLat);
+    for (iAlt=0; iAlt < nAlts; iAlt++) ghost[iAlt] = 0.0;
+  }
+
+  // The part of this tile that is in the physical domain:
+  long iLonStart = std::max(tile.iLonStart, extents.iLonStart_);
+  long iLonEnd = std::min(tile.iLonEnd, extents.iLonStop());
+  long iLatStart = std::max(tile.iLatStart, extents.iLatStart_);
+  long iLatEnd = std::min(tile.iLatEnd, extents.iLatStop());
+
+  // The columns are put into the lanes of the solver as they come, and
+  // the solver goes when all of the lanes are full.  The solver writes
+  // dT/dt (conduction actually solves for Tnew-Told) straight into the
+  // field.  lambda would also have the eddy conduction (eddy * rho *
+  // cv) in it, but that is zero for now, so it is just kappa.
+
+  for (iLon = iLonStart; iLon < iLonEnd; iLon++) {
+    for (iLat = iLatStart; iLat < iLatEnd; iLat++) {
+
+      index = temperature.index(iLon, iLat, 0);
+      batch.temperature[iLane] = temperature_s3gc + index;
+      batch.kappa[iLane] = kappa_s3gc + index;
+      batch.rho_cv[iLane] = rho_cv_s3gc + index;
+      batch.conduction[iLane] = conduction_s3gc + index;
+
+      // The geometry of this column (shared with other columns):
+      batch.radius_sq[iLane] = radius_sq.column(iLon, iLat);
+      batch.r[iLane] = conduction_r.column(iLon, iLat);
+      batch.du12[iLane] = conduction_du12.column(iLon, iLat);
+      batch.du22[iLane] = conduction_du22.column(iLon, iLat);
+
+      iLane++;
+      if (iLane == nConductionLanes) {
+	solver_conduction_batch(batch, dt, nAlts, work);
+	iLane = 0;
       }
+
+    } // lat
+  } // lon
+
+  // The lanes that are left over do the last column again (which
+  // writes the same answer to the same place):
+  if (iLane > 0) {
+    for (int iCopy = iLane; iCopy < nConductionLanes; iCopy++) {
+      batch.temperature[iCopy] = batch.temperature[iLane - 1];
+      batch.kappa[iCopy] = batch.kappa[iLane - 1];
+      batch.rho_cv[iCopy] = batch.rho_cv[iLane - 1];
+      batch.conduction[iCopy] = batch.conduction[iLane - 1];
+      batch.radius_sq[iCopy] = batch.radius_sq[iLane - 1];
+      batch.r[iCopy] = batch.r[iLane - 1];
+      batch.du12[iCopy] = batch.du12[iLane - 1];
+      batch.du22[iCopy] = batch.du22[iLane - 1];
     }
+    solver_conduction_batch(batch, dt, nAlts, work);
   }
-	
-  for (iLon = iGeoLonStart_; iLon < iGeoLonEnd_; iLon++) {
-    for (iLat = iGeoLatStart_; iLat < iGeoLatEnd_; iLat++) {
-      
-      // Treat each altitude slice individually:
-      
-      for (iAlt=0; iAlt < nGeoAltsG; iAlt++) {
-	index = ijk_geo_s3gc(iLon,iLat,iAlt);
-
-	rhocv[iAlt] = rho_s3gc[index] * Cv_s3gc[index];
-	// rhocv needs to be scaled by radius squared:
-	rhocv[iAlt] = rhocv[iAlt] * grid.radius_sq_s3gc[index];
-    
-	// Need to make this eddy * rho * cv:
-	prandtl[iAlt] = 0.0;
 
-	lambda[iAlt] = kappa_s3gc[index] + prandtl[iAlt];
-	// lambda needs to be scaled by radius squared:
-	lambda[iAlt] = lambda[iAlt] * grid.radius_sq_s3gc[index];
-    
-	conduction[iAlt] = 0.0;
+  if (report.test_verbose(10)) {
+    for (iLon = iLonStart; iLon < iLonEnd; iLon++)
+      for (iLat = iLatStart; iLat < iLatEnd; iLat++)
+	for (iAlt=0; iAlt < nAlts; iAlt++) {
+	  index = temperature.index(iLon, iLat, iAlt);
+	  std::cout << "conduction : " << index << " "
+		    << conduction_s3gc[index]*seconds_per_day
+		    << " deg/day\n";
+	}
+  }
 
-	temp[iAlt] = temperature_s3gc[index];
+}
 
-	dalt_lower[iAlt] = grid.dalt_lower_s3gc[index];
-	
-      }
+// -----------------------------------------------------------------------------
+// The largest stable time step for the neutrals on this processor.
+// The conduction is implicit, so it is stable with any dt, but it is
+// only accurate if the diffusion number (kappa dt / (rho cv dz^2)) is
+// not too big.  The sound speed limit is a vertical CFL condition,
+// which is for the transport (turn it on with cfl > 0).  A limit of 0
+// is turned off.  This is after calc_thermodynamics, so kappa, rho_cv
+// and the sound speed are for this step.
+// -----------------------------------------------------------------------------
 
-      dt = time.get_dt();
-
-      // if (iLon == nGeoLonsG/2 && iLat == nGeoLatsG/2) {
-      //   for (iAlt=0; iAlt < nGeoAltsG; iAlt++) {
-      // 	  std::cout << "before conduction : "
-      // 		    << iLon << " " << iLat << " " << iAlt << " "
-      // 		    << temp[iAlt] << " "
-      // 		    << lambda[iAlt] << " " 
-      // 		    << rhocv[iAlt] << " " 
-      // 		    << dt << " " 
-      // 		    << dalt_lower[iAlt] << "\n";
-      // 	}
-      // }
-	    
-      solver_conduction(temp, lambda, rhocv, dt, dalt_lower, conduction);
-
-      // if (iLon == nGeoLonsG/2 && iLat == nGeoLatsG/2) {
-      //   for (iAlt=0; iAlt < nGeoAltsG; iAlt++) {
-      // 	  std::cout << "after conduction : "
-      // 		    << iLon << " " << iLat << " " << iAlt << " "
-      // 		    << conduction[iAlt] << "\n";
-      // 	}
-      // }
-      // We want the sources to be in terms of dT/dt, while the
-      // conduction actually solves for Tnew-Told, so divide by dt
-
-      for (iAlt=0; iAlt < nGeoAltsG; iAlt++) {
-	conduction_s3gc[index] = conduction[iAlt]/dt;
+float Neutrals::calc_dt_limit(const Grid &grid,
+			      float cfl,
+			      float diffusion_number,
+			      Workers &workers,
+			      Report &report) {
 
-	if (report.test_verbose(10))
-	  std::cout << "conduction : " << index
-		    << " " << conduction_s3gc[index]*seconds_per_day << " deg/day\n";
-	
-      }
+  static std::string function="Neutrals::calc_dt_limit";
+  static int iFunction = -1;
+  report.enter(function, iFunction);
 
-      // End of calculation for each altitude
+  prepare_dt_limit(workers.get_nThreads());
 
-    } // lat
+  workers.run([&](const tile_struct &tile, int iThread) {
+    calc_dt_limit_columns(grid, cfl, diffusion_number, tile, iThread);
+  });
 
-  } // lon
+  float dt_limit = finish_dt_limit();
 
   report.exit(function);
+  return dt_limit;
 
 }
 
-  
+// Each thread finds the smallest limit in the columns that it does:
+
+void Neutrals::prepare_dt_limit(int nThreads) {
+  dt_limit_scratch.resize(nThreads);
+  for (float &dt_thread : dt_limit_scratch) dt_thread = 1.0e30;
+}
+
+void Neutrals::calc_dt_limit_columns(const Grid &grid,
+				     float cfl,
+				     float diffusion_number,
+				     const tile_struct &tile,
+				     int iThread) {
+
+  Field3D<float> temperature(temperature_s3gc, extents);
+  ProfileField<float> dalt_center = grid.profile(grid.dalt_center_s1gc);
+
+  float dt_limit = dt_limit_scratch[iThread], dz, *dz_column;
+  long iAlt, index;
+
+  for (column_struct column : temperature.columns(tile)) {
+    if (column.iLon < extents.iLonStart_ || column.iLon > extents.iLonEnd_ ||
+	column.iLat < extents.iLatStart_ || column.iLat > extents.iLatEnd_)
+      continue;
+    dz_column = dalt_center.column(column.iLon, column.iLat);
+    index = temperature.index(column.iLon, column.iLat, 0);
+    for (iAlt = extents.iAltStart_; iAlt <= extents.iAltEnd_; iAlt++) {
+      dz = dz_column[iAlt];
+      if (diffusion_number > 0.0)
+	dt_limit = std::min(dt_limit,
+			    diffusion_number * rho_cv_s3gc[index + iAlt] *
+			    dz * dz / kappa_s3gc[index + iAlt]);
+      if (cfl > 0.0)
+	dt_limit = std::min(dt_limit, cfl * dz / sound_s3gc[index + iAlt]);
+    }
+  }
+
+  dt_limit_scratch[iThread] = dt_limit;
+
+}
+
+float Neutrals::finish_dt_limit() const {
+  float dt_limit = 1.0e30;
+  for (float dt_thread : dt_limit_scratch)
+    dt_limit = std::min(dt_limit, dt_thread);
+  return dt_limit;
+}
 
 // -----------------------------------------------------------------------------
 // Calculate EUV driven ionization and heating rates
 // -----------------------------------------------------------------------------
 
-void Neutrals::calc_ionization_heating(Euv euv, Ions &ions, Report &report) {
+void Neutrals::calc_ionization_heating(const Euv &euv,
+				       Ions &ions,
+				       Workers &workers,
+				       Report &report) {
 
-  long iAlt, iLon, iLat, iWave, iSpecies, index, indexp;
-  int i_, idion_, ideuv_, nIonizations, iIon, iIonization;
-  float tau, intensity, photoion;
-
-  float ionization;
-
-  std::string function="calc_ionization_heating";
+  static std::string function="calc_ionization_heating";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
-  // Zero out all source terms:
-  
-  for (iLon = 0; iLon < nGeoLonsG; iLon++) {
-    for (iLat = 0; iLat < nGeoLatsG; iLat++) {
-      for (iAlt = 0; iAlt < nGeoAltsG; iAlt++) {
+  prepare_ionization_heating(euv, workers.get_nThreads());
 
-	index = ijk_geo_s3gc(iLon,iLat,iAlt);
+  // Columns in the shadow are cheap, so the threads get stripes with
+  // about the same sunlit columns (see calc_chapman):
+  workers.run([&](const tile_struct &tile, int iThread) {
+    calc_ionization_heating_columns(ions, tile, iThread, report);
+  }, euv_column_costs);
 
-	heating_euv_s3gc[index] = 0.0;
-	for (iSpecies=0; iSpecies < nSpecies; iSpecies++)
-	  neutrals[iSpecies].ionization_s3gc[index] = 0.0;
+  report.exit(function);
+  return;
 
+}
+
+// Each thread has its own chapman integrals ([iAbsorber][iAlt]),
+// intensities ([iWave][iAlt], plus in_sun) and rates ([iRate][iAlt])
+// for a column, so all of the loops on the inside go up the column.
+// The intensities at the top are the same for all of the columns:
+
+void Neutrals::prepare_ionization_heating(const Euv &euv, int nThreads) {
+
+  long nAlts = extents.nAltsG;
+  long nWaves = nEuvWaves, iWave;
+
+  euv_scratch.resize(nThreads * (absorbers.size() + nWaves + 1 + nEuvRates) *
+		     nAlts);
+  euv_cut_scratch.resize(nThreads * nWaves);
+
+  // With merged bins, each bin gets all of its wavelengths:
+  euv_intensity_top = euv.wavelengths_intensity_top.data();
+  if (euv_bin_of_wave.size() > 0) {
+    for (iWave = 0; iWave < nWaves; iWave++)
+      euv_bin_intensity[iWave] = 0.0;
+    for (iWave = 0; iWave < long(euv_bin_of_wave.size()); iWave++)
+      euv_bin_intensity[euv_bin_of_wave[iWave]] += euv_intensity_top[iWave];
+    euv_intensity_top = euv_bin_intensity.data();
+  }
+
+}
+
+void Neutrals::calc_ionization_heating_columns(Ions &ions,
+					       const tile_struct &tile,
+					       int iThread,
+					       Report &report) {
+
+  long nAlts = extents.nAltsG;
+  long nAbsorbers = absorbers.size();
+  long nIonizations = ionization_neutral.size();
+  long nWaves = nEuvWaves;
+
+  Field3D<float> heating_euv(heating_euv_s3gc, extents);
+  Field2D<float> column_costs(euv_column_costs.data(), extents);
+
+  long nEuvScratch = (nAbsorbers + nWaves + 1 + nEuvRates) * nAlts;
+  const float *intensity_top = euv_intensity_top;
+
+  long iAlt, iA, iWave, iRate, iI, index, iColumn, iLit, iBottom;
+  int iSpecies;
+  float cross_section, top, rate;
+  double units, heating, ionization;
+  float *column_tau, *column_chapman, *column_rates;
+
+  long iAltStart = extents.iAltStart_;
+  long iAltEnd = extents.iAltEnd_;
+
+  float *chapman = euv_scratch.data() + iThread * nEuvScratch;
+  float *intensity = chapman + nAbsorbers * nAlts;
+  float *in_sun = intensity + nWaves * nAlts;
+  float *rates = in_sun + nAlts;
+  // The bottom of each wavelength (see below):
+  long *iCut = euv_cut_scratch.data() + iThread * nWaves;
+
+  for (column_struct column : heating_euv.columns(tile)) {
+
+    index = heating_euv.index(column.iLon, column.iLat, 0);
+
+    // Zero out all source terms (the ghost cells stay this way).
+    // The ions too, or their sources would keep adding up from one
+    // EUV update to the next:
+    for (iAlt = 0; iAlt < nAlts; iAlt++)
+      heating_euv_s3gc[index + iAlt] = 0.0;
+    for (iSpecies = 0; iSpecies < nSpecies; iSpecies++)
+      for (iAlt = 0; iAlt < nAlts; iAlt++)
+	neutrals[iSpecies].ionization_s3gc[index + iAlt] = 0.0;
+    for (iSpecies = 0; iSpecies < nIons; iSpecies++)
+      for (iAlt = 0; iAlt < nAlts; iAlt++)
+	ions.species[iSpecies].ionization_s3gc[index + iAlt] = 0.0;
+
+    iColumn = column_costs.index(column.iLon, column.iLat);
+    euv_column_bottom[iColumn] = nAlts;
+
+    if (column.iLon < extents.iLonStart_ ||
+	column.iLon >= extents.iLonStop() ||
+	column.iLat < extents.iLatStart_ ||
+	column.iLat >= extents.iLatStop())
+      continue;
+
+    // Nothing below iLit can see the sun, so all of the source terms
+    // stay 0 there (and in the whole column at night):
+    iLit = euv_first_lit[iColumn];
+    if (iLit < iAltStart) iLit = iAltStart;
+    if (iLit >= iAltEnd) continue;
+
+    // The chapman integrals of the absorbers, next to each other:
+    for (iA = 0; iA < nAbsorbers; iA++) {
+      species_chars &species = neutrals[absorbers[iA]];
+      for (iAlt = iLit; iAlt < iAltEnd; iAlt++)
+	chapman[iA * nAlts + iAlt] = species.chapman(index + iAlt);
+    }
+
+    // The optical depth at each wavelength is the sum of the
+    // (absorption cross section) x (chapman integral) of the
+    // absorbers, which is a (nWaves x nAbsorbers) x (nAbsorbers x
+    // nAlts) product:
+    for (iWave = 0; iWave < nWaves; iWave++) {
+
+      column_tau = intensity + iWave * nAlts;
+      for (iAlt = iLit; iAlt < iAltEnd; iAlt++)
+	column_tau[iAlt] = 0.0;
+
+      for (iA = 0; iA < nAbsorbers; iA++) {
+	cross_section = euv_absorption[iWave * nAbsorbers + iA];
+	column_chapman = chapman + iA * nAlts;
+	for (iAlt = iLit; iAlt < iAltEnd; iAlt++)
+	  column_tau[iAlt] = column_tau[iAlt] +
+	    cross_section * column_chapman[iAlt];
+      }
+
+      // The bottom of the column is optically thick at most
+      // wavelengths, so everything below iCut (where tau first gets
+      // under euv_tau_max, going up) is 0, and is skipped from here on:
+      iCut[iWave] = iLit;
+      while (iCut[iWave] < iAltEnd && column_tau[iCut[iWave]] >= euv_tau_max)
+	iCut[iWave]++;
+
+      // The tau becomes the intensity.  Above iCut, the intensity is
+      // still 0 where tau > euv_tau_max, which keeps fast_expf in its
+      // range, and the floats from going denormal.  (These are two
+      // loops, since gcc won't vectorize the ifs with fast_expf):
+      top = intensity_top[iWave];
+      for (iAlt = iCut[iWave]; iAlt < iAltEnd; iAlt++) {
+	in_sun[iAlt] = (column_tau[iAlt] < euv_tau_max) ? 1.0f : 0.0f;
+	column_tau[iAlt] =
+	  (column_tau[iAlt] < euv_tau_max) ? column_tau[iAlt] : euv_tau_max;
       }
+      for (iAlt = iCut[iWave]; iAlt < iAltEnd; iAlt++)
+	column_tau[iAlt] = top * fast_expf(-column_tau[iAlt]) * in_sun[iAlt];
+
+    }
+
+    // Nothing is left below the lowest cut:
+    iBottom = iAltEnd;
+    for (iWave = 0; iWave < nWaves; iWave++)
+      if (iCut[iWave] < iBottom) iBottom = iCut[iWave];
+    euv_column_bottom[iColumn] = iBottom;
+
+    // Then the heating (per absorber) and ionization rates (per
+    // cross section) are the (nRates x nWaves) x (nWaves x nAlts)
+    // product of the rate matrix and the intensities:
+    for (iRate = 0; iRate < nEuvRates; iRate++) {
+      column_rates = rates + iRate * nAlts;
+      for (iAlt = iBottom; iAlt < iAltEnd; iAlt++)
+	column_rates[iAlt] = 0.0;
+      for (iWave = 0; iWave < nWaves; iWave++) {
+	rate = euv_rates[iWave * nEuvRates + iRate];
+	column_tau = intensity + iWave * nAlts;
+	for (iAlt = iCut[iWave]; iAlt < iAltEnd; iAlt++)
+	  column_rates[iAlt] = column_rates[iAlt] + rate * column_tau[iAlt];
+      }
+    }
+
+    // Add up the heating of the absorbers, scale it with the
+    // efficiency, and convert energy deposition to change in
+    // temperature:
+    for (iAlt = iBottom; iAlt < iAltEnd; iAlt++) {
+      heating = 0.0;
+      for (iA = 0; iA < nAbsorbers; iA++)
+	heating = heating + euv_rate_units[iA] * rates[iA * nAlts + iAlt] *
+	  neutrals[absorbers[iA]].density(index + iAlt);
+      heating_euv_s3gc[index + iAlt] =
+	heating_efficiency * heating / rho_cv_s3gc[index + iAlt];
     }
+
+    // Each ionization takes away a neutral and makes an ion:
+    for (iI = 0; iI < nIonizations; iI++) {
+      species_chars &species = neutrals[ionization_neutral[iI]];
+      float *ion_ionization = ions.species[ionization_ion[iI]].ionization_s3gc;
+      column_rates = rates + (nAbsorbers + iI) * nAlts;
+      units = euv_rate_units[nAbsorbers + iI];
+      for (iAlt = iBottom; iAlt < iAltEnd; iAlt++) {
+	ionization =
+	  units * column_rates[iAlt] * species.density(index + iAlt);
+	species.ionization_s3gc[index + iAlt] =
+	  species.ionization_s3gc[index + iAlt] + ionization;
+	ion_ionization[index + iAlt] =
+	  ion_ionization[index + iAlt] + ionization;
+      }
+    }
+
+    if (report.test_verbose(10))
+      for (iAlt = iAltStart; iAlt < iAltEnd; iAlt++)
+	std::cout << "heating : " << index + iAlt << " "
+		  << heating_euv_s3gc[index + iAlt]*seconds_per_day
+		  << " deg/day\n";
+
   }
-	
-  for (iLon = iGeoLonStart_; iLon < iGeoLonEnd_; iLon++) {
-    for (iLat = iGeoLatStart_; iLat < iGeoLatEnd_; iLat++) {
-      for (iAlt = iGeoAltStart_; iAlt < iGeoAltEnd_; iAlt++) {
-
-	index = ijk_geo_s3gc(iLon,iLat,iAlt);
-      
-	heating_euv_s3gc[index] = 0.0;
-	for (iSpecies=0; iSpecies < nSpecies; iSpecies++)
-	  neutrals[iSpecies].ionization_s3gc[index] = 0.0;
-    
-	for (iWave=0; iWave < euv.nWavelengths; iWave++) {
-
-	  // Need to calculate the intensity at particular wavelength
-	  // (iWave), for each species (iSpecies), which is dependent
-	  // on the chapman integrals at that particular location (index)
-	  // and the cross section (i_):
-	
-	  tau = 0.0;
-	  for (iSpecies=0; iSpecies < nSpecies; iSpecies++) {
-	    if (neutrals[iSpecies].iEuvAbsId_ > -1) {
-	      i_ = neutrals[iSpecies].iEuvAbsId_;
-	      tau = tau +
-		euv.waveinfo[i_].values[iWave] *
-		neutrals[iSpecies].chapman_s3gc[index];
-	    }	  
-	  }
 
-	  intensity = euv.wavelengths_intensity_top[iWave] * exp(-1.0*tau);
-	  
-	  for (iSpecies=0; iSpecies < nSpecies; iSpecies++) {
+}
 
-	    // Calculate Photo-Absorbtion for each species and add them up:
-	    i_ = neutrals[iSpecies].iEuvAbsId_; // index of photo abs cross section
-	    if (i_ > -1) {
-	      heating_euv_s3gc[index] = heating_euv_s3gc[index] +
-		intensity *
-		euv.wavelengths_energy[iWave] * 
-		euv.waveinfo[i_].values[iWave] *  // cross section
-		neutrals[iSpecies].density_s3gc[index];
-	    }
+// -----------------------------------------------------------------------------
+// Copy the EUV sources that calc_ionization_heating just made (for the
+// sun at time_of_sources) into sources.
+// -----------------------------------------------------------------------------
 
-	    for (iIonization = 0; iIonization < neutrals[iSpecies].nEuvIonSpecies; iIonization++) {
+void Neutrals::save_euv_sources(euv_sources_struct &sources,
+				double time_of_sources,
+				Workers &workers) {
 
-	      i_ = neutrals[iSpecies].iEuvIonId_[iIonization];
-	      // std::cout << iSpecies << " " << iIonization << " " << i_ << "\n";
-	      
-	      ionization = 
-		intensity *
-		euv.waveinfo[i_].values[iWave] *  // cross section
-		neutrals[iSpecies].density_s3gc[index];
+  sources.time = time_of_sources;
 
-	      neutrals[iSpecies].ionization_s3gc[index] =
-		neutrals[iSpecies].ionization_s3gc[index] + ionization;
+  workers.run([&](const tile_struct &tile, int iThread) {
+    save_euv_sources_columns(sources, tile);
+  });
 
-	      iIon = neutrals[iSpecies].iEuvIonSpecies_[iIonization];
-	      ions.species[iIon].ionization_s3gc[index] = 
-		ions.species[iIon].ionization_s3gc[index] + ionization;	
+}
 
-	    }
-	     
-	  } // Each species
+void Neutrals::save_euv_sources_columns(euv_sources_struct &sources,
+					const tile_struct &tile) {
+
+  Field3D<float> heating_euv(heating_euv_s3gc, extents);
+  Field2D<long> bottom(euv_column_bottom.data(), extents);
+  long nFields = euv_source_fields.size();
+
+  long iField, iAlt, index, iColumn;
+  const float *field;
+  float *saved;
+  for (column_struct column : heating_euv.columns(tile)) {
+    index = heating_euv.index(column.iLon, column.iLat, 0);
+    iColumn = bottom.index(column.iLon, column.iLat);
+    sources.bottom[iColumn] = euv_column_bottom[iColumn];
+    // All of it, so that below the bottom is 0:
+    for (iField = 0; iField < nFields; iField++) {
+      field = euv_source_fields[iField] + index;
+      saved = sources.fields.data() + iField * extents.nPointsG + index;
+      for (iAlt = 0; iAlt < extents.nAltsG; iAlt++)
+	saved[iAlt] = field[iAlt];
+    }
+  }
 
-	  
-	} // Each wavelength
+}
+
+// -----------------------------------------------------------------------------
+// Fill in the EUV sources for the current time, going in a straight
+// line from euv_sources_then to euv_sources_next.  The update at the
+// time of euv_sources_next can be a step late (if dt_euv isn't a
+// multiple of dt), so past that they are held.  Below the bottom of
+// both, the sources are 0 all the time, so that is left alone (as is
+// the whole column at night).
+// -----------------------------------------------------------------------------
 
-	// Scale heating with efficiency, and 
-	// convert energy deposition to change in temperature:
+void Neutrals::interpolate_euv_sources(const Times &time,
+				       Workers &workers,
+				       Report &report) {
 
-	heating_euv_s3gc[index] =
-	  heating_efficiency *
-	  heating_euv_s3gc[index] / rho_s3gc[index] / Cv_s3gc[index];
+  static std::string function="interpolate_euv_sources";
+  static int iFunction = -1;
+  report.enter(function, iFunction);
 
-	if (report.test_verbose(10))
-	  std::cout << "heating : " << index
-	       << " " << heating_euv_s3gc[index]*seconds_per_day << " deg/day\n";
-	  
-      } // Alts
-    } // Lats
-  } // Lons
-	    
-//	// We need to do things here:
-//	// - Identify where the ionization cross section is stored
-//	// - Identify which ion gets the ionization
-//	// - Keep track of neutral losses
-//
-//	// How many ionizations do we have:
-//	nIonizations = neutrals[iSpecies].iEuvIonId_.size();
-//	for (int iIon=0; iIon < nIonizations; iIon++) {
-//
-//	  // Find cross section:
-//	  ideuv_ = neutrals[iSpecies].iEuvIonId_[iIon];
-//	  // Find ion to put sources:
-//	  idion_ = neutrals[iSpecies].iEuvIonSpecies_[iIon];
-//
-//	  photoion = euv.waveinfo[ideuv_].values[iWave];
-//
-//	  // This is the ionization rate:
-//	  ionization = intensity * photoion * 
-//	    neutrals[iSpecies].density[iAlt];
-//	    
-//	  // Keep track of losses for neutrals:
-//	  neutrals[iSpecies].ionization[iAlt] =
-//	    neutrals[iSpecies].ionization[iAlt] +
-//	    ionization;
-//
-//	  // Keep track of sources for ions:
-//	  ions.species[idion_].ionization[iAlt] = 
-//	    ions.species[idion_].ionization[iAlt] +
-//	    ionization;
-//
-//	}
-//	  
+  float weight = get_euv_weight(time);
+
+  workers.run([&](const tile_struct &tile, int iThread) {
+    interpolate_euv_sources_columns(weight, tile);
+  });
 
   report.exit(function);
-  return;
+
+}
+
+float Neutrals::get_euv_weight(const Times &time) const {
+
+  const euv_sources_struct &then = euv_sources_then;
+  const euv_sources_struct &next = euv_sources_next;
+
+  float weight = 1.0;
+  if (next.time > then.time)
+    weight = (time.get_current() - then.time) / (next.time - then.time);
+  if (weight < 0.0) weight = 0.0;
+  if (weight > 1.0) weight = 1.0;
+  return weight;
+
+}
+
+void Neutrals::interpolate_euv_sources_columns(float weight,
+					       const tile_struct &tile) {
+
+  const euv_sources_struct &then = euv_sources_then;
+  const euv_sources_struct &next = euv_sources_next;
+
+  Field3D<float> heating_euv(heating_euv_s3gc, extents);
+  Field2D<long> bottom(euv_column_bottom.data(), extents);
+  long nFields = euv_source_fields.size();
+
+  long iField, iAlt, index, iColumn, iBottom;
+  float *field;
+  const float *field_then, *field_next;
+  for (column_struct column : heating_euv.columns(tile)) {
+    index = heating_euv.index(column.iLon, column.iLat, 0);
+    iColumn = bottom.index(column.iLon, column.iLat);
+    iBottom = std::min(then.bottom[iColumn], next.bottom[iColumn]);
+    for (iField = 0; iField < nFields; iField++) {
+      field = euv_source_fields[iField] + index;
+      field_then = then.fields.data() + iField * extents.nPointsG + index;
+      field_next = next.fields.data() + iField * extents.nPointsG + index;
+      for (iAlt = iBottom; iAlt < extents.iAltEnd_; iAlt++)
+	field[iAlt] =
+	  field_then[iAlt] + weight * (field_next[iAlt] - field_then[iAlt]);
+    }
+  }
 
 }
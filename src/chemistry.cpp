@@ -15,17 +15,23 @@
 // Initialize chemistry class
 // -----------------------------------------------------------------------------
 
-Chemistry::Chemistry(Neutrals neutrals,
-		     Ions ions,
-		     Inputs args,
+Chemistry::Chemistry(const Neutrals &neutrals,
+		     const Ions &ions,
+		     const Inputs &args,
 		     Report &report) {
 
-  std::string function = "Chemistry::Chemistry";
+  static std::string function = "Chemistry::Chemistry";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
   int iErr = 0;
 
+  // This limits the time step (if it can change) and says how many
+  // sub-steps the chemistry takes (see Scheduler):
+  Inputs::dt_input_struct dt_input = args.get_dt_inputs();
+  chemistry_change = dt_input.chemistry_change;
+  dt_limit = 1.0e30;
+
   read_chemistry_file(neutrals, ions, args, report);
   
   report.exit(function);
@@ -37,12 +43,12 @@ Chemistry::Chemistry(Neutrals neutrals,
 // Read chemistry file
 // -----------------------------------------------------------------------------
 
-int Chemistry::read_chemistry_file(Neutrals neutrals,
-				   Ions ions,
-				   Inputs args,
+int Chemistry::read_chemistry_file(const Neutrals &neutrals,
+				   const Ions &ions,
+				   const Inputs &args,
 				   Report &report) {
 
-  std::string function = "Chemistry::read_chemistry_file";
+  static std::string function = "Chemistry::read_chemistry_file";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
@@ -94,21 +100,85 @@ int Chemistry::read_chemistry_file(Neutrals neutrals,
     }
 
   }
+
+  compile_reactions();
   
   report.exit(function);
   return iErr;
 }
 
+// -----------------------------------------------------------------------------
+// Compile the reactions into the flat tables that calc_chemical_sources
+// goes through (see chemistry.h).  The reactions stay in the order
+// they are in the file, so each species gets its sources and losses
+// added up in the same order as before.
+// -----------------------------------------------------------------------------
+
+void Chemistry::compile_reactions() {
+
+  long iReaction;
+  int i, iSpecies;
+  long iTarget, iFirstTarget;
+  std::vector<int> values;
+
+  reaction_rates.clear();
+  reactant_start.assign(1, 0);
+  reactant_ids.clear();
+  target_start.assign(1, 0);
+  target_ids.clear();
+  target_coefs.clear();
+
+  for (iReaction = 0; iReaction < nReactions; iReaction++) {
+
+    const reaction_type &reaction = reactions[iReaction];
+    reaction_rates.push_back(reaction.rate);
+
+    // The losses are the reactants, and each one is lost.  Each
+    // source is made.  Where each of them goes in the values of
+    // sources_and_losses_type:
+    values.clear();
+    for (i = 0; i < reaction.nLosses; i++) {
+      iSpecies = reaction.losses_ids[i];
+      if (!reaction.losses_IsNeutral[i]) iSpecies += iFirstIon;
+      reactant_ids.push_back(iSpecies);
+      values.push_back(iSpecies);
+    }
+    reactant_start.push_back(reactant_ids.size());
+    for (i = 0; i < reaction.nSources; i++) {
+      iSpecies = reaction.sources_ids[i];
+      if (!reaction.sources_IsNeutral[i]) iSpecies += iFirstIon;
+      values.push_back(nChemSpecies + iSpecies);
+    }
+
+    // A species that is in there more than once (like O2+ + e- -> O +
+    // O) is one target with a bigger coefficient:
+    iFirstTarget = target_ids.size();
+    for (int value : values) {
+      for (iTarget = iFirstTarget; iTarget < long(target_ids.size()); iTarget++)
+	if (target_ids[iTarget] == value) break;
+      if (iTarget < long(target_ids.size())) {
+	target_coefs[iTarget] = target_coefs[iTarget] + 1.0;
+      } else {
+	target_ids.push_back(value);
+	target_coefs.push_back(1.0);
+      }
+    }
+    target_start.push_back(target_ids.size());
+
+  }
+
+}
+
 // -----------------------------------------------------------------------------
 // Interpret a comma separated line of the chemical reaction file
 // -----------------------------------------------------------------------------
 
-Chemistry::reaction_type Chemistry::interpret_reaction_line(Neutrals neutrals,
-							    Ions ions,
-							    std::vector<std::string> line,
+Chemistry::reaction_type Chemistry::interpret_reaction_line(const Neutrals &neutrals,
+							    const Ions &ions,
+							    const std::vector<std::string> &line,
 							    Report &report) {
 
-  std::string function = "Chemistry::interpret_reaction_line";
+  static std::string function = "Chemistry::interpret_reaction_line";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
@@ -158,14 +228,14 @@ Chemistry::reaction_type Chemistry::interpret_reaction_line(Neutrals neutrals,
 // Match a string to the neutral or ion species
 // -----------------------------------------------------------------------------
 
-void Chemistry::find_species_id(std::string name,
-				Neutrals neutrals,
-				Ions ions,
+void Chemistry::find_species_id(const std::string &name,
+				const Neutrals &neutrals,
+				const Ions &ions,
 				int &id_,
 				int &IsNeutral,
 				Report &report) {
 
-  std::string function = "Chemistry::find_species_id";
+  static std::string function = "Chemistry::find_species_id";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
@@ -203,7 +273,7 @@ void Chemistry::find_species_id(std::string name,
 // Display a reaction:
 // -----------------------------------------------------------------------------
 
-void Chemistry::display_reaction(Chemistry::reaction_type reaction) {
+void Chemistry::display_reaction(const Chemistry::reaction_type &reaction) {
 
   int i;
 
@@ -14,11 +14,11 @@
 bfield_info_type get_dipole(float lon,
 			    float lat,
 			    float alt,
-			    Planets planet,
-			    Inputs input,
+			    const Planets &planet,
+			    const Inputs &input,
 			    Report &report) {
 
-  std::string function = "dipole";
+  static std::string function = "dipole";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
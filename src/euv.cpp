@@ -17,7 +17,7 @@
 // Initialize EUV
 // -----------------------------------------------------------------------------
 
-Euv::Euv(Inputs args, Report report) {
+Euv::Euv(const Inputs &args, Report &report) {
 
   int iErr;
   float ave;
@@ -46,12 +46,37 @@ Euv::Euv(Inputs args, Report report) {
       }
     }
 
+    euv_model = args.get_euv_model();
+    if (euv_model != "euvac" && euv_model != "fixed" && euv_model != "file") {
+      std::cout << "Unknown #euv_model (" << euv_model
+		<< "), so it is euvac!\n";
+      euv_model = "euvac";
+    }
+
+    // EUVAC needs F10.7, so without it, the spectrum is fixed:
+    if (euv_model == "euvac" && args.get_f107_file().length() == 0) {
+      std::cout << "No #f107file, so the EUV spectrum is fixed!\n";
+      euv_model = "fixed";
+    }
+
     // Slot the EUVAC model coefficients:
-    if (args.get_euv_model() == "euvac") {
+    if (euv_model == "euvac" || euv_model == "fixed") {
       iErr = slot_euv("F74113", "", euvac_f74113, report);
       iErr = slot_euv("AFAC", "", euvac_afac, report);
     }
+
+    if (euv_model == "file")
+      iErr = spectrum_file.open(args.get_euv_spectrum_file(),
+				nWavelengths,
+				report);
   }
+
+  IsOk = (iErr == 0);
+
+}
+
+int Euv::is_ok() const {
+  return IsOk;
 }
 
 // ---------------------------------------------------------------------------
@@ -59,7 +84,7 @@ Euv::Euv(Inputs args, Report report) {
 // cross sections
 // ---------------------------------------------------------------------------
 
-int Euv::read_file(Inputs args, Report report) {
+int Euv::read_file(const Inputs &args, Report &report) {
 
   waveinfotype tmp;
   std::string line, col;
@@ -138,10 +163,10 @@ int Euv::read_file(Inputs args, Report report) {
 //
 // ---------------------------------------------------------------------------
 
-int Euv::slot_euv(std::string item,
-		  std::string item2,
+int Euv::slot_euv(const std::string &item,
+		  const std::string &item2,
 		  std::vector<float> &values,
-		  Report report) {
+		  Report &report) {
 
   int iErr = 0;
   int iLine;
@@ -186,8 +211,8 @@ int Euv::slot_euv(std::string item,
 // Scale flux (intensity) at 1 AU to distance from the sun:
 // --------------------------------------------------------------------------
 
-int Euv::scale_from_1au(Planets planet,
-			Times time) {
+int Euv::scale_from_1au(Planets &planet,
+			const Times &time) {
 
   int iErr = 0;
   float d = planet.get_star_to_planet_dist(time);
@@ -200,28 +225,97 @@ int Euv::scale_from_1au(Planets planet,
 
 }
 
+// --------------------------------------------------------------------------
+// The spectrum at 1 AU, from whichever model (see euv.h)
+// --------------------------------------------------------------------------
+
+int Euv::calc_spectrum(const Times &time,
+		       const Indices &indices,
+		       Report &report) {
+
+  int iErr = 0;
+  float f107, f107a;
+
+  if (euv_model == "file") {
+
+    // The file couldn't be opened (see the constructor):
+    if (spectrum_file.get_nRecords() == 0) return 1;
+
+    long iRecord;
+    float weight;
+    spectrum_file.find(time.get_current(), iRecord, weight);
+
+    // Before the first or past the last record, the spectrum at that
+    // end is held, which isn't an error, but it should be said (once):
+    int IsOutside =
+      (time.get_current() < spectrum_file.get_time(0) ||
+       time.get_current() > spectrum_file.get_time(spectrum_file.get_nRecords() - 1));
+    if (IsOutside && !IsOutsideFile)
+      std::cout << "EUV : the time is outside of the spectrum file, so the "
+		<< (iRecord == 0 ? "first" : "last")
+		<< " spectrum in it is held!\n";
+    IsOutsideFile = IsOutside;
+    if (iRecord == spectrum_iRecord && weight == spectrum_weight)
+      return iErr;
+
+    const float *before = spectrum_file.intensity(iRecord);
+    if (weight > 0.0) {
+      const float *after = spectrum_file.intensity(iRecord + 1);
+      for (int iWave = 0; iWave < nWavelengths; iWave++)
+	wavelengths_intensity_1au[iWave] =
+	  (1.0 - weight) * before[iWave] + weight * after[iWave];
+    } else {
+      for (int iWave = 0; iWave < nWavelengths; iWave++)
+	wavelengths_intensity_1au[iWave] = before[iWave];
+    }
+    spectrum_iRecord = iRecord;
+    spectrum_weight = weight;
+
+  } else {
+
+    if (euv_model == "fixed") {
+      f107 = 100.0;
+      f107a = 100.0;
+    } else {
+      f107 = indices.get_f107(time.get_current());
+      f107a = indices.get_f107a(time.get_current());
+    }
+    if (f107 != spectrum_f107 || f107a != spectrum_f107a) {
+      iErr = euvac(f107, f107a, report);
+      spectrum_f107 = f107;
+      spectrum_f107a = f107a;
+    }
+
+  }
+
+  return iErr;
+
+}
+
+// --------------------------------------------------------------------------
+// Forget what the spectrum at 1 AU was made from (see euv.h)
+// --------------------------------------------------------------------------
+
+void Euv::reset_spectrum() {
+  spectrum_f107 = -1.0;
+  spectrum_f107a = -1.0;
+  spectrum_iRecord = -1;
+  spectrum_weight = -1.0;
+}
+
 // --------------------------------------------------------------------------
 // EUVAC
 // --------------------------------------------------------------------------
 
-int Euv::euvac(Times time,
-	       Indices indices,
-	       Report &report) {
+int Euv::euvac(float f107, float f107a, Report &report) {
 
   int iErr = 0;
   float slope;
 
-  std::string function="Euv::euvac";
+  static std::string function="Euv::euvac";
   static int iFunction = -1;
   report.enter(function, iFunction);  
-  
-  float f107 = indices.get_f107(time.get_current());
-  float f107a = indices.get_f107a(time.get_current());
-
-  f107 = 100.0;
-  f107a = 100.0;
 
-  
   float mean_f107 = (f107 + f107a)/2.0;
 
   if (report.test_verbose(7))
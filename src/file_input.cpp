@@ -131,6 +131,37 @@ int read_int(std::ifstream &file_ptr, std::string hash) {
   return output;
 }
 
+// -------------------------------------------------------------------
+// Read a string, clean it up, and convert it to a float
+// -------------------------------------------------------------------
+
+float read_float(std::ifstream &file_ptr, std::string hash) {
+
+  std::string line="";
+  float output = -1.0;
+  
+  if (!file_ptr.is_open()) {
+    std::cout << "File is not open (read_float)!\n";
+    std::cout << "hash : " << hash << "\n";
+  } else {
+
+    getline(file_ptr,line);
+    line = strip_string_end(line);
+
+    try {
+      output = stof(line);
+    }
+    catch(...) {
+      std::cout << "Issue in read_inputs!\n";
+      std::cout << "In hash: ";
+      std::cout << hash << "\n";
+      std::cout << "Trying to read a float, but got this: ";
+      std::cout << line << "\n";
+    }    
+  }
+  return output;
+}
+
 // -------------------------------------------------------------------
 // Read the file until it gets to a # as the first character
 // -------------------------------------------------------------------
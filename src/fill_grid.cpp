@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <math.h>
+#include <map>
+#include <vector>
 
 #include "../include/inputs.h"
 #include "../include/constants.h"
@@ -12,83 +14,107 @@
 #include "../include/planets.h"
 #include "../include/transform.h"
 #include "../include/bfield.h"
+#include "../include/solvers.h"
 
 // -----------------------------------------------------------------------------
-//  Fill in Solar Zenith Angle and cos(solar zenith angle)
+//  Fill in Solar Zenith Angle and cos(solar zenith angle).  These only
+//  depend on lon and lat, so this is done once per column.  With
+//  dt_ahead, this is where the sun will be dt_ahead seconds from now
+//  (the planet turns, but the declination over a few minutes is left
+//  alone), for the EUV interpolation (see calc_euv).
 // -----------------------------------------------------------------------------
 
-void Grid::calc_sza(Planets planet, Times time, Report &report) {
+void Grid::calc_sza(Planets &planet,
+		    const Times &time,
+		    Workers &workers,
+		    Report &report,
+		    float dt_ahead) {
 
-  long iLon, iLat, iAlt, index;
-  float local_time;
-
-  std::string function = "Grid::calc_sza";
+  static std::string function = "Grid::calc_sza";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
-  float lon_offset = planet.get_longitude_offset(time);
-  float sin_dec = planet.get_sin_dec(time);
-  float cos_dec = planet.get_cos_dec(time);
+  sun_struct sun = calc_sun(planet, time, dt_ahead);
 
-  for (iLon = 0; iLon < nGeoLonsG; iLon++) {
-    for (iLat = 0; iLat < nGeoLatsG; iLat++) {
-      for (iAlt = 0; iAlt < nGeoAltsG; iAlt++) {
+  workers.run([&](const tile_struct &tile, int iThread) {
+    calc_sza_columns(sun, tile);
+  });
 
-	index = ijk_geo_s3gc(iLon,iLat,iAlt);
+  report.exit(function);
 
-	// This is in radians:
-	local_time = fmod(lon_offset + geoLon_s3gc[index] + twopi, twopi);
-	
-	cos_sza_s3gc[index] =
-	  sin_dec * sin(geoLat_s3gc[index]) +
-	  cos_dec * cos(geoLat_s3gc[index]) * cos(local_time-pi);
-	
-	sza_s3gc[index] = acos(cos_sza_s3gc[index]);
+}
+
+Grid::sun_struct Grid::calc_sun(Planets &planet,
+				const Times &time,
+				float dt_ahead) const {
+  sun_struct sun;
+  sun.lon_offset = planet.get_longitude_offset(time) +
+    twopi * dt_ahead / planet.get_length_of_day();
+  sun.sin_dec = planet.get_sin_dec(time);
+  sun.cos_dec = planet.get_cos_dec(time);
+  return sun;
+}
+
+void Grid::calc_sza_columns(const sun_struct &sun, const tile_struct &tile) {
+
+  Field2D<float> sza(sza_s2gc, extents);
+
+  long iLon, iLat, index;
+  float local_time;
+
+  for (iLon = tile.iLonStart; iLon < tile.iLonEnd; iLon++) {
+    for (iLat = tile.iLatStart; iLat < tile.iLatEnd; iLat++) {
+
+      index = sza.index(iLon, iLat);
+
+      // This is in radians:
+      local_time = fmod(sun.lon_offset + geoLon_s2gc[index] + twopi, twopi);
+
+      cos_sza_s2gc[index] =
+	sun.sin_dec * sin(geoLat_s2gc[index]) +
+	sun.cos_dec * cos(geoLat_s2gc[index]) * cos(local_time-pi);
+
+      sza_s2gc[index] = acos(cos_sza_s2gc[index]);
 
-      }
     }
   }
 
-  report.exit(function);
-
 }
 
 // -----------------------------------------------------------------------------
 //  fill grid with magnetic field values
 // -----------------------------------------------------------------------------
 
-void Grid::fill_grid_bfield(Planets planet, Inputs input, Report &report) {
+void Grid::fill_grid_bfield(const Planets &planet,
+			    const Inputs &input,
+			    Report &report) {
 
-  std::string function = "Grid::fill_grid_bfield";
+  static std::string function = "Grid::fill_grid_bfield";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
-  long nLons, nLats, nAlts, iLon, iLat, iAlt, iDim, index, indexv;
+  long iLon, iLat, iAlt, iDim, index;
   float lon, lat, alt;
   bfield_info_type bfield_info;
   
-  if (IsGeoGrid) {
-    nLons = nGeoLonsG;
-    nLats = nGeoLatsG;
-    nAlts = nGeoAltsG;
-  } else {
-    nLons = nMagLonsG;
-    nLats = nMagLatsG;
-    nAlts = nMagAltsG;
-  }
+  long nLons = extents.nLonsG;
+  long nLats = extents.nLatsG;
+  long nAlts = extents.nAltsG;
+
+  Field3D<float, 3> bfield(bfield_v3gc, extents);
+  Field2D<float> geoLon(geoLon_s2gc, extents);
+  Field2D<float> geoLat(geoLat_s2gc, extents);
 
   for (iLon = 0; iLon < nLons; iLon++) {
     for (iLat = 0; iLat < nLats; iLat++) {
+
+      lon = geoLon(iLon, iLat);
+      lat = geoLat(iLon, iLat);
+
       for (iAlt = 0; iAlt < nAlts; iAlt++) {
 
-	if (IsGeoGrid) {
-	  index = ijk_geo_s3gc(iLon,iLat,iAlt);
-	} else {
-	  index = ijk_mag_s3gc(iLon,iLat,iAlt);
-	}
+	index = bfield.index(iLon, iLat, iAlt);
 
-	lon = geoLon_s3gc[index];
-	lat = geoLat_s3gc[index];
 	alt = geoAlt_s3gc[index];
 	
 	bfield_info = get_bfield(lon, lat, alt, planet, input, report);
@@ -96,14 +122,8 @@ void Grid::fill_grid_bfield(Planets planet, Inputs input, Report &report) {
 	magLat_s3gc[index] = bfield_info.lat;
 	magLon_s3gc[index] = bfield_info.lon;
 
-	for (iDim = 0; iDim < 3; iDim++) {
-	  if (IsGeoGrid) {
-	    indexv = ijkl_geo_v3gc(iLon,iLat,iAlt,iDim);
-	  } else {
-	    indexv = ijkl_mag_v3gc(iLon,iLat,iAlt,iDim);
-	  }
-	  bfield_v3gc[indexv] = bfield_info.b[iDim];
-	}
+	for (iDim = 0; iDim < 3; iDim++)
+	  bfield(iLon, iLat, iAlt, iDim) = bfield_info.b[iDim];
 	
       }
     }
@@ -114,46 +134,114 @@ void Grid::fill_grid_bfield(Planets planet, Inputs input, Report &report) {
 }
 
 // -----------------------------------------------------------------------------
-//  Fill in radius, radius^2, and 1/radius^2
+//  Fill in radius, radius^2, 1/radius^2, gravity and the cell sizes in
+//  altitude.  Columns only differ if their altitudes or the radius of
+//  the planet under them differ, so the columns that match share a
+//  profile.
 // -----------------------------------------------------------------------------
 
-void Grid::fill_grid_radius(Planets planet, Report &report) {
+void Grid::fill_column_geometry(const Planets &planet,
+				Arena &arena,
+				Report &report) {
 
-  long iLon, iLat, iAlt, index;
+  long iLon, iLat, iAlt, iProfile;
+  float radius0, *alts;
 
-  float radius0;
   float mu = planet.get_mu();
+  long nAlts = extents.nAltsG;
 
-  report.print(3, "starting fill_grid_radius");
-  
-  for (iLon = 0; iLon < nGeoLonsG; iLon++) {
-    for (iLat = 0; iLat < nGeoLatsG; iLat++) {
-      for (iAlt = 0; iAlt < nGeoAltsG; iAlt++) {
+  static std::string function = "Grid::fill_column_geometry";
+  static int iFunction = -1;
+  report.enter(function, iFunction);  
 
-	if (IsGeoGrid) {
-	  index = ijk_geo_s3gc(iLon,iLat,iAlt);
-	} else {
-	  index = ijk_mag_s3gc(iLon,iLat,iAlt);
-	}
+  Field3D<float> alt(geoAlt_s3gc, extents);
+  Field2D<float> geoLat(geoLat_s2gc, extents);
 
-	// Set radius and radius^2:
+  // The radius of the planet under the column, then its altitudes, is
+  // what makes the column unique:
+  std::map<std::vector<float>, long> profile_of_column;
+  std::vector<float> key(nAlts + 1);
+  std::vector<column_struct> first_column;
 
-	radius0 = planet.get_radius(geoLat_s3gc[index]);
+  iProfile_s2gc = arena.allocate_indices(extents.nColumnsG);
 
-	radius_s3gc[index] =
-	  radius0 + geoAlt_s3gc[index];
-	radius_sq_s3gc[index] =
-	  radius_s3gc[index] * radius_s3gc[index];
-	radius_inv_sq_s3gc[index] =
-	  1.0/radius_sq_s3gc[index];
+  for (column_struct column : alt.columns()) {
 
-	gravity_s3gc[index] = mu * radius_inv_sq_s3gc[index];
+    key[0] = planet.get_radius(geoLat(column.iLon, column.iLat));
+    alts = alt.column(column.iLon, column.iLat);
+    for (iAlt = 0; iAlt < nAlts; iAlt++) key[iAlt + 1] = alts[iAlt];
 
-      }
+    auto found = profile_of_column.find(key);
+    if (found == profile_of_column.end()) {
+      iProfile = first_column.size();
+      profile_of_column[key] = iProfile;
+      first_column.push_back(column);
+    } else {
+      iProfile = found->second;
+    }
+
+    iProfile_s2gc[geoLat.index(column.iLon, column.iLat)] = iProfile;
+
+  }
+
+  nProfiles = first_column.size();
+
+  if (report.test_verbose(2))
+    std::cout << "Grid geometry : " << nProfiles << " profile(s) for "
+	      << extents.nColumnsG << " columns\n";
+
+  radius_s1gc = arena.allocate(nProfiles * nAlts);
+  radius_sq_s1gc = arena.allocate(nProfiles * nAlts);
+  radius_inv_sq_s1gc = arena.allocate(nProfiles * nAlts);
+  gravity_s1gc = arena.allocate(nProfiles * nAlts);
+  dalt_center_s1gc = arena.allocate(nProfiles * nAlts);
+  dalt_lower_s1gc = arena.allocate(nProfiles * nAlts);
+  conduction_r_s1gc = arena.allocate(nProfiles * nAlts);
+  conduction_du12_s1gc = arena.allocate(nProfiles * nAlts);
+  conduction_du22_s1gc = arena.allocate(nProfiles * nAlts);
+
+  for (iProfile = 0; iProfile < nProfiles; iProfile++) {
+
+    iLon = first_column[iProfile].iLon;
+    iLat = first_column[iProfile].iLat;
+
+    radius0 = planet.get_radius(geoLat(iLon, iLat));
+    alts = alt.column(iLon, iLat);
+
+    float *radius = radius_s1gc + iProfile * nAlts;
+    float *radius_sq = radius_sq_s1gc + iProfile * nAlts;
+    float *radius_inv_sq = radius_inv_sq_s1gc + iProfile * nAlts;
+    float *gravity = gravity_s1gc + iProfile * nAlts;
+    float *dalt_center = dalt_center_s1gc + iProfile * nAlts;
+    float *dalt_lower = dalt_lower_s1gc + iProfile * nAlts;
+
+    for (iAlt = 0; iAlt < nAlts; iAlt++) {
+      radius[iAlt] = radius0 + alts[iAlt];
+      radius_sq[iAlt] = radius[iAlt] * radius[iAlt];
+      radius_inv_sq[iAlt] = 1.0/radius_sq[iAlt];
+      gravity[iAlt] = mu * radius_inv_sq[iAlt];
     }
+
+    for (iAlt = 1; iAlt < nAlts-1; iAlt++) {
+      dalt_center[iAlt] = (alts[iAlt+1] - alts[iAlt-1])/2;
+      dalt_lower[iAlt] = alts[iAlt] - alts[iAlt-1];
+    }
+
+    // Edges:
+    dalt_center[0] = dalt_center[1];
+    dalt_lower[0] = dalt_lower[1];
+    dalt_center[nAlts-1] = dalt_center[nAlts-2];
+    dalt_lower[nAlts-1] = dalt_lower[nAlts-2];
+
+    conduction_metrics(dalt_lower,
+		       conduction_r_s1gc + iProfile * nAlts,
+		       conduction_du12_s1gc + iProfile * nAlts,
+		       conduction_du22_s1gc + iProfile * nAlts,
+		       nAlts);
+
   }
- 
-  report.print(3, "ending fill_grid_radius");
+
+  report.exit(function);
 
 }
 
@@ -161,41 +249,32 @@ void Grid::fill_grid_radius(Planets planet, Report &report) {
 //  Fill in XYZ in geo and mag coordinates
 // -----------------------------------------------------------------------------
 
-void Grid::fill_grid(Planets planet, Report &report) {
+void Grid::fill_grid(const Planets &planet, Report &report) {
 
   long iLon, iLat, iAlt, index;
 
-  long indexp, indexm;
-  long nLons, nLats, nAlts;
+  long nLons = extents.nLonsG;
+  long nLats = extents.nLatsG;
+  long nAlts = extents.nAltsG;
   
   report.print(3, "starting fill_grid");
-  
-  if (IsGeoGrid) {
-    nLons = nGeoLonsG;
-    nLats = nGeoLatsG;
-    nAlts = nGeoAltsG;
-  } else {
-    nLons = nMagLonsG;
-    nLats = nMagLatsG;
-    nAlts = nMagAltsG;
-  }
 
   float xyz[3], llr[3];
-  
+
+  Field3D<float> alt(geoAlt_s3gc, extents);
+  Field2D<float> geoLon(geoLon_s2gc, extents);
+  Field2D<float> geoLat(geoLat_s2gc, extents);
+
   for (iLon = 0; iLon < nLons; iLon++) {
     for (iLat = 0; iLat < nLats; iLat++) {
       for (iAlt = 0; iAlt < nAlts; iAlt++) {
 
-	if (IsGeoGrid) {
-	  index = ijk_geo_s3gc(iLon,iLat,iAlt);
-	} else {
-	  index = ijk_mag_s3gc(iLon,iLat,iAlt);
-	}
+	index = alt.index(iLon, iLat, iAlt);
 
 	// Find XYZ coordinates (Geo):
 	
-	llr[0] = geoLon_s3gc[index];
-	llr[1] = geoLat_s3gc[index];
+	llr[0] = geoLon(iLon, iLat);
+	llr[1] = geoLat(iLon, iLat);
 	llr[2] = geoAlt_s3gc[index];
 
 	transform_llr_to_xyz(llr, xyz);
@@ -216,60 +295,10 @@ void Grid::fill_grid(Planets planet, Report &report) {
 	//magY_s3gc[index] = xyz[1];
 	//magZ_s3gc[index] = xyz[2];
 
-	if (iAlt > 0 && iAlt < nAlts-1) {
-	  if (IsGeoGrid) {
-	    indexp = ijk_geo_s3gc(iLon,iLat,iAlt+1);
-	    indexm = ijk_geo_s3gc(iLon,iLat,iAlt-1);
-	  } else {
-	    indexp = ijk_mag_s3gc(iLon,iLat,iAlt+1);
-	    indexm = ijk_mag_s3gc(iLon,iLat,iAlt-1);
-	  }
-	  
-	  dalt_center_s3gc[index] =
-	    (geoAlt_s3gc[indexp] - geoAlt_s3gc[indexm])/2;
-	  dalt_lower_s3gc[index] =
-	    geoAlt_s3gc[index] - geoAlt_s3gc[indexm];
-	  
-	}
-	
       }
     }
   }
 
-  report.print(4, "filling edges");
-
-  for (iLon = 0; iLon < nLons; iLon++) {
-    for (iLat = 0; iLat < nLats; iLat++) {
-
-      iAlt = 0;
-
-      if (IsGeoGrid) {
-	index = ijk_geo_s3gc(iLon,iLat,iAlt);
-	indexp = ijk_geo_s3gc(iLon,iLat,iAlt+1);
-      } else {
-	index = ijk_mag_s3gc(iLon,iLat,iAlt);
-	indexp = ijk_mag_s3gc(iLon,iLat,iAlt+1);
-      }
-
-      dalt_center_s3gc[index] = dalt_center_s3gc[indexp];
-      dalt_lower_s3gc[index] = dalt_lower_s3gc[indexp];
-
-      iAlt = nAlts-1;
-
-      if (IsGeoGrid) {
-	index = ijk_geo_s3gc(iLon,iLat,iAlt);
-	indexm = ijk_geo_s3gc(iLon,iLat,iAlt-1);
-      } else {
-	index = ijk_mag_s3gc(iLon,iLat,iAlt);
-	indexm = ijk_mag_s3gc(iLon,iLat,iAlt-1);
-      }
-
-      dalt_center_s3gc[index] = dalt_center_s3gc[indexm];
-      dalt_lower_s3gc[index] = dalt_lower_s3gc[indexm];
-      
-    }
-  }
-
   report.print(3, "ending fill_grid");
 
   
@@ -6,45 +6,58 @@
 #include "../include/inputs.h"
 #include "../include/grid.h"
 #include "../include/sizes.h"
+#include "../include/arena.h"
 
-Grid::Grid(int nX, int nY, int nZ) {
+Grid::Grid(int nLons, int nLats, int nAlts, int nGCs, Arena &arena)
+  : Grid(grid_extents(nLons, nLats, nAlts, nGCs), arena) {}
 
-  long nTotalPoints = long(nX) * long(nY) * long(nZ);
+// -----------------------------------------------------------------------------
+// A grid that is a block of a bigger grid (see parallel.h)
+// -----------------------------------------------------------------------------
 
-  geoLon_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  geoLat_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  geoAlt_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  geoX_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  geoY_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  geoZ_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
+Grid::Grid(grid_extents extents_in, Arena &arena) {
 
-  magLon_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  magLat_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  magAlt_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  magX_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  magY_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  magZ_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
+  extents = extents_in;
 
-  magLocalTime_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
+  long nTotalPoints = extents.nPointsG;
+  long nColumns = extents.nColumnsG;
 
-  radius_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  radius_sq_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  radius_inv_sq_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
+  geoLon_s2gc = arena.allocate(nColumns);
+  geoLat_s2gc = arena.allocate(nColumns);
+  geoAlt_s3gc = arena.allocate(nTotalPoints);
+  geoX_s3gc = arena.allocate(nTotalPoints);
+  geoY_s3gc = arena.allocate(nTotalPoints);
+  geoZ_s3gc = arena.allocate(nTotalPoints);
 
-  gravity_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
+  magLon_s3gc = arena.allocate(nTotalPoints);
+  magLat_s3gc = arena.allocate(nTotalPoints);
+  magAlt_s3gc = arena.allocate(nTotalPoints);
+  magX_s3gc = arena.allocate(nTotalPoints);
+  magY_s3gc = arena.allocate(nTotalPoints);
+  magZ_s3gc = arena.allocate(nTotalPoints);
 
-  sza_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  cos_sza_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
+  magLocalTime_s3gc = arena.allocate(nTotalPoints);
 
-  bfield_v3gc = (float*) malloc( 3 * nTotalPoints * sizeof(float) );
-  bfield_mag_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
+  // The geometry profiles are made once the altitudes are known
+  // (fill_column_geometry):
+  nProfiles = 0;
+  iProfile_s2gc = NULL;
+  radius_s1gc = NULL;
+  radius_sq_s1gc = NULL;
+  radius_inv_sq_s1gc = NULL;
+  gravity_s1gc = NULL;
+  dalt_center_s1gc = NULL;
+  dalt_lower_s1gc = NULL;
+
+  sza_s2gc = arena.allocate(nColumns);
+  cos_sza_s2gc = arena.allocate(nColumns);
+
+  bfield_v3gc = arena.allocate(nTotalPoints, 3);
+  bfield_mag_s3gc = arena.allocate(nTotalPoints);
 
-  dalt_center_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  dalt_lower_s3gc = (float*) malloc( nTotalPoints * sizeof(float) );
-  
 }
 
-int Grid::get_IsGeoGrid() {
+int Grid::get_IsGeoGrid() const {
   return IsGeoGrid;
 }
 
@@ -52,11 +65,11 @@ void Grid::set_IsGeoGrid(int value) {
   IsGeoGrid = value;
 }
 
-long Grid::get_nPointsInGrid() {
-  long nPoints;
-  if (IsGeoGrid)
-    nPoints = long(nGeoLons) * long(nGeoLats) * long(nGeoAlts);
-  else
-    nPoints = long(nMagLons) * long(nMagLats) * long(nMagAlts);
-  return nPoints;
+// -----------------------------------------------------------------------------
+// Number of points in the grid, including the ghost cells, since this is
+// how big a _s3gc variable is:
+// -----------------------------------------------------------------------------
+
+long Grid::get_nPointsInGrid() const {
+  return extents.nPointsG;
 }
@@ -10,7 +10,7 @@
 #include "../include/indices.h"
 #include "../include/read_f107_file.h"
 
-Indices::Indices(Inputs args) {
+Indices::Indices(const Inputs &args) {
   int iErr;
   std::string file;
 
@@ -30,8 +30,8 @@ Indices::Indices(Inputs args) {
 
 }
 
-int Indices::set_f107(std::vector<double> time,
-		      std::vector<float> f107array) {
+int Indices::set_f107(const std::vector<double> &time,
+		      const std::vector<float> &f107array) {
 
   int iErr = set_index(time, f107array, f107);
 
@@ -82,19 +82,20 @@ int Indices::set_f107(std::vector<double> time,
 
 }
 
-float Indices:: get_f107(double time) {
+float Indices:: get_f107(double time) const {
 
   return get_index(time, f107);
 
 }
 
-float Indices:: get_f107a(double time) {
+float Indices:: get_f107a(double time) const {
 
   return get_index(time, f107a);
 
 }
 
-float Indices::get_index(double time, std::vector<ind_time_pair> index) {
+float Indices::get_index(double time,
+			 const std::vector<ind_time_pair> &index) const {
 
   long iLow, iMid, iHigh;
 
@@ -131,8 +132,8 @@ float Indices::get_index(double time, std::vector<ind_time_pair> index) {
 
 }
 
-int Indices::set_index(std::vector<double> time,
-		       std::vector<float> indexarray,
+int Indices::set_index(const std::vector<double> &time,
+		       const std::vector<float> &indexarray,
 		       std::vector<ind_time_pair> &index) {
 
   int iErr;
@@ -2,6 +2,9 @@
 // Full license can be found in License.md
 
 #include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
 
 #include "../include/inputs.h"
 #include "../include/report.h"
@@ -9,10 +12,15 @@
 #include "../include/planets.h"
 #include "../include/sizes.h"
 #include "../include/fill_grid.h"
+#include "../include/file_input.h"
+#include "../include/constants.h"
 
-void Grid::init_geo_grid(Planets planet, Inputs input, Report &report) {
+void Grid::init_geo_grid(const Planets &planet,
+			 const Inputs &input,
+			 Arena &arena,
+			 Report &report) {
 
-  std::string function="Grid::init_geo_grid";
+  static std::string function="Grid::init_geo_grid";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
@@ -23,42 +31,260 @@ void Grid::init_geo_grid(Planets planet, Inputs input, Report &report) {
   long iLon, iLat, iAlt, index;
   float longitude, latitude, altitude;
 
-  float altitudes[nGeoAltsG];
+  long nLons = extents.nLonsG;
+  long nLats = extents.nLatsG;
+  long nAlts = extents.nAltsG;
+  long nGCs = extents.nGCs;
 
-  float dlat = (grid_input.lat_max - grid_input.lat_min) / nGeoLats;
-  float dlon = (grid_input.lon_max - grid_input.lon_min) / nGeoLons;
+  std::vector<float> altitudes(nAlts);
+
+  // This may be a block of the whole grid (see parallel.h), so the
+  // spacing is from the whole grid, and the cells are offset:
+  float dlat = (grid_input.lat_max - grid_input.lat_min) / extents.nLatsGlobal;
+  float dlon = (grid_input.lon_max - grid_input.lon_min) / extents.nLonsGlobal;
 
   IsGeoGrid = 1;
   
-  // Make a uniform grid in altitude:
-  if (grid_input.IsUniformAlt) {
-    for (iAlt=0; iAlt < nGeoAltsG; iAlt++) {
+  // The altitudes can come from a file, be stretched with the scale
+  // height, or be uniform.  If the file or the stretching doesn't
+  // work, fall back to a uniform grid:
+  int iErr = 1;
+
+  if (grid_input.alt_file.length() > 0) {
+    iErr = read_altitude_file(grid_input.alt_file, altitudes, report);
+  } else if (!grid_input.IsUniformAlt) {
+    iErr = calc_stretched_altitudes(planet, input, altitudes, report);
+  } else {
+    for (iAlt=0; iAlt < nAlts; iAlt++) {
       altitudes[iAlt] =
-	grid_input.alt_min + float(iAlt-nGeoGhosts)*grid_input.dalt;
+	grid_input.alt_min + float(iAlt-nGCs)*grid_input.dalt;
     }
-  } else {
-    // calc_stretched_altitudes(input, planet, altitudes);
+    iErr = 0;
   }
 
-  for (iLon = 0; iLon < nGeoLonsG; iLon++) {
-    longitude = grid_input.lon_min + (float(iLon-nGeoGhosts)+0.5) * dlon;
-    for (iLat = 0; iLat < nGeoLatsG; iLat++) {
-      latitude = grid_input.lat_min + (float(iLat-nGeoGhosts)+0.5) * dlat;
-      for (iAlt = 0; iAlt < nGeoAltsG; iAlt++) {
-	index = ijk_geo_s3gc(iLon,iLat,iAlt);
-	geoLon_s3gc[index] = longitude;
-	geoLat_s3gc[index] = latitude;
+  if (iErr > 0) {
+    std::cout << "Could not make the altitude grid, so using a uniform"
+	      << " grid with dalt = 2.5 km!\n";
+    for (iAlt=0; iAlt < nAlts; iAlt++) {
+      altitudes[iAlt] =
+	grid_input.alt_min + float(iAlt-nGCs)*2500.0;
+    }
+  }
+
+  if (report.test_verbose(2))
+    std::cout << "Altitude grid : " << altitudes[nGCs]/1000.0 << " to "
+	      << altitudes[nAlts-nGCs-1]/1000.0 << " km\n";
+
+  Field3D<float> alt(geoAlt_s3gc, extents);
+  Field2D<float> lon(geoLon_s2gc, extents);
+  Field2D<float> lat(geoLat_s2gc, extents);
+
+  for (iLon = 0; iLon < nLons; iLon++) {
+    longitude = grid_input.lon_min +
+      (float(iLon - nGCs + extents.iLonOffset) + 0.5) * dlon;
+    for (iLat = 0; iLat < nLats; iLat++) {
+      latitude = grid_input.lat_min +
+	(float(iLat - nGCs + extents.iLatOffset) + 0.5) * dlat;
+      lon(iLon, iLat) = longitude;
+      lat(iLon, iLat) = latitude;
+      for (iAlt = 0; iAlt < nAlts; iAlt++) {
+	index = alt.index(iLon, iLat, iAlt);
 	geoAlt_s3gc[index] = altitudes[iAlt];
       }
     }
   }
 
-  // Calculate the radius, etc:
+  // Calculate the radius, gravity, cell sizes, etc:
 
-  fill_grid_radius(planet, report);
+  fill_column_geometry(planet, arena, report);
 
   fill_grid_bfield(planet, input, report);
   
   report.exit(function);  
 
 }
+
+// -----------------------------------------------------------------------------
+// Stretch the altitude grid with the scale height, so each cell is
+// dalt scale heights thick.  The cells are small at the bottom, where
+// the scale height is small, and large in the upper thermosphere, so
+// far fewer cells are needed for the same top altitude.  The scale
+// height uses the temperature profile and the mean mass at the lower
+// boundary (weighted by the BC densities) from the planet file, so
+// it is only a reference scale height for spacing out the grid.
+// -----------------------------------------------------------------------------
+
+int Grid::calc_stretched_altitudes(const Planets &planet,
+				   const Inputs &input,
+				   std::vector<float> &altitudes,
+				   Report &report) {
+
+  int iErr = 0;
+  long iAlt;
+  std::string hash;
+  std::vector<float> temp_alts, temps;
+  float mass_sum = 0.0, density_sum = 0.0, density;
+
+  static std::string function = "Grid::calc_stretched_altitudes";
+  static int iFunction = -1;
+  report.enter(function, iFunction);  
+
+  Inputs::grid_input_struct grid_input = input.get_grid_inputs();
+
+  std::ifstream infile_ptr;
+  infile_ptr.open(input.get_planet_species_file());
+
+  if (!infile_ptr.is_open()) {
+    std::cout << "Could not open planet file for the stretched grid : "
+	      << input.get_planet_species_file() << "\n";
+    iErr = 1;
+  } else {
+    while (!infile_ptr.eof()) {
+      hash = find_next_hash(infile_ptr);
+      if (hash == "#neutrals") {
+	// name, mass, vibration, thermal_cond, thermal_exp, advect, BC
+	std::vector<std::vector<std::string>> lines = read_csv(infile_ptr);
+	for (unsigned long iLine = 1; iLine < lines.size(); iLine++) {
+	  density = stof(lines[iLine][6]);
+	  if (density > 0.0) {
+	    mass_sum = mass_sum + density * stof(lines[iLine][1]) * amu;
+	    density_sum = density_sum + density;
+	  }
+	}
+      }
+      if (hash == "#temperature") {
+	std::vector<std::vector<std::string>> lines = read_csv(infile_ptr);
+	for (unsigned long iLine = 1; iLine < lines.size(); iLine++) {
+	  temp_alts.push_back(stof(lines[iLine][0]) * 1000.0);
+	  temps.push_back(stof(lines[iLine][1]));
+	}
+      }
+    }
+    infile_ptr.close();
+  }
+
+  if (iErr == 0 && (density_sum <= 0.0 || temps.size() == 0)) {
+    std::cout << "Need #neutrals (with BCs) and #temperature in the"
+	      << " planet file for a stretched grid!\n";
+    iErr = 1;
+  }
+
+  if (iErr == 0) {
+
+    long nAlts = extents.nAltsG;
+    long nGCs = extents.nGCs;
+    float mean_mass = mass_sum / density_sum;
+    float radius = planet.get_radius(0.0);
+    float mu = planet.get_mu();
+
+    // Scale height at an altitude, with the temperature interpolated
+    // like the initial conditions (constant outside of the table):
+    auto scale_height = [&](float alt) {
+      float t = temps[0];
+      if (alt >= temp_alts.back()) {
+	t = temps.back();
+      } else {
+	for (unsigned long iT = 1; iT < temps.size(); iT++) {
+	  if (alt < temp_alts[iT]) {
+	    if (alt > temp_alts[iT-1]) {
+	      float r = (alt - temp_alts[iT-1]) /
+		(temp_alts[iT] - temp_alts[iT-1]);
+	      t = (1.0-r) * temps[iT-1] + r * temps[iT];
+	    } else {
+	      t = temps[iT-1];
+	    }
+	    break;
+	  }
+	}
+      }
+      float gravity = mu / ((radius + alt) * (radius + alt));
+      return boltzmanns_constant * t / (mean_mass * gravity);
+    };
+
+    altitudes[nGCs] = grid_input.alt_min;
+    for (iAlt = nGCs+1; iAlt < nAlts; iAlt++)
+      altitudes[iAlt] = altitudes[iAlt-1] +
+	grid_input.dalt * scale_height(altitudes[iAlt-1]);
+    for (iAlt = nGCs-1; iAlt >= 0; iAlt--)
+      altitudes[iAlt] = altitudes[iAlt+1] -
+	grid_input.dalt * scale_height(altitudes[iAlt+1]);
+
+  }
+
+  report.exit(function);  
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// Read the altitudes (in km, one per line, going up) from a file.
+// There has to be one for every cell in the grid (nAlts), not
+// including the ghost cells, which are filled in with the same spacing
+// as the cells next to them.
+// -----------------------------------------------------------------------------
+
+int Grid::read_altitude_file(const std::string &alt_file,
+			     std::vector<float> &altitudes,
+			     Report &report) {
+
+  int iErr = 0;
+  long iAlt;
+  float altitude;
+  std::vector<float> file_alts;
+
+  static std::string function = "Grid::read_altitude_file";
+  static int iFunction = -1;
+  report.enter(function, iFunction);  
+
+  std::ifstream infile_ptr;
+  infile_ptr.open(alt_file);
+
+  if (!infile_ptr.is_open()) {
+    std::cout << "Could not open altitude file : " << alt_file << "\n";
+    iErr = 1;
+  } else {
+    while (infile_ptr >> altitude) file_alts.push_back(altitude * 1000.0);
+    infile_ptr.close();
+  }
+
+  if (iErr == 0 && long(file_alts.size()) != extents.nAlts) {
+    std::cout << "Altitude file " << alt_file << " has "
+	      << file_alts.size() << " altitudes, but the grid has "
+	      << extents.nAlts << " (see #grid)!\n";
+    iErr = 1;
+  }
+
+  for (iAlt = 1; iErr == 0 && iAlt < extents.nAlts; iAlt++) {
+    if (file_alts[iAlt] <= file_alts[iAlt-1]) {
+      std::cout << "Altitudes in " << alt_file
+		<< " have to go up! Line : " << iAlt+1 << "\n";
+      iErr = 1;
+    }
+  }
+
+  if (iErr == 0 && extents.nAlts < 2) {
+    std::cout << "Need at least 2 altitudes in " << alt_file << "\n";
+    iErr = 1;
+  }
+
+  if (iErr == 0) {
+
+    long nGCs = extents.nGCs;
+    long nAlts = extents.nAlts;
+    float dalt_bottom = file_alts[1] - file_alts[0];
+    float dalt_top = file_alts[nAlts-1] - file_alts[nAlts-2];
+
+    for (iAlt = 0; iAlt < nAlts; iAlt++)
+      altitudes[iAlt + nGCs] = file_alts[iAlt];
+    for (iAlt = 0; iAlt < nGCs; iAlt++) {
+      altitudes[iAlt] = file_alts[0] - float(nGCs - iAlt) * dalt_bottom;
+      altitudes[nGCs + nAlts + iAlt] =
+	file_alts[nAlts-1] + float(iAlt + 1) * dalt_top;
+    }
+
+  }
+
+  report.exit(function);  
+  return iErr;
+
+}
@@ -27,16 +27,37 @@ Inputs::Inputs(Times &time, Report &report) {
 
   // ------------------------------------------------
   // Grid Defaults:
+  grid_input.nLons = 18;
+  grid_input.nLats = 36;
+  grid_input.nAlts = 50;
   grid_input.alt_file = "";
   grid_input.IsUniformAlt = 1;
   grid_input.alt_min = 100.0 * 1000.0;
   grid_input.dalt = 2.5 * 1000.0;
 
-  //grid_input.IsUniformAlt = 0;
-  //grid_input.alt_min = 100.0 * 1000.0;
-  //grid_input.dalt = 0.33;
+  // A fixed 5 s time step:
+  dt_input.dt_min = 5.0;
+  dt_input.dt_max = 5.0;
+  dt_input.cfl = 0.0;
+  dt_input.diffusion_number = 2.0;
+  dt_input.chemistry_change = 1.0;
 
-  if (nGeoLons == 1) {
+  euv_heating_eff_neutrals = 0.40;
+  euv_heating_eff_electrons = 0.05;
+
+  dt_output.push_back(300.0);
+  type_output.push_back("states");
+  dt_euv = 60.0;
+
+  // ------------------------------------------------
+  // Now read the input file:
+  iErr = read(time, report);
+  IsOk = (iErr == 0);
+
+  // The horizontal extent of the grid depends on how many cells
+  // there are, which is only known after reading the input file:
+
+  if (grid_input.nLons == 1) {
     grid_input.lon_min = 0.0;
     grid_input.lon_max = 0.0;
   } else {
@@ -44,32 +65,29 @@ Inputs::Inputs(Times &time, Report &report) {
     grid_input.lon_max = 2.0*pi;
   }
 
-  if (nGeoLats == 1) {
+  if (grid_input.nLats == 1) {
     grid_input.lat_min = 0.0;
     grid_input.lat_max = 0.0;
   } else {
     grid_input.lat_min = -pi/2;
     grid_input.lat_max = pi/2;
   }
+  
+}
 
-  euv_heating_eff_neutrals = 0.40;
-  euv_heating_eff_electrons = 0.05;
-
-  dt_output.push_back(300.0);
-  type_output.push_back("states");
-  dt_euv = 60.0;
+// -----------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------
 
-  // ------------------------------------------------
-  // Now read the input file:
-  iErr = read(time, report);
-  
+int Inputs::is_ok() const {
+  return IsOk;
 }
 
 // -----------------------------------------------------------------------
 //
 // -----------------------------------------------------------------------
 
-Inputs::grid_input_struct Inputs::get_grid_inputs() {
+Inputs::grid_input_struct Inputs::get_grid_inputs() const {
   return grid_input;
 }
 
@@ -77,7 +95,24 @@ Inputs::grid_input_struct Inputs::get_grid_inputs() {
 //
 // -----------------------------------------------------------------------
 
-std::string Inputs::get_bfield_type() {
+Inputs::dt_input_struct Inputs::get_dt_inputs() const {
+  return dt_input;
+}
+
+// -----------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------
+
+std::vector<Inputs::schedule_input_struct>
+Inputs::get_schedule_inputs() const {
+  return schedule_input;
+}
+
+// -----------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------
+
+std::string Inputs::get_bfield_type() const {
   return bfield;
 }
 
@@ -85,7 +120,55 @@ std::string Inputs::get_bfield_type() {
 //
 // -----------------------------------------------------------------------
 
-std::string Inputs::get_euv_model() {
+int Inputs::get_use_huge_pages() const {
+  return UseHugePages;
+}
+
+// -----------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------
+
+std::string Inputs::get_species_layout() const {
+  return species_layout;
+}
+
+// -----------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------
+
+int Inputs::get_nThreads() const {
+  return nThreads;
+}
+
+// -----------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------
+
+int Inputs::get_column_fusion() const {
+  return nFusedColumns;
+}
+
+// -----------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------
+
+std::string Inputs::get_thermal_conduction() const {
+  return thermal_conduction;
+}
+
+// -----------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------
+
+std::string Inputs::get_chapman() const {
+  return chapman;
+}
+
+// -----------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------
+
+std::string Inputs::get_euv_model() const {
   return euv_model;
 }
 
@@ -93,7 +176,31 @@ std::string Inputs::get_euv_model() {
 //
 // -----------------------------------------------------------------------
 
-float Inputs::get_euv_heating_eff_neutrals() {
+std::string Inputs::get_euv_spectrum_file() const {
+  return euv_spectrum_file;
+}
+
+// -----------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------
+
+int Inputs::get_euv_bins() const {
+  return euv_bins;
+}
+
+// -----------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------
+
+float Inputs::get_euv_bins_max_error() const {
+  return euv_bins_max_error;
+}
+
+// -----------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------
+
+float Inputs::get_euv_heating_eff_neutrals() const {
   return euv_heating_eff_neutrals;
 }
 
@@ -101,7 +208,7 @@ float Inputs::get_euv_heating_eff_neutrals() {
 //
 // -----------------------------------------------------------------------
 
-float Inputs::get_dt_euv() {
+float Inputs::get_dt_euv() const {
   return dt_euv;
 }
 
@@ -109,7 +216,15 @@ float Inputs::get_dt_euv() {
 //
 // -----------------------------------------------------------------------
 
-float Inputs::get_n_outputs() {
+std::string Inputs::get_euv_interpolation() const {
+  return euv_interpolation;
+}
+
+// -----------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------
+
+float Inputs::get_n_outputs() const {
   return dt_output.size();
 }
 
@@ -117,7 +232,7 @@ float Inputs::get_n_outputs() {
 //
 // -----------------------------------------------------------------------
 
-float Inputs::get_dt_output(int iOutput) {
+float Inputs::get_dt_output(int iOutput) const {
   float value = 0.0;
   if (iOutput < dt_output.size()) value = dt_output[iOutput];
   return value;
@@ -127,7 +242,7 @@ float Inputs::get_dt_output(int iOutput) {
 //
 // -----------------------------------------------------------------------
 
-std::string Inputs::get_type_output(int iOutput) {
+std::string Inputs::get_type_output(int iOutput) const {
   std::string value = "";
   if (iOutput < dt_output.size()) value = type_output[iOutput];
   return value;
@@ -137,7 +252,7 @@ std::string Inputs::get_type_output(int iOutput) {
 //
 // -----------------------------------------------------------------------
 
-std::string Inputs::get_euv_file() {
+std::string Inputs::get_euv_file() const {
   return euv_file;
 }
 
@@ -145,7 +260,7 @@ std::string Inputs::get_euv_file() {
 //
 // -----------------------------------------------------------------------
 
-std::string Inputs::get_chemistry_file() {
+std::string Inputs::get_chemistry_file() const {
   return chemistry_file;
 }
 
@@ -153,7 +268,7 @@ std::string Inputs::get_chemistry_file() {
 //
 // -----------------------------------------------------------------------
 
-std::string Inputs::get_f107_file() {
+std::string Inputs::get_f107_file() const {
   return f107_file;
 }
 
@@ -161,7 +276,7 @@ std::string Inputs::get_f107_file() {
 //
 // -----------------------------------------------------------------------
 
-std::string Inputs::get_planet() {
+std::string Inputs::get_planet() const {
   return planet;
 }
 
@@ -169,7 +284,7 @@ std::string Inputs::get_planet() {
 //
 // -----------------------------------------------------------------------
 
-std::string Inputs::get_planetary_file() {
+std::string Inputs::get_planetary_file() const {
   return planetary_file;
 }
 
@@ -177,7 +292,7 @@ std::string Inputs::get_planetary_file() {
 //
 // -----------------------------------------------------------------------
 
-std::string Inputs::get_planet_species_file() {
+std::string Inputs::get_planet_species_file() const {
   return planet_species_file;
 }
 
@@ -246,6 +361,71 @@ int Inputs::read(Times &time, Report &report) {
 	}
       }
 
+      // ---------------------------
+      // #grid
+      // ---------------------------
+
+      if (hash == "#grid") {
+	grid_input.nLons = read_int(infile_ptr, hash);
+	grid_input.nLats = read_int(infile_ptr, hash);
+	grid_input.nAlts = read_int(infile_ptr, hash);
+	if (grid_input.nLons < 1 ||
+	    grid_input.nLats < 1 ||
+	    grid_input.nAlts < 1) {
+	  std::cout << "Issue in read_inputs!\n";
+	  std::cout << "Should be:\n";
+	  std::cout << hash << "\n";
+	  std::cout << "nLons    (int)\n";
+	  std::cout << "nLats    (int)\n";
+	  std::cout << "nAlts    (int)\n";
+	  iErr = 1;
+	}
+	if (report.test_verbose(3))
+	  std::cout << "Grid size : "
+		    << grid_input.nLons << " x "
+		    << grid_input.nLats << " x "
+		    << grid_input.nAlts << "\n";
+      }
+
+      // ---------------------------
+      // #altitudes
+      // ---------------------------
+
+      if (hash == "#altitudes") {
+	std::string alt_type = make_lower(read_string(infile_ptr, hash));
+	float alt_min = read_float(infile_ptr, hash);
+	float dalt = read_float(infile_ptr, hash);
+	if ((alt_type != "uniform" && alt_type != "stretched") ||
+	    dalt <= 0.0) {
+	  std::cout << "Issue in read_inputs!\n";
+	  std::cout << "Should be:\n";
+	  std::cout << hash << "\n";
+	  std::cout << "type     (uniform or stretched)\n";
+	  std::cout << "alt_min  (km)\n";
+	  std::cout << "dalt     (km if uniform, scale heights if stretched)\n";
+	  iErr = 1;
+	} else {
+	  // The minimum altitude is always in km, but a stretched grid
+	  // gives the spacing as a fraction of a scale height:
+	  grid_input.alt_min = alt_min * 1000.0;
+	  if (alt_type == "uniform") {
+	    grid_input.IsUniformAlt = 1;
+	    grid_input.dalt = dalt * 1000.0;
+	  } else {
+	    grid_input.IsUniformAlt = 0;
+	    grid_input.dalt = dalt;
+	  }
+	}
+      }
+
+      // ---------------------------
+      // #altitude_file
+      // ---------------------------
+
+      if (hash == "#altitude_file") {
+	grid_input.alt_file = read_string(infile_ptr, hash);
+      }
+
       // ---------------------------
       // #f107file
       // ---------------------------
@@ -262,6 +442,241 @@ int Inputs::read(Times &time, Report &report) {
 	bfield = read_string(infile_ptr, hash);
       }
 
+      // ---------------------------
+      // #hugepages
+      // ---------------------------
+
+      if (hash == "#hugepages") {
+	UseHugePages = read_int(infile_ptr, hash);
+      }
+
+      // ---------------------------
+      // #species_layout
+      // ---------------------------
+
+      if (hash == "#species_layout") {
+	species_layout = read_string(infile_ptr, hash);
+	if (species_layout != "separate" &&
+	    species_layout != "species_major" &&
+	    species_layout != "interleaved") {
+	  std::cout << "Issue in read_inputs!\n";
+	  std::cout << "Should be:\n";
+	  std::cout << hash << "\n";
+	  std::cout << "layout    (separate, species_major or interleaved,"
+		    << " not " << species_layout << ")\n";
+	  species_layout = "separate";
+	  iErr = 1;
+	}
+      }
+
+      // ---------------------------
+      // #threads
+      // ---------------------------
+
+      if (hash == "#threads") {
+	nThreads = read_int(infile_ptr, hash);
+	if (nThreads < 1) {
+	  std::cout << "Issue in read_inputs!\n";
+	  std::cout << "Should be:\n";
+	  std::cout << hash << "\n";
+	  std::cout << "nThreads    (int, at least 1)\n";
+	  nThreads = 1;
+	  iErr = 1;
+	}
+      }
+
+      // ---------------------------
+      // #column_fusion
+      // ---------------------------
+
+      if (hash == "#column_fusion") {
+	nFusedColumns = read_int(infile_ptr, hash);
+	if (nFusedColumns < 0) {
+	  std::cout << "Issue in read_inputs!\n";
+	  std::cout << "Should be:\n";
+	  std::cout << hash << "\n";
+	  std::cout << "nColumns    (int, 0 for a stage at a time)\n";
+	  nFusedColumns = 0;
+	  iErr = 1;
+	}
+      }
+
+      // ---------------------------
+      // #thermal_conduction
+      // ---------------------------
+
+      if (hash == "#thermal_conduction") {
+	thermal_conduction = make_lower(read_string(infile_ptr, hash));
+	if (thermal_conduction != "pow" &&
+	    thermal_conduction != "fast" &&
+	    thermal_conduction != "table") {
+	  std::cout << "Issue in read_inputs!\n";
+	  std::cout << "Should be:\n";
+	  std::cout << hash << "\n";
+	  std::cout << "method    (pow, fast or table, not "
+		    << thermal_conduction << ")\n";
+	  thermal_conduction = "fast";
+	  iErr = 1;
+	}
+      }
+
+      // ---------------------------
+      // #chapman
+      // ---------------------------
+
+      if (hash == "#chapman") {
+	chapman = make_lower(read_string(infile_ptr, hash));
+	if (chapman != "exact" && chapman != "table") {
+	  std::cout << "Issue in read_inputs!\n";
+	  std::cout << "Should be:\n";
+	  std::cout << hash << "\n";
+	  std::cout << "method    (exact or table, not " << chapman << ")\n";
+	  chapman = "exact";
+	  iErr = 1;
+	}
+      }
+
+      // ---------------------------
+      // #dt
+      // ---------------------------
+
+      if (hash == "#dt") {
+	dt_input.dt_min = read_float(infile_ptr, hash);
+	dt_input.dt_max = read_float(infile_ptr, hash);
+	dt_input.cfl = read_float(infile_ptr, hash);
+	dt_input.diffusion_number = read_float(infile_ptr, hash);
+	dt_input.chemistry_change = read_float(infile_ptr, hash);
+	if (dt_input.dt_min <= 0.0 ||
+	    dt_input.dt_max < dt_input.dt_min ||
+	    dt_input.cfl < 0.0 ||
+	    dt_input.diffusion_number < 0.0 ||
+	    dt_input.chemistry_change < 0.0) {
+	  std::cout << "Issue in read_inputs!\n";
+	  std::cout << "Should be:\n";
+	  std::cout << hash << "\n";
+	  std::cout << "dt_min              (float, s)\n";
+	  std::cout << "dt_max              (float, s, >= dt_min)\n";
+	  std::cout << "cfl                 (float, 0 to turn off)\n";
+	  std::cout << "diffusion_number    (float, 0 to turn off)\n";
+	  std::cout << "chemistry_change    (float, 0 to turn off)\n";
+	  dt_input.dt_min = 5.0;
+	  dt_input.dt_max = 5.0;
+	  dt_input.cfl = 0.0;
+	  dt_input.diffusion_number = 2.0;
+	  dt_input.chemistry_change = 1.0;
+	  iErr = 1;
+	}
+      }
+
+      // ---------------------------
+      // #schedule
+      // ---------------------------
+
+      if (hash == "#schedule") {
+	std::vector<std::vector<std::string>> csv = read_csv(infile_ptr);
+	// comma separated values, with process, cadence, then the most
+	// sub-steps it can take:
+	for (std::vector<std::string> &row : csv) {
+	  schedule_input_struct schedule;
+	  schedule.process = "";
+	  if (row.size() == 3) {
+	    // A cadence or max_subcycles that isn't a number leaves the
+	    // process out, so the row is reported below:
+	    try {
+	      schedule.cadence = stof(row[1]);
+	      schedule.max_subcycles = stoi(row[2]);
+	      schedule.process = make_lower(row[0]);
+	    }
+	    catch(...) {
+	      schedule.process = "";
+	    }
+	  }
+	  if ((schedule.process != "sza" &&
+	       schedule.process != "conduction" &&
+	       schedule.process != "sources" &&
+	       schedule.process != "chemistry") ||
+	      schedule.cadence < 0.0 ||
+	      schedule.max_subcycles < 1 ||
+	      (schedule.max_subcycles > 1 &&
+	       schedule.process != "chemistry")) {
+	    std::cout << "Issue in read_inputs!\n";
+	    std::cout << "Should be (one line for each process):\n";
+	    std::cout << hash << "\n";
+	    std::cout << "process, cadence, max_subcycles\n";
+	    std::cout << "  process       : sza, conduction, sources or chemistry\n";
+	    std::cout << "  cadence       : (float, s, 0 for every step)\n";
+	    std::cout << "  max_subcycles : (int, >1 only for chemistry)\n";
+	    iErr = 1;
+	  } else {
+	    schedule_input.push_back(schedule);
+	  }
+	}
+      }
+
+      // ---------------------------
+      // #euv
+      // ---------------------------
+
+      if (hash == "#euv") {
+	dt_euv = read_float(infile_ptr, hash);
+	euv_interpolation = make_lower(read_string(infile_ptr, hash));
+	if (dt_euv <= 0.0 ||
+	    (euv_interpolation != "hold" &&
+	     euv_interpolation != "interpolate")) {
+	  std::cout << "Issue in read_inputs!\n";
+	  std::cout << "Should be:\n";
+	  std::cout << hash << "\n";
+	  std::cout << "dt_euv           (float, s)\n";
+	  std::cout << "interpolation    (hold or interpolate)\n";
+	  if (dt_euv <= 0.0) dt_euv = 60.0;
+	  if (euv_interpolation != "interpolate") euv_interpolation = "hold";
+	  iErr = 1;
+	}
+      }
+
+      // ---------------------------
+      // #euv_model
+      // ---------------------------
+
+      if (hash == "#euv_model") {
+	euv_model = make_lower(read_string(infile_ptr, hash));
+	if (euv_model != "euvac" &&
+	    euv_model != "fixed" &&
+	    euv_model != "file") {
+	  std::cout << "#euv_model must be euvac, fixed or file, not : "
+		    << euv_model << "\n";
+	  euv_model = "euvac";
+	  iErr = 1;
+	}
+      }
+
+      // ---------------------------
+      // #euv_spectrum_file
+      // ---------------------------
+
+      if (hash == "#euv_spectrum_file") {
+	euv_spectrum_file = read_string(infile_ptr, hash);
+      }
+
+      // ---------------------------
+      // #euv_bins
+      // ---------------------------
+
+      if (hash == "#euv_bins") {
+	euv_bins = read_int(infile_ptr, hash);
+	euv_bins_max_error = read_float(infile_ptr, hash);
+	if (euv_bins < 0 || euv_bins_max_error <= 0.0) {
+	  std::cout << "Issue in read_inputs!\n";
+	  std::cout << "Should be:\n";
+	  std::cout << hash << "\n";
+	  std::cout << "nBins        (int, 0 for all of the wavelengths)\n";
+	  std::cout << "max_error    (float, e.g., 0.05)\n";
+	  euv_bins = 0;
+	  euv_bins_max_error = 0.05;
+	  iErr = 1;
+	}
+      }
+
       // ---------------------------
       // #chemistry
       // ---------------------------
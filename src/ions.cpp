@@ -10,6 +10,7 @@
 #include "../include/sizes.h"
 #include "../include/ions.h"
 #include "../include/grid.h"
+#include "../include/arena.h"
 #include "../include/report.h"
 #include "../include/earth.h"
 
@@ -18,36 +19,40 @@
 //  
 // -----------------------------------------------------------------------------
 
-Ions::species_chars Ions::create_species() {
+Ions::species_chars Ions::create_species(Arena &arena, float *density_s3gc) {
 
-  long iDir, iLon, iLat, iAlt, index;
+  long iDir, iLon, iLat, iAlt;
   species_chars tmp;
 
-  long iTotal = long(nGeoLonsG) * long(nGeoLatsG) * long(nGeoAltsG);
+  long iTotal = extents.nPointsG;
 
   // Constants:
   tmp.DoAdvect = 0;
   
-  tmp.density_s3gc = (float*) malloc( iTotal * sizeof(float) );
-  tmp.par_velocity_v3gc = (float*) malloc( long(3)*iTotal * sizeof(float) );
-  tmp.perp_velocity_v3gc = (float*) malloc( long(3)*iTotal * sizeof(float) );
-  tmp.temperature_s3gc = (float*) malloc( iTotal * sizeof(float) );
-  tmp.ionization_s3gc = (float*) malloc( iTotal * sizeof(float) );
-
-  for (iLon = 0; iLon < nGeoLonsG; iLon++) {
-    for (iLat = 0; iLat < nGeoLatsG; iLat++) {
-      for (iAlt = 0; iAlt < nGeoAltsG; iAlt++) {
+  tmp.density_s3gc = density_s3gc;
+  tmp.stride = species_stride;
+  tmp.par_velocity_v3gc = arena.allocate(iTotal, 3);
+  tmp.perp_velocity_v3gc = arena.allocate(iTotal, 3);
+  tmp.temperature_s3gc = arena.allocate(iTotal);
+  tmp.ionization_s3gc = arena.allocate(iTotal);
+
+  Field3D<float> density(tmp.density_s3gc, extents, tmp.stride);
+  Field3D<float> temperature(tmp.temperature_s3gc, extents);
+  Field3D<float> ionization(tmp.ionization_s3gc, extents);
+  Field3D<float, 3> par_velocity(tmp.par_velocity_v3gc, extents);
+  Field3D<float, 3> perp_velocity(tmp.perp_velocity_v3gc, extents);
+
+  for (iLon = 0; iLon < extents.nLonsG; iLon++) {
+    for (iLat = 0; iLat < extents.nLatsG; iLat++) {
+      for (iAlt = 0; iAlt < extents.nAltsG; iAlt++) {
 	
-	index = ijk_geo_s3gc(iLon,iLat,iAlt);
-
-	tmp.density_s3gc[index] = 1.0;
-	tmp.temperature_s3gc[index] = 1.0e-32;
-	tmp.ionization_s3gc[index] = 1.0e-32;
+	density(iLon, iLat, iAlt) = 1.0;
+	temperature(iLon, iLat, iAlt) = 1.0e-32;
+	ionization(iLon, iLat, iAlt) = 1.0e-32;
 
 	for (iDir = 0; iDir < 3; iDir++) {
-	  index = ijkl_geo_v3gc(iLon,iLat,iAlt,iDir);
-	  tmp.par_velocity_v3gc[index] = 0.0;
-	  tmp.perp_velocity_v3gc[index] = 0.0;
+	  par_velocity(iLon, iLat, iAlt, iDir) = 0.0;
+	  perp_velocity(iLon, iLat, iAlt, iDir) = 0.0;
 	}
 	
       }
@@ -62,29 +67,37 @@ Ions::species_chars Ions::create_species() {
 //  
 // -----------------------------------------------------------------------------
 
-Ions::Ions(Inputs input, Report report) {
+Ions::Ions(const Grid &grid,
+	   Arena &arena,
+	   const Inputs &input,
+	   Report &report) {
 
-  long iTotal = long(nGeoLonsG) * long(nGeoLatsG) * long(nGeoAltsG);
+  extents = grid.extents;
+  long iTotal = extents.nPointsG;
   species_chars tmp;
   int iErr;
 
   report.print(2,"Initializing Ions");
-  
+
+  // One density tensor for the ions and the electrons (the last one):
+  std::vector<float*> densities;
+  species_stride = arena.allocate_species(iTotal, nIons + 1, densities);
+
   for (int iSpecies=0; iSpecies < nIons; iSpecies++) {
-    tmp = create_species();
+    tmp = create_species(arena, densities[iSpecies]);
     species.push_back(tmp);
   }
 
   // Create one extra species for electrons
-  tmp = create_species();
+  tmp = create_species(arena, densities[nIons]);
   species.push_back(tmp);
 
   // State variables:
-  density_s3gc = (float*) malloc( iTotal * sizeof(float) );
-  velocity_v3gc = (float*) malloc( long(3)*iTotal * sizeof(float) );
-  exb_v3gc = (float*) malloc( long(3)*iTotal * sizeof(float) );
-  ion_temperature_s3gc = (float*) malloc( iTotal * sizeof(float) );
-  electron_temperature_s3gc = (float*) malloc( iTotal * sizeof(float) );
+  density_s3gc = arena.allocate(iTotal);
+  velocity_v3gc = arena.allocate(iTotal, 3);
+  exb_v3gc = arena.allocate(iTotal, 3);
+  ion_temperature_s3gc = arena.allocate(iTotal);
+  electron_temperature_s3gc = arena.allocate(iTotal);
 
   // This gets a bunch of the species-dependent characteristics:
   iErr = read_planet_file(input, report);
@@ -95,7 +108,7 @@ Ions::Ions(Inputs input, Report report) {
 // Read in the planet file that describes the species - only ions
 // -----------------------------------------------------------------------------
 
-int Ions::read_planet_file(Inputs input, Report report) {
+int Ions::read_planet_file(const Inputs &input, Report &report) {
 
   int iErr = 0;
   std::string hash;
@@ -174,49 +187,68 @@ int Ions::read_planet_file(Inputs input, Report report) {
 //  
 // -----------------------------------------------------------------------------
 
-void Ions::fill_electrons(Grid grid,
+void Ions::fill_electrons(const Grid &grid,
 			  Report &report) {
 
-  long nLons, nLats, nAlts, iLon, iLat, iAlt, index;
-  int iSpecies;
-  float electron_density;
-  
-  std::string function = "Ions::fill_electrons";
+  static std::string function = "Ions::fill_electrons";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
-  if (grid.get_IsGeoGrid()) {
-    nLons = nGeoLonsG;
-    nLats = nGeoLatsG;
-    nAlts = nGeoAltsG;
-  } else {
-    nLons = nMagLonsG;
-    nLats = nMagLatsG;
-    nAlts = nMagAltsG;
-  }
+  // Every cell (including ghost cells) gets filled, so we can just
+  // sweep through all of the points:
+  fill_electrons_points(0, grid.extents.nPointsG);
 
-  for (iLon = 0; iLon < nLons; iLon++) {
-    for (iLat = 0; iLat < nLats; iLat++) {
-      for (iAlt = 0; iAlt < nAlts; iAlt++) {
+  report.exit(function);
+  return;
+}
 
-	if (grid.get_IsGeoGrid()) {
-	  index = ijk_geo_s3gc(iLon,iLat,iAlt);
-	} else {
-	  index = ijk_mag_s3gc(iLon,iLat,iAlt);
-	}
+// The columns of a tile (see #column_fusion).  The lats at each lon
+// are next to each other, so each lon is one sweep:
 
-	electron_density = 0.0;
+void Ions::fill_electrons_columns(const tile_struct &tile) {
+  Field3D<float> electrons(density_s3gc, extents);
+  if (tile.iLatEnd <= tile.iLatStart) return;
+  for (long iLon = tile.iLonStart; iLon < tile.iLonEnd; iLon++)
+    fill_electrons_points(electrons.index(iLon, tile.iLatStart, 0),
+			  electrons.index(iLon, tile.iLatEnd - 1, 0) +
+			  extents.nAltsG);
+}
 
-	for (iSpecies=0; iSpecies < nIons; iSpecies++)
-	  electron_density = electron_density  + species[iSpecies].density_s3gc[index];
+// The electron density at the points from iStart to iEnd (not
+// including iEnd) is the sum of the ion densities:
 
-	species[nIons].density_s3gc[index] = electron_density;
-	density_s3gc[index] = electron_density;
+void Ions::fill_electrons_points(long iStart, long iEnd) {
 
-      }
+  long iPoint;
+  int iSpecies;
+  float electron_density, *ion_density;
+
+  if (species_stride == 1) {
+
+    // Each ion species is contiguous, so add them in one at a time:
+    for (iPoint = iStart; iPoint < iEnd; iPoint++)
+      density_s3gc[iPoint] = 0.0;
+
+    for (iSpecies=0; iSpecies < nIons; iSpecies++) {
+      ion_density = species[iSpecies].density_s3gc;
+      for (iPoint = iStart; iPoint < iEnd; iPoint++)
+	density_s3gc[iPoint] = density_s3gc[iPoint] + ion_density[iPoint];
     }
+
+  } else {
+
+    // Interleaved, so all of the ions at a point are next to each other:
+    for (iPoint = iStart; iPoint < iEnd; iPoint++) {
+      ion_density = species[0].density_s3gc + iPoint * species_stride;
+      electron_density = 0.0;
+      for (iSpecies=0; iSpecies < nIons; iSpecies++)
+	electron_density = electron_density + ion_density[iSpecies];
+      density_s3gc[iPoint] = electron_density;
+    }
+
   }
 
-  report.exit(function);
-  return;
+  for (iPoint = iStart; iPoint < iEnd; iPoint++)
+    species[nIons].density(iPoint) = density_s3gc[iPoint];
+
 }
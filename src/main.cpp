@@ -7,6 +7,9 @@
 #include "../include/times.h"
 #include "../include/inputs.h"
 #include "../include/report.h"
+#include "../include/arena.h"
+#include "../include/workers.h"
+#include "../include/parallel.h"
 
 
 #include "../include/neutrals.h"
@@ -18,6 +21,7 @@
 #include "../include/chemistry.h"
 #include "../include/output.h"
 #include "../include/advance.h"
+#include "../include/scheduler.h"
 
 int main() {
 
@@ -25,28 +29,112 @@ int main() {
 
   Times time;
   Report report;
+
+  // This has to be first, since it starts MPI (if we are using it):
+  Parallel parallel(report);
+
   Inputs input(time, report);
+  if (!input.is_ok()) {
+    std::cout << "There were issues with the inputs, so the model can't run!\n";
+    return 1;
+  }
   Euv euv(input, report);
+  if (!euv.is_ok()) {
+    std::cout << "The EUV couldn't be set up, so the model can't run!\n";
+    return 1;
+  }
   Planets planet(input, report);
   Indices indices(input);
 
+  // All of the 3D fields live in here, so this has to be created
+  // before (and go away after) the grids, neutrals and ions:
+  Arena arena(input, report);
+
   // Geo grid stuff:
-  Grid gGrid(nGeoLonsG, nGeoLatsG, nGeoAltsG);
-  gGrid.init_geo_grid(planet, input, report);
+  Inputs::grid_input_struct grid_input = input.get_grid_inputs();
+
+  // Each process has a block of the geo grid (all of it without MPI):
+  grid_extents geo_extents = parallel.decompose(grid_input,
+						nGeoGhosts,
+						report,
+						iErr);
+  if (iErr > 0) return iErr;
+
+  // The worker threads each own a tile of the block, so they touch
+  // the new fields first (so the memory is close to them):
+  Workers workers(input.get_nThreads(), geo_extents, report);
+  arena.set_first_touch([&workers](float *field,
+				   long nPoints,
+				   long nValuesPerPoint) {
+    workers.first_touch(field, nPoints, nValuesPerPoint);
+  });
+
+  Grid gGrid(geo_extents, arena);
+  gGrid.init_geo_grid(planet, input, arena, report);
   gGrid.fill_grid(planet, report);
 
   // Magnetic grid stuff:
-  Grid mGrid(nMagLonsG, nMagLatsG, nMagAltsG);
+  Grid mGrid(nMagLons, nMagLats, nMagAlts, nMagGhosts, arena);
   
-  Neutrals neutrals(gGrid, input, report);
-  Ions ions(input, report);
+  Neutrals neutrals(gGrid, arena, input, report);
+  Ions ions(gGrid, arena, input, report);
   neutrals.pair_euv(euv, ions, report);  
 
+  // Fewer EUV bins (#euv_bins), for the atmosphere and the spectrum
+  // that the model starts with:
+  if (input.get_euv_bins() > 0) {
+    euv.calc_spectrum(time, indices, report);
+    neutrals.merge_euv_bins(euv,
+			    gGrid,
+			    input.get_euv_bins(),
+			    input.get_euv_bins_max_error(),
+			    report);
+    // The first step makes the spectrum again, so that its functions
+    // (e.g., Euv::euvac) are timed in the first step, like without
+    // #euv_bins, and not first in a later step (which allocates):
+    euv.reset_spectrum();
+  }
+
   Chemistry chemistry(neutrals, ions, input, report);
+
+  // These are the fields that the neighbors need in their halos:
+  parallel.add_halo_field(Parallel::temperature_halo, neutrals.temperature_s3gc);
+  parallel.add_halo_field(Parallel::temperature_halo, ions.ion_temperature_s3gc);
+  parallel.add_halo_field(Parallel::temperature_halo,
+			  ions.electron_temperature_s3gc);
+  for (int iSpecies = 0; iSpecies < nSpecies; iSpecies++)
+    parallel.add_halo_field(Parallel::density_halo,
+			    neutrals.neutrals[iSpecies].density_s3gc,
+			    neutrals.species_stride);
+  for (int iSpecies = 0; iSpecies < nIons; iSpecies++)
+    parallel.add_halo_field(Parallel::density_halo,
+			    ions.species[iSpecies].density_s3gc,
+			    ions.species_stride);
+  parallel.add_halo_field(Parallel::density_halo, ions.density_s3gc);
+
+  double nMBytes = parallel.sum(arena.get_nBytes()) / (1024 * 1024);
+  if (report.test_verbose(2))
+    std::cout << "Arena holds " << arena.get_nFields() << " fields ("
+	      << long(nMBytes) << " MB)\n";
   
+  // The time step (see Times::calc_dt) stays in the #dt bounds, and
+  // lands on each of the outputs:
+  Inputs::dt_input_struct dt_input = input.get_dt_inputs();
+  time.set_dt_bounds(dt_input.dt_min, dt_input.dt_max);
+  for (int iOutput = 0; iOutput < input.get_n_outputs(); iOutput++)
+    time.add_time_gate(input.get_dt_output(iOutput));
+
+  // How often each process runs (#schedule, and #euv for the EUV):
+  Scheduler scheduler;
+  scheduler.set_process(Scheduler::euv_process, input.get_dt_euv(), 1);
+  for (Inputs::schedule_input_struct schedule : input.get_schedule_inputs())
+    scheduler.set_process(scheduler.find_process(schedule.process),
+			  schedule.cadence,
+			  schedule.max_subcycles);
+
   // This is for the initial output.  If it is not a restart, this will go:
   if (time.check_time_gate(input.get_dt_output(0))) {
-    iErr = output(neutrals, ions, gGrid, time, planet, input, report);
+    iErr = output(neutrals, ions, gGrid, time, planet, input, parallel, report);
   }
 
   // This is advancing now...
@@ -64,23 +152,30 @@ int main() {
 
     time.increment_intermediate(dt_couple);
 
-    while (time.get_current() < time.get_intermediate())
-      iErr = advance(planet,
-		     gGrid,
-		     time,
-		     euv,
-		     neutrals,
-		     ions,
-		     chemistry,
-		     indices,
-		     input,
-		     report);
+    // Keep an error from any of the steps, so the run exits with it:
+    while (time.get_current() < time.get_intermediate()) {
+      int iErrStep = advance(planet,
+			     gGrid,
+			     time,
+			     euv,
+			     neutrals,
+			     ions,
+			     chemistry,
+			     indices,
+			     input,
+			     workers,
+			     parallel,
+			     scheduler,
+			     report);
+      if (iErrStep > 0) iErr = iErrStep;
+    }
 
     // Do some coupling here. But we have no coupling to do. Sad.
     
   }
 
-  report.times();
+  scheduler.add_notes(report);
+  parallel.times(report);
     
   return iErr;
 
@@ -0,0 +1,331 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "../include/neutrals.h"
+#include "../include/euv.h"
+#include "../include/grid.h"
+#include "../include/report.h"
+
+// -----------------------------------------------------------------------------
+// Merge the wavelengths of a column (see euv_merge_struct) into nBins
+// bins, with the sun overhead and at two slants:
+//
+//   A merged bin gets all of the intensity of its wavelengths.  Its
+//   cross sections are the intensity weighted ones, weighted again by
+//   how much of each wavelength gets down to where the bin is
+//   absorbed (tau = 1), so the bins that are absorbed higher up
+//   don't pull the bin down.  Its rates are the intensity weighted
+//   rates, so they are right at the top.
+//
+//   Starting from all of the bins, the two neighboring bins (next to
+//   each other in the euv file) that make the smallest error are
+//   merged, over and over, until there are nBins, or the next merge
+//   would go over max_error.  The error is the biggest difference
+//   between the heating (or any one of the ionizations) with the
+//   merged bins and with all of them, over the column, over the
+//   biggest heating (or ionization) in the column.
+// -----------------------------------------------------------------------------
+
+void merge_euv_waves(euv_merge_struct &merge, int nBins, float max_error) {
+
+  long nWaves = merge.nWaves;
+  long nAbsorbers = merge.nAbsorbers;
+  long nRates = merge.nRates;
+  long nZ = merge.nZ;
+  const std::vector<double> &intensity = merge.intensity;
+  const std::vector<double> &sigma = merge.sigma;
+  const std::vector<double> &rates = merge.rates;
+  const std::vector<double> &column = merge.column;
+  const std::vector<double> &density_rate = merge.density_rate;
+  long iW, iA, iR, iZ, iM, iBin, iBin2;
+
+  // The sun overhead, at 60 and at 78 degrees (flat planet):
+  std::vector<double> mus = {1.0, 0.5, 0.2};
+  long nMus = mus.size();
+
+  // A bin (merged or not), and what gets through to each altitude at
+  // each slant ([iMu][iZ]):
+  struct bin_struct {
+    std::vector<long> waves;
+    double intensity;
+    std::vector<double> sigma, rates, through;
+  };
+
+  auto make_bin = [&](const std::vector<long> &waves) {
+
+    bin_struct bin;
+    bin.waves = waves;
+    bin.intensity = 0.0;
+    bin.sigma.assign(nAbsorbers, 0.0);
+    bin.rates.assign(nRates, 0.0);
+
+    for (long iWave : waves) {
+      bin.intensity += intensity[iWave];
+      for (iA = 0; iA < nAbsorbers; iA++)
+	bin.sigma[iA] += intensity[iWave] * sigma[iWave * nAbsorbers + iA];
+      for (iR = 0; iR < nRates; iR++)
+	bin.rates[iR] += intensity[iWave] * rates[iWave * nRates + iR];
+    }
+    for (iR = 0; iR < nRates; iR++) bin.rates[iR] /= bin.intensity;
+
+    if (waves.size() == 1) {
+      for (iA = 0; iA < nAbsorbers; iA++)
+	bin.sigma[iA] = sigma[waves[0] * nAbsorbers + iA];
+    } else {
+      // Where the intensity weighted bin gets to tau = 1 (overhead):
+      for (iA = 0; iA < nAbsorbers; iA++) bin.sigma[iA] /= bin.intensity;
+      long iZ1 = 0;
+      for (iZ = nZ - 1; iZ >= 0; iZ--) {
+	double tau = 0.0;
+	for (iA = 0; iA < nAbsorbers; iA++)
+	  tau += bin.sigma[iA] * column[iA * nZ + iZ];
+	if (tau > 1.0) {
+	  iZ1 = iZ;
+	  break;
+	}
+      }
+      // and weight again by what gets there:
+      double total = 0.0;
+      bin.sigma.assign(nAbsorbers, 0.0);
+      for (long iWave : waves) {
+	double tau = 0.0;
+	for (iA = 0; iA < nAbsorbers; iA++)
+	  tau += sigma[iWave * nAbsorbers + iA] * column[iA * nZ + iZ1];
+	double weight = intensity[iWave] * exp(-tau);
+	total += weight;
+	for (iA = 0; iA < nAbsorbers; iA++)
+	  bin.sigma[iA] += weight * sigma[iWave * nAbsorbers + iA];
+      }
+      for (iA = 0; iA < nAbsorbers; iA++)
+	bin.sigma[iA] = (total > 0.0) ? bin.sigma[iA] / total : 0.0;
+    }
+
+    bin.through.resize(nMus * nZ);
+    for (iM = 0; iM < nMus; iM++)
+      for (iZ = 0; iZ < nZ; iZ++) {
+	double tau = 0.0;
+	for (iA = 0; iA < nAbsorbers; iA++)
+	  tau += bin.sigma[iA] * column[iA * nZ + iZ];
+	bin.through[iM * nZ + iZ] = bin.intensity * exp(-tau / mus[iM]);
+      }
+
+    return bin;
+
+  };
+
+  // The sum over the bins of intensity * rate, for each [iMu][iRate][iZ]:
+  auto add_bin = [&](std::vector<double> &sum, const bin_struct &bin,
+		     double sign) {
+    for (iM = 0; iM < nMus; iM++)
+      for (iR = 0; iR < nRates; iR++)
+	for (iZ = 0; iZ < nZ; iZ++)
+	  sum[(iM * nRates + iR) * nZ + iZ] +=
+	    sign * bin.rates[iR] * bin.through[iM * nZ + iZ];
+  };
+
+  std::vector<bin_struct> bins;
+  std::vector<double> full(nMus * nRates * nZ, 0.0);
+  for (iW = 0; iW < nWaves; iW++) {
+    bins.push_back(make_bin({iW}));
+    add_bin(full, bins.back(), 1.0);
+  }
+  std::vector<double> merged = full, trial(full.size());
+
+  // The worst heating and ionization errors of a set of bins:
+  auto errors = [&](const std::vector<double> &sum,
+		    double &heating_error, double &ionization_error) {
+    heating_error = 0.0;
+    ionization_error = 0.0;
+    for (iM = 0; iM < nMus; iM++) {
+      double diff, peak = 0.0, worst = 0.0;
+      for (iZ = 0; iZ < nZ; iZ++) {
+	double heat = 0.0, heat_full = 0.0;
+	for (iR = 0; iR < nAbsorbers; iR++) {
+	  long i = (iM * nRates + iR) * nZ + iZ;
+	  heat += density_rate[iR * nZ + iZ] * sum[i];
+	  heat_full += density_rate[iR * nZ + iZ] * full[i];
+	}
+	peak = std::max(peak, fabs(heat_full));
+	worst = std::max(worst, fabs(heat - heat_full));
+      }
+      if (peak > 0.0) heating_error = std::max(heating_error, worst / peak);
+      for (iR = nAbsorbers; iR < nRates; iR++) {
+	peak = 0.0;
+	worst = 0.0;
+	for (iZ = 0; iZ < nZ; iZ++) {
+	  long i = (iM * nRates + iR) * nZ + iZ;
+	  diff = density_rate[iR * nZ + iZ] * (sum[i] - full[i]);
+	  peak = std::max(peak, fabs(density_rate[iR * nZ + iZ] * full[i]));
+	  worst = std::max(worst, fabs(diff));
+	}
+	if (peak > 0.0)
+	  ionization_error = std::max(ionization_error, worst / peak);
+      }
+    }
+  };
+
+  merge.heating_error = 0.0;
+  merge.ionization_error = 0.0;
+
+  while (long(bins.size()) > nBins) {
+
+    double best = 1.0e32, heating, ionization;
+    long iBest = -1, iBest2 = -1;
+    bin_struct best_bin;
+
+    for (iBin = 0; iBin < long(bins.size()) - 1; iBin++) {
+      iBin2 = iBin + 1;
+      std::vector<long> waves = bins[iBin].waves;
+      waves.insert(waves.end(),
+		   bins[iBin2].waves.begin(), bins[iBin2].waves.end());
+      bin_struct bin = make_bin(waves);
+      trial = merged;
+      add_bin(trial, bins[iBin], -1.0);
+      add_bin(trial, bins[iBin2], -1.0);
+      add_bin(trial, bin, 1.0);
+      errors(trial, heating, ionization);
+      if (std::max(heating, ionization) < best) {
+	best = std::max(heating, ionization);
+	iBest = iBin;
+	iBest2 = iBin2;
+	best_bin = bin;
+      }
+    }
+
+    if (best > max_error) break;
+
+    add_bin(merged, bins[iBest], -1.0);
+    add_bin(merged, bins[iBest2], -1.0);
+    add_bin(merged, best_bin, 1.0);
+    bins.erase(bins.begin() + iBest2);
+    bins[iBest] = best_bin;
+    errors(merged, merge.heating_error, merge.ionization_error);
+
+  }
+
+  long nMerged = bins.size();
+  merge.bins.resize(nMerged);
+  merge.bin_sigma.resize(nMerged * nAbsorbers);
+  merge.bin_rates.resize(nMerged * nRates);
+  for (iBin = 0; iBin < nMerged; iBin++) {
+    merge.bins[iBin] = bins[iBin].waves;
+    for (iA = 0; iA < nAbsorbers; iA++)
+      merge.bin_sigma[iBin * nAbsorbers + iA] = bins[iBin].sigma[iA];
+    for (iR = 0; iR < nRates; iR++)
+      merge.bin_rates[iBin * nRates + iR] = bins[iBin].rates[iR];
+  }
+
+}
+
+// -----------------------------------------------------------------------------
+// Merge the EUV wavelength bins (after pair_euv) into nBins bins, so
+// that calc_ionization_heating (which goes as the number of bins) is
+// faster.  The merging (see merge_euv_waves) is done for the
+// atmosphere that the model starts with, in the first column of the
+// block (which is the same in every column, so all of the processes
+// get the same bins).
+//
+// The spectrum is the one at the start (so calc_spectrum has to have
+// been done).  When it changes, only the total intensity of each bin
+// changes (see calc_ionization_heating), not the cross sections.
+// -----------------------------------------------------------------------------
+
+int Neutrals::merge_euv_bins(const Euv &euv,
+			     const Grid &grid,
+			     int nBins,
+			     float max_error,
+			     Report &report) {
+
+  int iErr = 0;
+
+  long nWaves = nEuvWaves;
+  long nAbsorbers = absorbers.size();
+  long nRates = nEuvRates;
+  long iW, iA, iR, iZ, iBin;
+
+  if (nBins <= 0 || nBins >= nWaves) return iErr;
+
+  // The physical part of the first column:
+  long nZ = extents.iAltEnd_ - extents.iAltStart_ + 1;
+  Field3D<float> heating_euv(heating_euv_s3gc, extents);
+  long index = heating_euv.index(extents.iLonStart_, extents.iLatStart_,
+				 extents.iAltStart_);
+  const float *alt = grid.geoAlt_s3gc + index;
+
+  euv_merge_struct merge;
+  merge.nWaves = nWaves;
+  merge.nAbsorbers = nAbsorbers;
+  merge.nRates = nRates;
+  merge.nZ = nZ;
+
+  // The densities of the absorbers, and of the neutral in each rate
+  // (the heating rates go with the absorbers):
+  std::vector<double> density_abs(nAbsorbers * nZ);
+  merge.density_rate.resize(nRates * nZ);
+  for (iA = 0; iA < nAbsorbers; iA++)
+    for (iZ = 0; iZ < nZ; iZ++)
+      density_abs[iA * nZ + iZ] = neutrals[absorbers[iA]].density(index + iZ);
+  for (iR = 0; iR < nRates; iR++) {
+    int iSpecies = (iR < nAbsorbers) ?
+      absorbers[iR] : ionization_neutral[iR - nAbsorbers];
+    for (iZ = 0; iZ < nZ; iZ++)
+      merge.density_rate[iR * nZ + iZ] = neutrals[iSpecies].density(index + iZ);
+  }
+
+  // The vertical columns of the absorbers.  Above the top, the density
+  // falls off with the scale height of the top two altitudes:
+  merge.column.resize(nAbsorbers * nZ);
+  for (iA = 0; iA < nAbsorbers; iA++) {
+    double *n = density_abs.data() + iA * nZ;
+    double *N = merge.column.data() + iA * nZ;
+    double dz = alt[nZ - 1] - alt[nZ - 2];
+    double H = dz;
+    if (n[nZ - 2] > n[nZ - 1] && n[nZ - 1] > 0.0)
+      H = dz / log(n[nZ - 2] / n[nZ - 1]);
+    N[nZ - 1] = n[nZ - 1] * H;
+    for (iZ = nZ - 2; iZ >= 0; iZ--)
+      N[iZ] = N[iZ + 1] + 0.5 * (n[iZ] + n[iZ + 1]) * (alt[iZ + 1] - alt[iZ]);
+  }
+
+  // All of the bins, unmerged:
+  merge.intensity.resize(nWaves);
+  merge.sigma.resize(nWaves * nAbsorbers);
+  merge.rates.resize(nWaves * nRates);
+  for (iW = 0; iW < nWaves; iW++) {
+    merge.intensity[iW] = euv.wavelengths_intensity_1au[iW];
+    for (iA = 0; iA < nAbsorbers; iA++)
+      merge.sigma[iW * nAbsorbers + iA] = euv_absorption[iW * nAbsorbers + iA];
+    for (iR = 0; iR < nRates; iR++)
+      merge.rates[iW * nRates + iR] =
+	euv_rates[iW * nRates + iR] * euv_rate_units[iR];
+  }
+
+  merge_euv_waves(merge, nBins, max_error);
+
+  // Put the merged bins in place of the wavelengths:
+  nEuvWaves = merge.bins.size();
+  euv_bin_of_wave.assign(nWaves, 0);
+  euv_bin_intensity.assign(nEuvWaves, 0.0);
+  euv_absorption.resize(nEuvWaves * nAbsorbers);
+  for (iBin = 0; iBin < nEuvWaves; iBin++) {
+    for (long iWave : merge.bins[iBin]) euv_bin_of_wave[iWave] = iBin;
+    for (iA = 0; iA < nAbsorbers; iA++)
+      euv_absorption[iBin * nAbsorbers + iA] =
+	merge.bin_sigma[iBin * nAbsorbers + iA];
+  }
+  set_euv_rates(merge.bin_rates);
+
+  if (report.test_verbose(0))
+    std::cout << "EUV : " << nWaves << " wavelengths merged into "
+	      << nEuvWaves << " bins, max heating error : "
+	      << merge.heating_error << ", max ionization error : "
+	      << merge.ionization_error << "\n";
+
+  return iErr;
+
+}
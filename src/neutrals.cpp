@@ -4,6 +4,7 @@
 #include <math.h>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
 #include "../include/constants.h"
 #include "../include/inputs.h"
@@ -11,6 +12,7 @@
 #include "../include/neutrals.h"
 #include "../include/ions.h"
 #include "../include/grid.h"
+#include "../include/arena.h"
 #include "../include/report.h"
 #include "../include/earth.h"
 
@@ -18,12 +20,14 @@
 //  
 // -----------------------------------------------------------------------------
 
-Neutrals::species_chars Neutrals::create_species() {
+Neutrals::species_chars Neutrals::create_species(Arena &arena,
+						 float *density_s3gc,
+						 float *chapman_s3gc) {
 
-  long iDir, iLon, iLat, iAlt, index;
+  long iDir, iLon, iLat, iAlt;
   species_chars tmp;
 
-  long iTotal = long(nGeoLonsG) * long(nGeoLatsG) * long(nGeoAltsG);
+  long iTotal = extents.nPointsG;
 
   // Constants:
   tmp.DoAdvect = 0;
@@ -31,26 +35,28 @@ Neutrals::species_chars Neutrals::create_species() {
   tmp.thermal_exp = 0.0;
   tmp.lower_bc_density = -1.0;
   
-  tmp.density_s3gc = (float*) malloc( iTotal * sizeof(float) );
-  tmp.velocity_v3gc = (float*) malloc( long(3)*iTotal * sizeof(float) );
-  tmp.chapman_s3gc = (float*) malloc( iTotal * sizeof(float) );
-  tmp.ionization_s3gc = (float*) malloc( iTotal * sizeof(float) );
-
-  for (iLon = 0; iLon < nGeoLonsG; iLon++) {
-    for (iLat = 0; iLat < nGeoLatsG; iLat++) {
-      for (iAlt = 0; iAlt < nGeoAltsG; iAlt++) {
+  tmp.density_s3gc = density_s3gc;
+  tmp.chapman_s3gc = chapman_s3gc;
+  tmp.stride = species_stride;
+  tmp.velocity_v3gc = arena.allocate(iTotal, 3);
+  tmp.ionization_s3gc = arena.allocate(iTotal);
+
+  Field3D<float> density(tmp.density_s3gc, extents, tmp.stride);
+  Field3D<float> chapman(tmp.chapman_s3gc, extents, tmp.stride);
+  Field3D<float> ionization(tmp.ionization_s3gc, extents);
+  Field3D<float, 3> velocity(tmp.velocity_v3gc, extents);
+
+  for (iLon = 0; iLon < extents.nLonsG; iLon++) {
+    for (iLat = 0; iLat < extents.nLatsG; iLat++) {
+      for (iAlt = 0; iAlt < extents.nAltsG; iAlt++) {
 	
-	index = ijk_geo_s3gc(iLon,iLat,iAlt);
+	density(iLon, iLat, iAlt) = 1.0e-32;
+	chapman(iLon, iLat, iAlt) = 1.0e-32;
+	ionization(iLon, iLat, iAlt) = 1.0e-32;
 
-	tmp.density_s3gc[index] = 1.0e-32;
-	tmp.chapman_s3gc[index] = 1.0e-32;
-	tmp.ionization_s3gc[index] = 1.0e-32;
+	for (iDir = 0; iDir < 3; iDir++)
+	  velocity(iLon, iLat, iAlt, iDir) = 0.0;
 
-	for (iDir = 0; iDir < 3; iDir++) {
-	  index = ijkl_geo_v3gc(iLon,iLat,iAlt,iDir);
-	  tmp.velocity_v3gc[index] = 0.0;
-	}
-	
       }
     }
   }
@@ -63,46 +69,71 @@ Neutrals::species_chars Neutrals::create_species() {
 //  
 // -----------------------------------------------------------------------------
 
-Neutrals::Neutrals(Grid grid, Inputs input, Report report) {
+Neutrals::Neutrals(const Grid &grid,
+		   Arena &arena,
+		   const Inputs &input,
+		   Report &report) {
 
   int iErr;
   species_chars tmp;
-  long iTotal = long(nGeoLonsG) * long(nGeoLatsG) * long(nGeoAltsG);
+
+  extents = grid.extents;
+  long iTotal = extents.nPointsG;
 
   report.print(2, "Initializing Neutrals");
 
+  // The species densities and chapman integrals each go into one
+  // tensor, unless the layout is separate:
+  std::vector<float*> densities, chapmans;
+  species_stride = arena.allocate_species(iTotal, nSpecies, densities);
+  arena.allocate_species(iTotal, nSpecies, chapmans);
+
   for (int iSpecies=0; iSpecies < nSpecies; iSpecies++) {
-    tmp = create_species();
+    tmp = create_species(arena, densities[iSpecies], chapmans[iSpecies]);
     neutrals.push_back(tmp);
   }
 
   // State variables:
-  density_s3gc = (float*) malloc( iTotal * sizeof(float) );
-  velocity_v3gc = (float*) malloc( long(3)*iTotal * sizeof(float) );
-  temperature_s3gc = (float*) malloc( iTotal * sizeof(float) );
+  density_s3gc = arena.allocate(iTotal);
+  velocity_v3gc = arena.allocate(iTotal, 3);
+  temperature_s3gc = arena.allocate(iTotal);
 
   // Derived quantities:
-  rho_s3gc = (float*) malloc( iTotal * sizeof(float) );
-  mean_major_mass_s3gc = (float*) malloc( iTotal * sizeof(float) );
-  pressure_s3gc = (float*) malloc( iTotal * sizeof(float) );
-  sound_s3gc = (float*) malloc( iTotal * sizeof(float) );
+  rho_s3gc = arena.allocate(iTotal);
+  mean_major_mass_s3gc = arena.allocate(iTotal);
+  pressure_s3gc = arena.allocate(iTotal);
+  sound_s3gc = arena.allocate(iTotal);
 
   // Heating and cooling parameters:
-  Cv_s3gc = (float*) malloc( iTotal * sizeof(float) );
-  gamma_s3gc = (float*) malloc( iTotal * sizeof(float) );
-  kappa_s3gc = (float*) malloc( iTotal * sizeof(float) );
+  Cv_s3gc = arena.allocate(iTotal);
+  gamma_s3gc = arena.allocate(iTotal);
+  kappa_s3gc = arena.allocate(iTotal);
+  rho_cv_s3gc = arena.allocate(iTotal);
 
   // Source Terms:
-  heating_euv_s3gc = (float*) malloc( iTotal * sizeof(float) );
-  conduction_s3gc = (float*) malloc( iTotal * sizeof(float) );
+  heating_euv_s3gc = arena.allocate(iTotal);
+  conduction_s3gc = arena.allocate(iTotal);
 
   heating_efficiency = input.get_euv_heating_eff_neutrals();
-  
-  initial_temperatures = NULL;
-  initial_altitudes = NULL;
+
+  // Everything is lit until calc_chapman says otherwise:
+  euv_first_lit.assign(extents.nColumnsG, 0);
+  euv_column_costs.assign(extents.nColumnsG, 1.0);
+  euv_column_bottom.assign(extents.nColumnsG, extents.nAltsG);
+
+  euv_interpolation = input.get_euv_interpolation();
   
   // This gets a bunch of the species-dependent characteristics:
   iErr = read_planet_file(input, report);
+  group_thermal_exps(input, report);
+
+  chapman_method = input.get_chapman();
+  if (chapman_method == "table") {
+    chapman_table.build();
+    if (report.test_verbose(0))
+      std::cout << "Neutrals : chapman table, max relative error : "
+		<< chapman_table.max_relative_error() << "\n";
+  }
 
   // This specifies the initial conditions for the neutrals:
   iErr = initial_conditions(grid, input, report);
@@ -113,7 +144,7 @@ Neutrals::Neutrals(Grid grid, Inputs input, Report report) {
 // Read in the planet file that describes the species - only neutrals
 // -----------------------------------------------------------------------------
 
-int Neutrals::read_planet_file(Inputs input, Report report) {
+int Neutrals::read_planet_file(const Inputs &input, Report &report) {
 
   int iErr = 0;
   std::string hash;
@@ -182,8 +213,8 @@ int Neutrals::read_planet_file(Inputs input, Report report) {
 	std::vector<std::vector<std::string>> temps = read_csv(infile_ptr);
 
 	int nTemps = temps.size()-1;
-	initial_temperatures = (float*) malloc(nTemps * sizeof(float) );
-	initial_altitudes = (float*) malloc(nTemps * sizeof(float) );
+	initial_temperatures.resize(nTemps);
+	initial_altitudes.resize(nTemps);
 	for (int iTemp=0; iTemp < nTemps; iTemp++) {
 	  report.print(5, "reading initial temp alt " + temps[iTemp+1][0]);
 	  // convert altitudes from km to m
@@ -206,14 +237,59 @@ int Neutrals::read_planet_file(Inputs input, Report report) {
 }
 
 // -----------------------------------------------------------------------------
-//  
+// Put the species with the same thermal_exp together (see neutrals.h),
+// and make the T^thermal_exp tables if they are needed
+// -----------------------------------------------------------------------------
+
+void Neutrals::group_thermal_exps(const Inputs &input, Report &report) {
+
+  thermal_conduction_method = input.get_thermal_conduction();
+  thermal_exp_groups.clear();
+
+  for (int iSpecies=0; iSpecies < nSpecies; iSpecies++) {
+
+    unsigned long iGroup = 0;
+    while (iGroup < thermal_exp_groups.size() &&
+	   thermal_exp_groups[iGroup].thermal_exp !=
+	   neutrals[iSpecies].thermal_exp)
+      iGroup++;
+
+    if (iGroup == thermal_exp_groups.size()) {
+      thermal_exp_group group;
+      group.thermal_exp = neutrals[iSpecies].thermal_exp;
+      thermal_exp_groups.push_back(group);
+    }
+    thermal_exp_groups[iGroup].species.push_back(iSpecies);
+    neutrals[iSpecies].iThermalExpGroup = iGroup;
+
+  }
+
+  if (thermal_conduction_method == "table") {
+    for (thermal_exp_group &group : thermal_exp_groups) {
+      group.table.resize(nTable_temperatures);
+      for (long iT = 0; iT < nTable_temperatures; iT++)
+	group.table[iT] = pow(table_temperature_min + iT * table_dtemperature,
+			      double(group.thermal_exp));
+    }
+  }
+
+  if (report.test_verbose(2))
+    std::cout << "Neutrals : " << thermal_exp_groups.size()
+	      << " group(s) of thermal_exp, T^thermal_exp with "
+	      << thermal_conduction_method << "\n";
+
+}
+
+// -----------------------------------------------------------------------------
+//  Scale height of a species at a grid point (index).  The gravity
+//  comes from the grid's column profile (see Grid::gravity_s1gc).
 // -----------------------------------------------------------------------------
 
 float Neutrals::calc_scale_height(int iSpecies,
 				  long index,
-				  Grid grid) {
+				  float gravity) {
 
-  float g = grid.gravity_s3gc[index];
+  float g = gravity;
   float t = temperature_s3gc[index];
   float m = neutrals[iSpecies].mass;
   float H = boltzmanns_constant * t / m / g;
@@ -226,11 +302,13 @@ float Neutrals::calc_scale_height(int iSpecies,
 //  
 // -----------------------------------------------------------------------------
 
-int Neutrals::initial_conditions(Grid grid, Inputs input, Report report) {
+int Neutrals::initial_conditions(const Grid &grid,
+				 const Inputs &input,
+				 Report &report) {
 
   int iErr = 0;
   long iDir, iLon, iLat, iAlt, index, iA, indexm;
-  float alt, r, H;
+  float alt, r, H, *gravity, *dalt_lower;
 
   report.print(3, "Creating Neutrals initial_condition");
   
@@ -241,11 +319,17 @@ int Neutrals::initial_conditions(Grid grid, Inputs input, Report report) {
 
   if (nInitial_temps > 0) {
 
-    for (iLon = 0; iLon < nGeoLonsG; iLon++) {
-      for (iLat = 0; iLat < nGeoLatsG; iLat++) {
-	for (iAlt = 0; iAlt < nGeoAltsG; iAlt++) {
+    Field3D<float> temperature(temperature_s3gc, extents);
+
+    for (iLon = 0; iLon < extents.nLonsG; iLon++) {
+      for (iLat = 0; iLat < extents.nLatsG; iLat++) {
+
+	gravity = grid.profile(grid.gravity_s1gc).column(iLon, iLat);
+	dalt_lower = grid.profile(grid.dalt_lower_s1gc).column(iLon, iLat);
+
+	for (iAlt = 0; iAlt < extents.nAltsG; iAlt++) {
 	
-	  index = ijk_geo_s3gc(iLon,iLat,iAlt);
+	  index = temperature.index(iLon, iLat, iAlt);
 
 	  alt = grid.geoAlt_s3gc[index];
 
@@ -277,7 +361,7 @@ int Neutrals::initial_conditions(Grid grid, Inputs input, Report report) {
 
 	  if (iAlt == 0) {
 	    for (int iSpecies=0; iSpecies < nSpecies; iSpecies++)
-	      neutrals[iSpecies].density_s3gc[index] =
+	      neutrals[iSpecies].density(index) =
 		neutrals[iSpecies].lower_bc_density;
 	  } else {
 
@@ -285,14 +369,14 @@ int Neutrals::initial_conditions(Grid grid, Inputs input, Report report) {
 	    // Calculate scale height and then use hydrostatic balance
 	    // to derive the density:
 
-	    indexm = ijk_geo_s3gc(iLon,iLat,iAlt-1);
+	    indexm = temperature.index(iLon, iLat, iAlt-1);
 
 	    for (int iSpecies=0; iSpecies < nSpecies; iSpecies++) {
-	      H = calc_scale_height(iSpecies, index, grid);
+	      H = calc_scale_height(iSpecies, index, gravity[iAlt]);
 	      
-	      neutrals[iSpecies].density_s3gc[index] = 
-		neutrals[iSpecies].density_s3gc[indexm] *
-		exp(-grid.dalt_lower_s3gc[index]/H);
+	      neutrals[iSpecies].density(index) =
+		neutrals[iSpecies].density(indexm) *
+		exp(-dalt_lower[iAlt]/H);
 
 	    }
 	    
@@ -316,7 +400,7 @@ int Neutrals::initial_conditions(Grid grid, Inputs input, Report report) {
 // out which ion it is producing (the "to" column).
 // ---------------------------------------------------------------------
 
-int Neutrals::pair_euv(Euv euv, Ions ions, Report report) {
+int Neutrals::pair_euv(const Euv &euv, const Ions &ions, Report &report) {
 
   int iErr = 0;
 
@@ -364,10 +448,97 @@ int Neutrals::pair_euv(Euv euv, Ions ions, Report report) {
       }
       
     }
-    
+
   }
-  
+
+  // Only these need chapman integrals (see calc_chapman):
+  absorbers.clear();
+  for (int iSpecies=0; iSpecies < nSpecies; iSpecies++)
+    if (neutrals[iSpecies].iEuvAbsId_ > -1) absorbers.push_back(iSpecies);
+
+  // Pack the cross sections into [iWave][i] matrices, so
+  // calc_ionization_heating doesn't have to go through waveinfo:
+  long nAbsorbers = absorbers.size();
+  std::vector<int> iCrossSections;
+  ionization_neutral.clear();
+  ionization_ion.clear();
+  for (int iSpecies=0; iSpecies < nSpecies; iSpecies++) {
+    for (int iIonization=0;
+	 iIonization < neutrals[iSpecies].nEuvIonSpecies;
+	 iIonization++) {
+      ionization_neutral.push_back(iSpecies);
+      ionization_ion.push_back(neutrals[iSpecies].iEuvIonSpecies_[iIonization]);
+      iCrossSections.push_back(neutrals[iSpecies].iEuvIonId_[iIonization]);
+    }
+  }
+
+  nEuvWaves = euv.nWavelengths;
+  nEuvRates = nAbsorbers + ionization_neutral.size();
+  euv_absorption.resize(nEuvWaves * nAbsorbers);
+  std::vector<double> rates(nEuvWaves * nEuvRates);
+
+  for (long iWave = 0; iWave < nEuvWaves; iWave++) {
+    for (long iA = 0; iA < nAbsorbers; iA++) {
+      float cross_section =
+	euv.waveinfo[neutrals[absorbers[iA]].iEuvAbsId_].values[iWave];
+      euv_absorption[iWave * nAbsorbers + iA] = cross_section;
+      rates[iWave * nEuvRates + iA] =
+	double(euv.wavelengths_energy[iWave]) * cross_section;
+    }
+    for (unsigned long iI = 0; iI < iCrossSections.size(); iI++)
+      rates[iWave * nEuvRates + nAbsorbers + iI] =
+	euv.waveinfo[iCrossSections[iI]].values[iWave];
+  }
+
+  set_euv_rates(rates);
+
+  // The fields that have EUV sources in them, for the interpolation:
+  euv_source_fields.clear();
+  euv_source_fields.push_back(heating_euv_s3gc);
+  for (int iSpecies : ionization_neutral)
+    if (std::find(euv_source_fields.begin(), euv_source_fields.end(),
+		  neutrals[iSpecies].ionization_s3gc) == euv_source_fields.end())
+      euv_source_fields.push_back(neutrals[iSpecies].ionization_s3gc);
+  for (int iIon : ionization_ion)
+    if (std::find(euv_source_fields.begin(), euv_source_fields.end(),
+		  ions.species[iIon].ionization_s3gc) == euv_source_fields.end())
+      euv_source_fields.push_back(ions.species[iIon].ionization_s3gc);
+
+  if (euv_interpolation == "interpolate") {
+    for (euv_sources_struct *sources : {&euv_sources_then, &euv_sources_next}) {
+      sources->fields.assign(euv_source_fields.size() * extents.nPointsG, 0.0);
+      sources->bottom.assign(extents.nColumnsG, extents.nAltsG);
+    }
+  }
+
+  if (report.test_verbose(2))
+    std::cout << "Neutrals : " << nEuvWaves << " wavelengths, "
+	      << nAbsorbers << " absorbers, "
+	      << ionization_neutral.size() << " ionizations\n";
+
   return iErr;
   
 }
 
+
+// ---------------------------------------------------------------------
+// Put the rates ([iWave][iRate], nEuvWaves x nEuvRates) into euv_rates,
+// each in units of its biggest value.
+// ---------------------------------------------------------------------
+
+void Neutrals::set_euv_rates(const std::vector<double> &rates) {
+
+  euv_rate_units.assign(nEuvRates, 0.0);
+  for (long iRate = 0; iRate < nEuvRates; iRate++) {
+    for (long iWave = 0; iWave < nEuvWaves; iWave++)
+      if (fabs(rates[iWave * nEuvRates + iRate]) > euv_rate_units[iRate])
+	euv_rate_units[iRate] = fabs(rates[iWave * nEuvRates + iRate]);
+    if (euv_rate_units[iRate] == 0.0) euv_rate_units[iRate] = 1.0;
+  }
+  euv_rates.resize(nEuvWaves * nEuvRates);
+  for (long iWave = 0; iWave < nEuvWaves; iWave++)
+    for (long iRate = 0; iRate < nEuvRates; iRate++)
+      euv_rates[iWave * nEuvRates + iRate] =
+	rates[iWave * nEuvRates + iRate] / euv_rate_units[iRate];
+
+}
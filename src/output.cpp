@@ -1,6 +1,7 @@
 // (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
 // Full license can be found in License.md
 
+#include <memory>
 #include <netcdf>
 
 #include "../include/neutrals.h"
@@ -11,27 +12,34 @@
 #include "../include/earth.h"
 #include "../include/report.h"
 #include "../include/transform.h"
+#include "../include/parallel.h"
 
 using namespace netCDF;
 using namespace netCDF::exceptions;
 
-int output(Neutrals neutrals,
-	   Ions ions,
-	   Grid grid,
-	   Times time,
-	   Planets planet,
-	   Inputs args,
+int output(const Neutrals &neutrals,
+	   const Ions &ions,
+	   const Grid &grid,
+	   const Times &time,
+	   const Planets &planet,
+	   const Inputs &args,
+	   Parallel &parallel,
 	   Report &report) {
 
   int iErr = 0;
 
   int nOutputs = args.get_n_outputs();
-  int IsGeoGrid = grid.get_IsGeoGrid();
 
-  std::string function="output";
+  static std::string function="output";
   static int iFunction = -1;
   report.enter(function, iFunction);  
 
+  // With MPI, each field is put together on the root, which writes
+  // the whole grid (see Parallel::gather_s3gc):
+  grid_extents file_extents = grid.extents;
+  if (parallel.get_nRanks() > 1) file_extents = parallel.get_global_extents();
+  std::vector<float> global_s3gc;
+
   for (int iOutput = 0; iOutput < nOutputs; iOutput++) {
 
     if (time.check_time_gate(args.get_dt_output(iOutput))) {
@@ -51,13 +59,10 @@ int output(Neutrals neutrals,
       time_string = time.get_YMD_HMS();
       file_name = file_pre + "_" + time_string + file_ext;
   
-      // Create the file:
-      NcFile ncdf_file(file_name, NcFile::replace);
-
-      // Add dimensions:
-      NcDim lonDim = ncdf_file.addDim("Longitude", nGeoLonsG); 
-      NcDim latDim = ncdf_file.addDim("Latitude", nGeoLatsG); 
-      NcDim altDim = ncdf_file.addDim("Altitude", nGeoAltsG); 
+      // Create the file (only the root has one):
+      std::unique_ptr<NcFile> ncdf_file;
+      if (parallel.is_root())
+	ncdf_file.reset(new NcFile(file_name, NcFile::replace));
 
       // If we wanted 1D variables, we would do something like this, but
       // since all of out variables will be 3d, skip this:
@@ -67,31 +72,46 @@ int output(Neutrals neutrals,
       // Define the netCDF variables for the 3D data.
       // First create a vector of dimensions:
       std::vector<NcDim> dimVector;
-      dimVector.push_back(lonDim);
-      dimVector.push_back(latDim);
-      dimVector.push_back(altDim);
-
-      NcVar lonVar = ncdf_file.addVar("Longitude", ncFloat, dimVector);
-      NcVar latVar = ncdf_file.addVar("Latitude", ncFloat, dimVector);
-      NcVar altVar = ncdf_file.addVar("Altitude", ncFloat, dimVector);
-
-      lonVar.putAtt(UNITS,"radians");
-      latVar.putAtt(UNITS,"radians");
-      altVar.putAtt(UNITS,"meters");
+      if (ncdf_file) {
+	dimVector.push_back(ncdf_file->addDim("Longitude", file_extents.nLonsG));
+	dimVector.push_back(ncdf_file->addDim("Latitude", file_extents.nLatsG));
+	dimVector.push_back(ncdf_file->addDim("Altitude", file_extents.nAltsG));
+      }
 
       std::vector<size_t> startp,countp;
       startp.push_back(0);
       startp.push_back(0);
       startp.push_back(0);
 
-      countp.push_back(nGeoLonsG);
-      countp.push_back(nGeoLatsG);
-      countp.push_back(nGeoAltsG);
+      countp.push_back(file_extents.nLonsG);
+      countp.push_back(file_extents.nLatsG);
+      countp.push_back(file_extents.nAltsG);
+
+      // Every process has to get here with each field, in the same
+      // order, but only the root writes it:
+      auto put_s3gc = [&](std::string name, std::string unit, float *field_s3gc) {
+	float *field = parallel.gather_s3gc(field_s3gc, grid.extents, global_s3gc);
+	if (ncdf_file) {
+	  NcVar var = ncdf_file->addVar(name, ncFloat, dimVector);
+	  var.putAtt(UNITS, unit);
+	  var.putVar(startp, countp, field);
+	}
+      };
+
+      // The species densities may be interleaved (see arena.h), so
+      // they get copied into this before they are written:
+      long nPoints = grid.extents.nPointsG;
+      std::vector<float> species_density(nPoints);
+
+      // Longitude and latitude are 2D in the grid, but the file is all 3D:
+      std::vector<float> expanded_s3gc(nPoints);
 
       // Output longitude, latitude, altitude 3D arrays:
-      lonVar.putVar(startp, countp, grid.geoLon_s3gc);
-      latVar.putVar(startp, countp, grid.geoLat_s3gc);
-      altVar.putVar(startp, countp, grid.geoAlt_s3gc);
+      expand_s2gc_to_s3gc(grid.geoLon_s2gc, grid.extents, expanded_s3gc.data());
+      put_s3gc("Longitude", "radians", expanded_s3gc.data());
+      expand_s2gc_to_s3gc(grid.geoLat_s2gc, grid.extents, expanded_s3gc.data());
+      put_s3gc("Latitude", "radians", expanded_s3gc.data());
+      put_s3gc("Altitude", "meters", grid.geoAlt_s3gc);
 
       // ----------------------------------------------
       // Neutral Densities and Temperature
@@ -101,20 +121,21 @@ int output(Neutrals neutrals,
 	  type_output == "states") {
 
 	// Output all species densities:
-	std::vector<NcVar> denVar;
 	for (int iSpecies=0; iSpecies < nSpecies; iSpecies++) {
 	  if (report.test_verbose(3))
 	    std::cout << "Outputting Var : "
 		      << neutrals.neutrals[iSpecies].cName << "\n";
-	  denVar.push_back(ncdf_file.addVar(neutrals.neutrals[iSpecies].cName, ncFloat, dimVector));
-	  denVar[iSpecies].putAtt(UNITS,neutrals.density_unit);
-	  denVar[iSpecies].putVar(startp, countp, neutrals.neutrals[iSpecies].density_s3gc);
+	  for (long index = 0; index < nPoints; index++)
+	    species_density[index] = neutrals.neutrals[iSpecies].density(index);
+	  put_s3gc(neutrals.neutrals[iSpecies].cName,
+		   neutrals.density_unit,
+		   species_density.data());
 	}
   
 	// Output bulk temperature:
-	NcVar tempVar = ncdf_file.addVar(neutrals.temperature_name, ncFloat, dimVector);
-	tempVar.putAtt(UNITS,neutrals.temperature_unit);
-	tempVar.putVar(startp, countp, neutrals.temperature_s3gc);
+	put_s3gc(neutrals.temperature_name,
+		 neutrals.temperature_unit,
+		 neutrals.temperature_s3gc);
 
       }
 
@@ -126,24 +147,23 @@ int output(Neutrals neutrals,
 	  type_output == "states") {
 
 	// Output all species densities:
-	std::vector<NcVar> ionVar;
 	for (int iSpecies=0; iSpecies < nIons; iSpecies++) {
 	  if (report.test_verbose(3))
 	    std::cout << "Outputting Var : "
 		      << ions.species[iSpecies].cName << "\n";
-	  ionVar.push_back(ncdf_file.addVar(ions.species[iSpecies].cName, ncFloat, dimVector));
-	  ionVar[iSpecies].putAtt(UNITS,neutrals.density_unit);
-	  ionVar[iSpecies].putVar(startp, countp, ions.species[iSpecies].density_s3gc);
+	  for (long index = 0; index < nPoints; index++)
+	    species_density[index] = ions.species[iSpecies].density(index);
+	  put_s3gc(ions.species[iSpecies].cName,
+		   neutrals.density_unit,
+		   species_density.data());
 	}
   
-	ionVar.push_back(ncdf_file.addVar("e-", ncFloat, dimVector));
-	ionVar[nIons].putAtt(UNITS,neutrals.density_unit);
-	ionVar[nIons].putVar(startp, countp, ions.density_s3gc);
+	put_s3gc("e-", neutrals.density_unit, ions.density_s3gc);
 
 	// // Output bulk temperature:
-	// NcVar tempVar = ncdf_file.addVar(neutrals.temperature_name, ncFloat, dimVector);
-	// tempVar.putAtt(UNITS,neutrals.temperature_unit);
-	// tempVar.putVar(startp, countp, neutrals.temperature_s3gc);
+	// put_s3gc(neutrals.temperature_name,
+	// 	 neutrals.temperature_unit,
+	// 	 neutrals.temperature_s3gc);
 
       }
 
@@ -152,36 +172,28 @@ int output(Neutrals neutrals,
       // ----------------------------------------------
 
       if (type_output == "bfield") {
-	NcVar mLatVar = ncdf_file.addVar("Magnetic Latitude", ncFloat, dimVector);
-	mLatVar.putAtt(UNITS,"radians");
-	mLatVar.putVar(startp, countp, grid.magLat_s3gc);
-	NcVar mLonVar = ncdf_file.addVar("Magnetic Longitude", ncFloat, dimVector);
-	mLonVar.putAtt(UNITS,"radians");
-	mLonVar.putVar(startp, countp, grid.magLon_s3gc);
+	put_s3gc("Magnetic Latitude", "radians", grid.magLat_s3gc);
+	put_s3gc("Magnetic Longitude", "radians", grid.magLon_s3gc);
 
 	// Output magnetic field components:
 	float *bfield_component_s3gc;
 	long nPointsTotal = grid.get_nPointsInGrid();
 	bfield_component_s3gc = (float*) malloc( nPointsTotal * sizeof(float) );
 	
-	NcVar bxVar = ncdf_file.addVar("Bx", ncFloat, dimVector);
-	bxVar.putAtt(UNITS,"nT");
-	get_vector_component(grid.bfield_v3gc, 0, IsGeoGrid, bfield_component_s3gc);
-	bxVar.putVar(startp, countp, bfield_component_s3gc);
+	get_vector_component(grid.bfield_v3gc, 0, grid.extents, bfield_component_s3gc);
+	put_s3gc("Bx", "nT", bfield_component_s3gc);
 	
-	NcVar byVar = ncdf_file.addVar("By", ncFloat, dimVector);
-	byVar.putAtt(UNITS,"nT");
-	get_vector_component(grid.bfield_v3gc, 1, IsGeoGrid, bfield_component_s3gc);
-	byVar.putVar(startp, countp, bfield_component_s3gc);
+	get_vector_component(grid.bfield_v3gc, 1, grid.extents, bfield_component_s3gc);
+	put_s3gc("By", "nT", bfield_component_s3gc);
 	
-	NcVar bzVar = ncdf_file.addVar("Bz", ncFloat, dimVector);
-	bzVar.putAtt(UNITS,"nT");
-	get_vector_component(grid.bfield_v3gc, 2, IsGeoGrid, bfield_component_s3gc);
-	bzVar.putVar(startp, countp, bfield_component_s3gc);
+	get_vector_component(grid.bfield_v3gc, 2, grid.extents, bfield_component_s3gc);
+	put_s3gc("Bz", "nT", bfield_component_s3gc);
+
+	free(bfield_component_s3gc);
 	
       }
       
-      ncdf_file.close();
+      if (ncdf_file) ncdf_file->close();
 
     }
   }
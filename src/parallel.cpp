@@ -0,0 +1,511 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#include <iostream>
+
+#include "../include/sizes.h"
+#include "../include/field3d.h"
+#include "../include/parallel.h"
+
+// -----------------------------------------------------------------------------
+// Start up MPI (if we have it).  Only the root process talks.
+// -----------------------------------------------------------------------------
+
+Parallel::Parallel(Report &report) {
+
+  iRank = 0;
+  nRanks = 1;
+
+#ifdef AETHER_USE_MPI
+  int IsInitialized;
+  MPI_Initialized(&IsInitialized);
+  if (!IsInitialized) MPI_Init(NULL, NULL);
+  MPI_Comm_rank(MPI_COMM_WORLD, &iRank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nRanks);
+#endif
+
+  report.set_iRank(iRank);
+
+  nRanksLon = 1;
+  nRanksLat = 1;
+  iRankLon = 0;
+  iRankLat = 0;
+  for (int iDirection = 0; iDirection < nDirections; iDirection++)
+    neighbors[iDirection] = -1;
+  for (int iGroup = 0; iGroup < nHaloGroups; iGroup++)
+    halo_groups[iGroup].IsExchanging = 0;
+
+}
+
+// -----------------------------------------------------------------------------
+// Wait for anything that is still being sent, then shut down MPI
+// -----------------------------------------------------------------------------
+
+Parallel::~Parallel() {
+
+#ifdef AETHER_USE_MPI
+  for (int iGroup = 0; iGroup < nHaloGroups; iGroup++)
+    if (halo_groups[iGroup].IsExchanging)
+      MPI_Waitall(halo_groups[iGroup].requests.size(),
+		  halo_groups[iGroup].requests.data(),
+		  MPI_STATUSES_IGNORE);
+  int IsFinalized;
+  MPI_Finalized(&IsFinalized);
+  if (!IsFinalized) MPI_Finalize();
+#endif
+
+}
+
+// -----------------------------------------------------------------------------
+// Cut the whole grid into nRanksLon x nRanksLat blocks (as square as
+// they can be, see factor_tiles).  The halo of a block is filled from
+// its neighbors, so each block has to be at least nGCs cells across.
+// -----------------------------------------------------------------------------
+
+grid_extents Parallel::decompose(Inputs::grid_input_struct grid_input,
+				 long nGCs,
+				 Report &report,
+				 int &iErr) {
+
+  global_extents = grid_extents(grid_input.nLons,
+				grid_input.nLats,
+				grid_input.nAlts,
+				nGCs);
+
+  if (nRanks == 1) {
+    block_extents = global_extents;
+    return block_extents;
+  }
+
+  if (!factor_tiles(nRanks, grid_input.nLons, grid_input.nLats, nGCs,
+		    nRanksLon, nRanksLat)) {
+    std::cout << "Parallel::decompose : can't split a "
+	      << grid_input.nLons << " x " << grid_input.nLats
+	      << " grid into " << nRanks << " blocks that are at least "
+	      << nGCs << " cells across!!!\n";
+    iErr = 1;
+    block_extents = global_extents;
+    return block_extents;
+  }
+
+  iRankLon = iRank / nRanksLat;
+  iRankLat = iRank % nRanksLat;
+  block_extents = block_of_rank(iRankLon, iRankLat);
+
+  if (iRankLon > 0)
+    neighbors[iWest_] = (iRankLon - 1) * nRanksLat + iRankLat;
+  if (iRankLon < nRanksLon - 1)
+    neighbors[iEast_] = (iRankLon + 1) * nRanksLat + iRankLat;
+  if (iRankLat > 0)
+    neighbors[iSouth_] = iRankLon * nRanksLat + iRankLat - 1;
+  if (iRankLat < nRanksLat - 1)
+    neighbors[iNorth_] = iRankLon * nRanksLat + iRankLat + 1;
+
+  if (report.test_verbose(2))
+    std::cout << "Parallel : " << nRanks << " processes, "
+	      << nRanksLon << " x " << nRanksLat << " blocks\n";
+
+  return block_extents;
+
+}
+
+// -----------------------------------------------------------------------------
+// The extents of the block at (iRankLon_in, iRankLat_in).  The extra
+// cells are spread out, like the tiles in Workers.
+// -----------------------------------------------------------------------------
+
+grid_extents Parallel::block_of_rank(long iRankLon_in, long iRankLat_in) {
+
+  long nLons = global_extents.nLons;
+  long nLats = global_extents.nLats;
+
+  long iLonStart = (nLons * iRankLon_in) / nRanksLon;
+  long iLonEnd = (nLons * (iRankLon_in + 1)) / nRanksLon;
+  long iLatStart = (nLats * iRankLat_in) / nRanksLat;
+  long iLatEnd = (nLats * (iRankLat_in + 1)) / nRanksLat;
+
+  grid_extents block(iLonEnd - iLonStart,
+		     iLatEnd - iLatStart,
+		     global_extents.nAlts,
+		     global_extents.nGCs);
+  block.nLonsGlobal = nLons;
+  block.nLatsGlobal = nLats;
+  block.iLonOffset = iLonStart;
+  block.iLatOffset = iLatStart;
+
+  return block;
+
+}
+
+// -----------------------------------------------------------------------------
+// The columns that a block owns (the end is one past the last one).
+// These are the physical cells, plus the ghost cells along the edges of
+// the whole grid, since nobody else has those.  Only gather_s3gc needs
+// this, and only with MPI.
+// -----------------------------------------------------------------------------
+
+#ifdef AETHER_USE_MPI
+static void owned_columns(const grid_extents &block,
+			  long &iLonStart, long &iLonEnd,
+			  long &iLatStart, long &iLatEnd) {
+
+  iLonStart = block.iLonStart_;
+  iLonEnd = block.iLonEnd_ + 1;
+  iLatStart = block.iLatStart_;
+  iLatEnd = block.iLatEnd_ + 1;
+
+  if (block.iLonOffset == 0) iLonStart = 0;
+  if (block.iLonOffset + block.nLons == block.nLonsGlobal)
+    iLonEnd = block.nLonsG;
+  if (block.iLatOffset == 0) iLatStart = 0;
+  if (block.iLatOffset + block.nLats == block.nLatsGlobal)
+    iLatEnd = block.nLatsG;
+
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// The columns that are sent to the neighbor in iDirection (the edge of
+// this block), or that are filled by that neighbor (IsHalo = 1).  The
+// edges are only the physical cells, so the corners of the halo are
+// not exchanged.
+// -----------------------------------------------------------------------------
+
+void Parallel::slab(int iDirection, int IsHalo,
+		    long &iLonStart, long &iLonEnd,
+		    long &iLatStart, long &iLatEnd) {
+
+  const grid_extents &block = block_extents;
+  long nGCs = block.nGCs;
+
+  iLonStart = block.iLonStart_;
+  iLonEnd = block.iLonEnd_ + 1;
+  iLatStart = block.iLatStart_;
+  iLatEnd = block.iLatEnd_ + 1;
+
+  if (iDirection == iWest_) {
+    if (IsHalo) iLonStart = 0;
+    iLonEnd = iLonStart + nGCs;
+  }
+  if (iDirection == iEast_) {
+    if (IsHalo) iLonEnd = block.nLonsG;
+    iLonStart = iLonEnd - nGCs;
+  }
+  if (iDirection == iSouth_) {
+    if (IsHalo) iLatStart = 0;
+    iLatEnd = iLatStart + nGCs;
+  }
+  if (iDirection == iNorth_) {
+    if (IsHalo) iLatEnd = block.nLatsG;
+    iLatStart = iLatEnd - nGCs;
+  }
+
+}
+
+// -----------------------------------------------------------------------------
+// Copy the edge of all of the fields in a group into the send buffer,
+// or the receive buffer into the halo (IsHalo = 1)
+// -----------------------------------------------------------------------------
+
+void Parallel::copy_slab(halo_group_struct &group,
+			 int iDirection,
+			 int IsHalo) {
+
+  long iLonStart, iLonEnd, iLatStart, iLatEnd, iLon, iLat, iAlt, n = 0;
+  slab(iDirection, IsHalo, iLonStart, iLonEnd, iLatStart, iLatEnd);
+
+  long nAltsG = block_extents.nAltsG;
+  long nValues = (iLonEnd - iLonStart) * (iLatEnd - iLatStart) * nAltsG *
+    group.fields.size();
+
+  std::vector<float> &buffer = IsHalo ?
+    group.receive_buffers[iDirection] : group.send_buffers[iDirection];
+  buffer.resize(nValues);
+
+  Field2D<float> columns(NULL, block_extents);
+
+  for (unsigned long iField = 0; iField < group.fields.size(); iField++) {
+    float *field = group.fields[iField].field;
+    long stride = group.fields[iField].stride;
+    for (iLon = iLonStart; iLon < iLonEnd; iLon++) {
+      for (iLat = iLatStart; iLat < iLatEnd; iLat++) {
+	long index = columns.index(iLon, iLat) * nAltsG;
+	for (iAlt = 0; iAlt < nAltsG; iAlt++, n++) {
+	  if (IsHalo)
+	    field[(index + iAlt) * stride] = buffer[n];
+	  else
+	    buffer[n] = field[(index + iAlt) * stride];
+	}
+      }
+    }
+  }
+
+}
+
+// -----------------------------------------------------------------------------
+// Add a field to a halo group
+// -----------------------------------------------------------------------------
+
+void Parallel::add_halo_field(int iGroup, float *field, long stride) {
+
+  halo_field_struct halo_field;
+  halo_field.field = field;
+  halo_field.stride = stride;
+  halo_groups[iGroup].fields.push_back(halo_field);
+
+}
+
+// -----------------------------------------------------------------------------
+// Send the edges of the fields in a group to the neighbors, and get
+// ready to receive theirs.  This doesn't wait for anything.
+// -----------------------------------------------------------------------------
+
+void Parallel::start_halo_exchange([[maybe_unused]] int iGroup,
+				   Report &report) {
+
+  static std::string function="Parallel::start_halo_exchange";
+  static int iFunction = -1;
+  report.enter(function, iFunction);
+
+#ifdef AETHER_USE_MPI
+  halo_group_struct &group = halo_groups[iGroup];
+
+  if (nRanks > 1 && !group.IsExchanging) {
+
+    group.requests.clear();
+
+    for (int iDirection = 0; iDirection < nDirections; iDirection++) {
+      if (neighbors[iDirection] < 0) continue;
+
+      // The message is tagged with the direction that it is going, so
+      // what comes from the west neighbor is going east:
+      MPI_Request request;
+      copy_slab(group, iDirection, 0);
+      group.receive_buffers[iDirection].resize(group.send_buffers[iDirection].size());
+      MPI_Irecv(group.receive_buffers[iDirection].data(),
+		group.receive_buffers[iDirection].size(), MPI_FLOAT,
+		neighbors[iDirection], iGroup * nDirections + (iDirection ^ 1),
+		MPI_COMM_WORLD, &request);
+      group.requests.push_back(request);
+      MPI_Isend(group.send_buffers[iDirection].data(),
+		group.send_buffers[iDirection].size(), MPI_FLOAT,
+		neighbors[iDirection], iGroup * nDirections + iDirection,
+		MPI_COMM_WORLD, &request);
+      group.requests.push_back(request);
+    }
+
+    group.IsExchanging = 1;
+
+  }
+#endif
+
+  report.exit(function);
+
+}
+
+// -----------------------------------------------------------------------------
+// Wait for the neighbors and fill in the halo.  It is ok to call this
+// if the exchange was never started (then it does nothing).
+// -----------------------------------------------------------------------------
+
+void Parallel::finish_halo_exchange([[maybe_unused]] int iGroup,
+				    Report &report) {
+
+  static std::string function="Parallel::finish_halo_exchange";
+  static int iFunction = -1;
+  report.enter(function, iFunction);
+
+#ifdef AETHER_USE_MPI
+  halo_group_struct &group = halo_groups[iGroup];
+
+  if (group.IsExchanging) {
+
+    MPI_Waitall(group.requests.size(), group.requests.data(),
+		MPI_STATUSES_IGNORE);
+
+    for (int iDirection = 0; iDirection < nDirections; iDirection++)
+      if (neighbors[iDirection] >= 0) copy_slab(group, iDirection, 1);
+
+    group.IsExchanging = 0;
+
+  }
+#endif
+
+  report.exit(function);
+
+}
+
+// -----------------------------------------------------------------------------
+// Sum over all of the processes
+// -----------------------------------------------------------------------------
+
+double Parallel::sum(double value) {
+#ifdef AETHER_USE_MPI
+  double total;
+  MPI_Allreduce(&value, &total, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  return total;
+#else
+  return value;
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Maximum over all of the processes
+// -----------------------------------------------------------------------------
+
+double Parallel::max(double value) {
+#ifdef AETHER_USE_MPI
+  double maximum;
+  MPI_Allreduce(&value, &maximum, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+  return maximum;
+#else
+  return value;
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Minimum over all of the processes
+// -----------------------------------------------------------------------------
+
+double Parallel::min(double value) {
+#ifdef AETHER_USE_MPI
+  double minimum;
+  MPI_Allreduce(&value, &minimum, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+  return minimum;
+#else
+  return value;
+#endif
+}
+
+// -----------------------------------------------------------------------------
+// Each process sends the columns that it owns to the root, which puts
+// them where they go in the whole grid.
+// -----------------------------------------------------------------------------
+
+float *Parallel::gather_s3gc(float *field_s3gc,
+			     [[maybe_unused]] const grid_extents &extents,
+			     [[maybe_unused]] std::vector<float> &global_s3gc) {
+
+  if (nRanks == 1) return field_s3gc;
+
+#ifdef AETHER_USE_MPI
+  long iLonStart, iLonEnd, iLatStart, iLatEnd, iLon, iLat, iAlt, n = 0;
+  long nAltsG = extents.nAltsG;
+
+  // The lats of a column are next to each other, so they go together:
+  owned_columns(extents, iLonStart, iLonEnd, iLatStart, iLatEnd);
+  std::vector<float> owned((iLonEnd - iLonStart) * (iLatEnd - iLatStart) * nAltsG);
+  Field2D<float> columns(NULL, extents);
+  for (iLon = iLonStart; iLon < iLonEnd; iLon++) {
+    long index = columns.index(iLon, iLatStart) * nAltsG;
+    long nValues = (iLatEnd - iLatStart) * nAltsG;
+    for (long i = 0; i < nValues; i++, n++) owned[n] = field_s3gc[index + i];
+  }
+
+  std::vector<int> counts, offsets;
+  std::vector<float> all_owned;
+  std::vector<grid_extents> blocks;
+
+  if (iRank == 0) {
+    long nAll = 0;
+    for (int iR = 0; iR < nRanks; iR++) {
+      blocks.push_back(block_of_rank(iR / nRanksLat, iR % nRanksLat));
+      owned_columns(blocks[iR], iLonStart, iLonEnd, iLatStart, iLatEnd);
+      counts.push_back((iLonEnd - iLonStart) * (iLatEnd - iLatStart) * nAltsG);
+      offsets.push_back(nAll);
+      nAll = nAll + counts[iR];
+    }
+    all_owned.resize(nAll);
+  }
+
+  MPI_Gatherv(owned.data(), owned.size(), MPI_FLOAT,
+	      all_owned.data(), counts.data(), offsets.data(), MPI_FLOAT,
+	      0, MPI_COMM_WORLD);
+
+  if (iRank != 0) return nullptr;
+
+  global_s3gc.resize(global_extents.nPointsG);
+  Field2D<float> global_columns(NULL, global_extents);
+
+  for (int iR = 0; iR < nRanks; iR++) {
+    owned_columns(blocks[iR], iLonStart, iLonEnd, iLatStart, iLatEnd);
+    n = offsets[iR];
+    for (iLon = iLonStart; iLon < iLonEnd; iLon++) {
+      for (iLat = iLatStart; iLat < iLatEnd; iLat++) {
+	long index = global_columns.index(iLon + blocks[iR].iLonOffset,
+					  iLat + blocks[iR].iLatOffset) * nAltsG;
+	for (iAlt = 0; iAlt < nAltsG; iAlt++, n++)
+	  global_s3gc[index + iAlt] = all_owned[n];
+      }
+    }
+  }
+
+  return global_s3gc.data();
+#else
+  return field_s3gc;
+#endif
+
+}
+
+// -----------------------------------------------------------------------------
+// The timing summary, with the slowest process and the mean over all
+// of them.  Every process has to go through the same functions for
+// this to work, so if they don't, each one just has its own.
+// -----------------------------------------------------------------------------
+
+void Parallel::times(Report &report) {
+
+  std::vector<float> timings = report.get_timings();
+
+#ifdef AETHER_USE_MPI
+  if (nRanks > 1) {
+    long nEntries = timings.size();
+    if (max(nEntries) == nEntries && min(nEntries) == nEntries) {
+      std::vector<float> timing_max(nEntries), timing_mean(nEntries);
+      MPI_Reduce(timings.data(), timing_max.data(), nEntries, MPI_FLOAT,
+		 MPI_MAX, 0, MPI_COMM_WORLD);
+      MPI_Reduce(timings.data(), timing_mean.data(), nEntries, MPI_FLOAT,
+		 MPI_SUM, 0, MPI_COMM_WORLD);
+      for (long iEntry = 0; iEntry < nEntries; iEntry++)
+	timing_mean[iEntry] = timing_mean[iEntry] / nRanks;
+      if (iRank == 0) report.times(timing_max, timing_mean, nRanks);
+      return;
+    }
+  }
+#endif
+
+  report.times(timings, timings, 1);
+
+}
+
+// -----------------------------------------------------------------------------
+// Which process this is (0 is the root)
+// -----------------------------------------------------------------------------
+
+int Parallel::get_iRank() {
+  return iRank;
+}
+
+// -----------------------------------------------------------------------------
+// Number of processes
+// -----------------------------------------------------------------------------
+
+int Parallel::get_nRanks() {
+  return nRanks;
+}
+
+// -----------------------------------------------------------------------------
+// The root does the output
+// -----------------------------------------------------------------------------
+
+int Parallel::is_root() {
+  return iRank == 0;
+}
+
+// -----------------------------------------------------------------------------
+// Extents of the whole grid
+// -----------------------------------------------------------------------------
+
+grid_extents Parallel::get_global_extents() {
+  return global_extents;
+}
@@ -16,7 +16,7 @@
 // Constructor (initiaze the class):
 // -----------------------------------------------------------------------------
 
-Planets::Planets(Inputs args, Report report) {
+Planets::Planets(const Inputs &args, Report &report) {
   int iErr = 0;
 
   iErr = read_file(args, report);
@@ -27,7 +27,7 @@ Planets::Planets(Inputs args, Report report) {
 //
 // -----------------------------------------------------------------------------
 
-float Planets::get_longitude_offset(Times time) {
+float Planets::get_longitude_offset(const Times &time) {
   int iErr = update(time);
   return planet.longitude_offset;
 }
@@ -36,7 +36,7 @@ float Planets::get_longitude_offset(Times time) {
 //
 // -----------------------------------------------------------------------------
 
-float Planets::get_sin_dec(Times time) {
+float Planets::get_sin_dec(const Times &time) {
   int iErr = update(time);
   return planet.sin_dec;
 }
@@ -45,7 +45,7 @@ float Planets::get_sin_dec(Times time) {
 //
 // -----------------------------------------------------------------------------
 
-float Planets::get_cos_dec(Times time) {
+float Planets::get_cos_dec(const Times &time) {
   int iErr = update(time);
   return planet.cos_dec;
 }
@@ -54,7 +54,15 @@ float Planets::get_cos_dec(Times time) {
 //
 // -----------------------------------------------------------------------------
 
-float Planets::get_radius(float latitude) {
+float Planets::get_length_of_day() const {
+  return planet.length_of_day;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+
+float Planets::get_radius(float latitude) const {
   // Should modify this to allow an oblate spheriod, but not now.
   return planet.radius;
 }
@@ -63,7 +71,7 @@ float Planets::get_radius(float latitude) {
 //
 // -----------------------------------------------------------------------------
 
-float Planets::get_dipole_rotation() {
+float Planets::get_dipole_rotation() const {
   return planet.dipole_rotation;
 }
 
@@ -71,7 +79,7 @@ float Planets::get_dipole_rotation() {
 //
 // -----------------------------------------------------------------------------
 
-float Planets::get_dipole_tilt() {
+float Planets::get_dipole_tilt() const {
   return planet.dipole_tilt;
 }
 
@@ -79,7 +87,7 @@ float Planets::get_dipole_tilt() {
 //
 // -----------------------------------------------------------------------------
 
-float Planets::get_dipole_strength() {
+float Planets::get_dipole_strength() const {
   return planet.dipole_strength;
 }
 
@@ -87,7 +95,7 @@ float Planets::get_dipole_strength() {
 //
 // -----------------------------------------------------------------------------
 
-std::vector<float> Planets::get_dipole_center() {
+std::vector<float> Planets::get_dipole_center() const {
   return planet.dipole_center;
 }
 
@@ -95,7 +103,7 @@ std::vector<float> Planets::get_dipole_center() {
 //
 // -----------------------------------------------------------------------------
 
-float Planets::get_mu() {
+float Planets::get_mu() const {
   return planet.mu;
 }
 
@@ -103,7 +111,7 @@ float Planets::get_mu() {
 //
 // -----------------------------------------------------------------------------
 
-float Planets::get_star_to_planet_dist(Times time) {
+float Planets::get_star_to_planet_dist(const Times &time) {
 
   int iErr = update(time);
   return planet.star_planet_distance;
@@ -114,7 +122,7 @@ float Planets::get_star_to_planet_dist(Times time) {
 //
 // -----------------------------------------------------------------------------
 
-float Planets::get_orbit_angle(Times time) {
+float Planets::get_orbit_angle(const Times &time) {
 
   int iErr = update(time);
   return planet.orbit_angle;
@@ -125,7 +133,7 @@ float Planets::get_orbit_angle(Times time) {
 //
 // -----------------------------------------------------------------------------
 
-float Planets::get_declination(Times time) {
+float Planets::get_declination(const Times &time) {
 
   int iErr = update(time);
   return planet.declination;;
@@ -136,12 +144,13 @@ float Planets::get_declination(Times time) {
 //
 // -----------------------------------------------------------------------------
 
-int Planets::update(Times time) {
+int Planets::update(const Times &time) {
 
   int iErr = 0;
   
-  // Update planetary stuff once a minute:
-  if (time.get_current() - planet.update_time > 60.0) {
+  // The orbit only depends on the time, so only update it when the
+  // time changes:
+  if (time.get_current() != planet.update_time) {
 
     planet.update_time = time.get_current();
 
@@ -245,7 +254,7 @@ int Planets::update(Times time) {
 
 }
 
-int Planets::set_planet(Inputs args, Report report) {
+int Planets::set_planet(const Inputs &args, Report &report) {
 
   int iErr = 0;
   int IsFound = 0;
@@ -323,7 +332,7 @@ int Planets::set_planet(Inputs args, Report report) {
 
 }
 
-int Planets::read_file(Inputs args, Report report) {
+int Planets::read_file(const Inputs &args, Report &report) {
 
   planet_chars tmp;
   std::string line, col;
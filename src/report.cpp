@@ -15,6 +15,7 @@ Report::Report() {
   current_entry = "";
   nEntries = 0;
   iVerbose = 0;
+  iRank = 0;
   divider = ">";
   divider_length = divider.length();
   iLevel = 0;  
@@ -25,11 +26,13 @@ Report::Report() {
 // 
 // -----------------------------------------------------------------------
 
-void Report::enter(std::string input, int &iFunction) {
+void Report::enter(const std::string &input, int &iFunction) {
 
   int iOldStrLen = current_entry.length();
 
-  current_entry = current_entry + divider + input;
+  // This only allocates when current_entry gets longer than it has
+  // ever been, so it is quiet once every function has been seen:
+  current_entry.append(divider).append(input);
 
   int iEntry = -1;
 
@@ -45,6 +48,7 @@ void Report::enter(std::string input, int &iFunction) {
     tmp.entry = current_entry;
     tmp.nTimes = 0;
     tmp.timing_total = 0.0;
+    tmp.nBytes = 0.0;
     tmp.iStringPosBefore = iOldStrLen;
     tmp.iLastEntry = iCurrentFunction;
     entries.push_back(tmp);
@@ -62,7 +66,8 @@ void Report::enter(std::string input, int &iFunction) {
   entries[iEntry].iLevel = iLevel;
   iCurrentFunction = iEntry;
   
-  print(iLevel,"Entering function : "+current_entry);
+  if (test_verbose(iLevel))
+    std::cout << "Entering function : " << current_entry << "\n";
   
 }
 
@@ -70,7 +75,7 @@ void Report::enter(std::string input, int &iFunction) {
 // 
 // -----------------------------------------------------------------------
 
-void Report::exit(std::string input) {
+void Report::exit(const std::string &input) {
 
   int iEntry = -1;
   iEntry = iCurrentFunction;
@@ -92,7 +97,7 @@ void Report::exit(std::string input) {
     //   std::cout << "   current_entry : " << current_entry << "\n";
     // } else {
     // current_entry = current_entry.substr(0,pos-divider_length);
-    current_entry = current_entry.substr(0,entries[iEntry].iStringPosBefore);
+    current_entry.resize(entries[iEntry].iStringPosBefore);
     iCurrentFunction = entries[iEntry].iLastEntry;
     iLevel--;
     // }
@@ -106,13 +111,48 @@ void Report::exit(std::string input) {
 
 void Report::times() {
 
+  std::vector<float> timings = get_timings();
+  times(timings, timings, 1);
+
+}
+
+// -----------------------------------------------------------------------
+// Timing summary, where timing_max is the slowest process and
+// timing_mean is the mean over all nProcesses processes
+// -----------------------------------------------------------------------
+
+void Report::times(std::vector<float> timing_max,
+		   std::vector<float> timing_mean,
+		   int nProcesses) {
+
   std::cout << "Timing Summary :\n";
+  if (nProcesses > 1)
+    std::cout << "(slowest of " << nProcesses << " processes)\n";
   for (int i=0; i < nEntries; i++) {
     std::cout << entries[i].entry << "\n";
     for (int j=0; j < entries[i].iLevel; j++) std::cout << "  ";
     std::cout << "nTimes called : " << entries[i].nTimes << "\n";
     for (int j=0; j < entries[i].iLevel; j++) std::cout << "  ";
-    std::cout << "timing_total (s) : " << entries[i].timing_total << "\n";
+    std::cout << "timing_total (s) : " << timing_max[i] << "\n";
+    if (nProcesses > 1) {
+      for (int j=0; j < entries[i].iLevel; j++) std::cout << "  ";
+      std::cout << "timing_mean (s) : " << timing_mean[i] << "\n";
+    }
+    if (entries[i].nBytes > 0.0 && entries[i].nTimes > 0) {
+      float timing_call = timing_max[i] / entries[i].nTimes;
+      for (int j=0; j < entries[i].iLevel; j++) std::cout << "  ";
+      std::cout << "timing_per_call (s) : " << timing_call
+		<< ", ~" << entries[i].nBytes / (1024 * 1024)
+		<< " MB/call (estimated)";
+      if (timing_call > 0.0)
+	std::cout << ", ~" << entries[i].nBytes / timing_call / 1.0e9
+		  << " GB/s";
+      std::cout << "\n";
+    }
+    if (entries[i].note.length() > 0) {
+      for (int j=0; j < entries[i].iLevel; j++) std::cout << "  ";
+      std::cout << entries[i].note << "\n";
+    }
   }
 
 }
@@ -121,9 +161,38 @@ void Report::times() {
 // 
 // -----------------------------------------------------------------------
 
-void Report::print(int iLevel, std::string output_string) {
+void Report::set_note(int iFunction, const std::string &note) {
+  if (iFunction > -1 && iFunction < nEntries) entries[iFunction].note = note;
+}
+
+// -----------------------------------------------------------------------
+// 
+// -----------------------------------------------------------------------
+
+void Report::set_nBytes(int iFunction, double nBytes) {
+  if (iFunction > -1 && iFunction < nEntries)
+    entries[iFunction].nBytes = nBytes;
+}
 
-  if (iLevel <= iVerbose) {
+// -----------------------------------------------------------------------
+// Total time in each entry
+// -----------------------------------------------------------------------
+
+std::vector<float> Report::get_timings() {
+
+  std::vector<float> timings;
+  for (int i=0; i < nEntries; i++) timings.push_back(entries[i].timing_total);
+  return timings;
+
+}
+
+// -----------------------------------------------------------------------
+// 
+// -----------------------------------------------------------------------
+
+void Report::print(int iLevel, const std::string &output_string) {
+
+  if (iLevel <= iVerbose && iRank == 0) {
 
     for (int iL=0;iL<iLevel;iL++) std::cout << "=";
     std::cout << "> " << output_string << "\n";
@@ -139,7 +208,7 @@ void Report::print(int iLevel, std::string output_string) {
 int Report::test_verbose(int iLevel) {
 
   int iPass = 0;
-  if (iLevel <= iVerbose) {
+  if (iLevel <= iVerbose && iRank == 0) {
     iPass = 1;
     for (int iL=0;iL<iLevel;iL++) std::cout << "=";
     std::cout << "> ";
@@ -164,3 +233,11 @@ void Report::set_verbose(int input) {
 int Report::get_verbose() {
   return iVerbose;
 }
+
+// -----------------------------------------------------------------------
+// Only the root process (iRank = 0) prints
+// -----------------------------------------------------------------------
+
+void Report::set_iRank(int iRank_in) {
+  iRank = iRank_in;
+}
@@ -0,0 +1,177 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#include <string>
+#include <sstream>
+#include <cmath>
+
+#include "../include/scheduler.h"
+
+// -----------------------------------------------------------------------------
+// Everything runs every step, in one step, until it is set otherwise
+// -----------------------------------------------------------------------------
+
+Scheduler::Scheduler() {
+
+  names[sza_process] = "sza";
+  names[euv_process] = "euv";
+  names[conduction_process] = "conduction";
+  names[sources_process] = "sources";
+  names[chemistry_process] = "chemistry";
+  names[output_process] = "output";
+
+  for (int iProcess = 0; iProcess < nProcesses; iProcess++) {
+    IsIntegrator[iProcess] = 0;
+    cadence[iProcess] = 0.0;
+    max_subcycles[iProcess] = 1;
+    next_run[iProcess] = -1.0;
+    done_to[iProcess] = -1.0;
+    nRuns[iProcess] = 0;
+    nSubcyclesTotal[iProcess] = 0;
+    iFunction[iProcess] = -1;
+  }
+
+  IsIntegrator[sources_process] = 1;
+  IsIntegrator[chemistry_process] = 1;
+
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+
+int Scheduler::find_process(const std::string &name) const {
+  for (int iProcess = 0; iProcess < nProcesses; iProcess++)
+    if (names[iProcess] == name) return iProcess;
+  return -1;
+}
+
+void Scheduler::set_process(int iProcess, float cadence_in,
+			    int max_subcycles_in) {
+  cadence[iProcess] = cadence_in;
+  max_subcycles[iProcess] = max_subcycles_in;
+  if (max_subcycles[iProcess] < 1) max_subcycles[iProcess] = 1;
+}
+
+// -----------------------------------------------------------------------------
+// The next run is the next multiple of the cadence after the first
+// run, so the runs don't drift when the time step changes.  The
+// integrators also run on the step that gets to the intermediate time,
+// so they have caught up when it is there.
+// -----------------------------------------------------------------------------
+
+int Scheduler::is_due(int iProcess, const Times &time) {
+
+  if (cadence[iProcess] <= 0.0) {
+    nRuns[iProcess]++;
+    return 1;
+  }
+
+  double current = time.get_current();
+  double tiny = 1.0e-6 * cadence[iProcess];
+
+  int IsDue = 0;
+  if (next_run[iProcess] < 0.0) {
+    IsDue = 1;
+    next_run[iProcess] = current;
+  }
+  if (current >= next_run[iProcess] - tiny) IsDue = 1;
+  if (IsIntegrator[iProcess] &&
+      current + time.get_dt() >= time.get_intermediate() - tiny) IsDue = 1;
+
+  if (IsDue) {
+    nRuns[iProcess]++;
+    while (next_run[iProcess] <= current + tiny)
+      next_run[iProcess] += cadence[iProcess];
+  }
+
+  return IsDue;
+
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+
+float Scheduler::get_dt(int iProcess, const Times &time) const {
+
+  float dt = time.get_dt();
+
+  if (cadence[iProcess] > 0.0) {
+    if (IsIntegrator[iProcess]) {
+      if (done_to[iProcess] >= 0.0)
+	dt = time.get_current() + time.get_dt() - done_to[iProcess];
+    } else {
+      if (cadence[iProcess] > dt) dt = cadence[iProcess];
+    }
+  }
+
+  return dt;
+
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+
+int Scheduler::get_nSubcycles(int iProcess, float dt, float dt_limit) const {
+
+  int nSubcycles = 1;
+  if (max_subcycles[iProcess] > 1 && dt_limit > 0.0 && dt > dt_limit) {
+    nSubcycles = max_subcycles[iProcess];
+    if (dt / dt_limit < nSubcycles) nSubcycles = ceil(dt / dt_limit);
+  }
+  return nSubcycles;
+
+}
+
+float Scheduler::get_dt_limit(int iProcess, float dt_limit) const {
+  if (cadence[iProcess] > 0.0) return 1.0e30;
+  return dt_limit * max_subcycles[iProcess];
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+
+void Scheduler::start(int iProcess, Report &report) {
+  report.enter(names[iProcess], iFunction[iProcess]);
+}
+
+void Scheduler::stop(int iProcess,
+		     const Times &time,
+		     int nSubcycles,
+		     Report &report) {
+  done(iProcess, time, nSubcycles);
+  report.exit(names[iProcess]);
+}
+
+void Scheduler::done(int iProcess, const Times &time, int nSubcycles) {
+  done_to[iProcess] = time.get_current() + time.get_dt();
+  nSubcyclesTotal[iProcess] += nSubcycles;
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+
+void Scheduler::add_notes(Report &report) const {
+
+  for (int iProcess = 0; iProcess < nProcesses; iProcess++) {
+
+    if (iFunction[iProcess] < 0) continue;
+
+    std::ostringstream note;
+    note << "cadence (s) : ";
+    if (cadence[iProcess] > 0.0) note << cadence[iProcess];
+    else note << "every step";
+    note << ", runs : " << nRuns[iProcess];
+    if (max_subcycles[iProcess] > 1 && nRuns[iProcess] > 0)
+      note << ", sub-steps per run : "
+	   << float(nSubcyclesTotal[iProcess]) / nRuns[iProcess]
+	   << " (max " << max_subcycles[iProcess] << ")";
+    report.set_note(iFunction[iProcess], note.str());
+
+  }
+
+}
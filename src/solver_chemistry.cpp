@@ -8,7 +8,8 @@ float solver_chemistry(float old_density, float source, float loss, float dt) {
 
   // This isn't a great way of doing things probably, but, what the heck:
 
-  // if sources > losses, take an explicit time-step:
+  // if sources > losses, take an explicit time-step (which can't go
+  // negative, since the density only grows):
 
   if (source > loss) {
     new_density = old_density + dt * (source - loss);
@@ -1,60 +1,108 @@
 // (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
 // Full license can be found in License.md
 
+#include <vector>
+
 #include "../include/sizes.h"
+#include "../include/solvers.h"
+
+// Number of work arrays that the solver needs per column:
+#define nConductionWork 10
+
+// -----------------------------------------------------------------------------
+// The parts of the conduction stencil that only depend on the altitude
+// spacing.  The grid computes these once for each altitude profile
+// (Grid::fill_column_geometry), instead of the solver redoing them in
+// every column on every time step.  The spacing doesn't have to be
+// uniform (r is the ratio of the spacing above a cell to the spacing
+// below it).  The first and last points are copies of their neighbors.
+// -----------------------------------------------------------------------------
+
+int conduction_metrics(float *dalt_lower,
+		       float *r,
+		       float *du12,
+		       float *du22,
+		       long nAlts) {
+
+  int iErr = 0;
+  float du, dl;
+
+  for (long iAlt = 1; iAlt < nAlts-1; iAlt++) {
+
+    // This is the dalt upper (lower @ iAlt+1)
+    du = dalt_lower[iAlt+1];
+    // This is the dalt lower
+    dl = dalt_lower[iAlt];
+
+    r[iAlt] = du/dl;
+
+    du12[iAlt] = du*du * (1+r[iAlt])*(1+r[iAlt]);
+    du22[iAlt] = 0.5 * (dl*du + du*du);
+
+  }
+
+  r[0] = r[1];
+  du12[0] = du12[1];
+  du22[0] = du22[1];
+  r[nAlts-1] = r[nAlts-2];
+  du12[nAlts-1] = du12[nAlts-2];
+  du22[nAlts-1] = du22[nAlts-2];
+
+  return iErr;
+
+}
 
+// -----------------------------------------------------------------------------
+// Solve the conduction equation in one column.  If nAltsFixed is
+// non-zero, it is the number of altitudes (including ghost cells),
+// known at compile time, so the compiler can unroll and vectorize the
+// loops.  If it is zero, nAlts is used.  The work space has to hold
+// nConductionWork arrays of nAlts.  r, du12 and du22 come from
+// conduction_metrics.
 // Assume that lambda and front are scaled by radius squared!
+// -----------------------------------------------------------------------------
 
-int solver_conduction(float value[nGeoAltsG],
-		      float lambda[nGeoAltsG],
-		      float front[nGeoAltsG],
-		      float dt,
-		      float dalt_lower[nGeoAltsG],
-		      float *conduction) {
+template <long nAltsFixed>
+static int solver_conduction_column(float *value,
+				    float *lambda,
+				    float *front,
+				    float dt,
+				    float *r,
+				    float *du12,
+				    float *du22,
+				    float *conduction,
+				    long nAlts,
+				    float *work) {
+
+  if (nAltsFixed > 0) nAlts = nAltsFixed;
+
+  float *di = work;
+  float *m = di + nAlts;
+  float *dl = m + nAlts;
+  float *a = dl + nAlts;
+  float *b = a + nAlts;
+  float *c = b + nAlts;
+  float *d = c + nAlts;
+  float *cp = d + nAlts;
+  float *dp = cp + nAlts;
+  float *result = dp + nAlts;
 
   int iErr = 0;
 
   int iAlt;
 
-  float r[nGeoAltsG];
-  float di[nGeoAltsG];
-  float m[nGeoAltsG];
-  float du[nGeoAltsG];
-  float dl[nGeoAltsG];
-  float du12[nGeoAltsG];
-  float du22[nGeoAltsG];
-  float lou[nGeoAltsG];
-  float a[nGeoAltsG];
-  float b[nGeoAltsG];
-  float c[nGeoAltsG];
-  float d[nGeoAltsG];
-  float cp[nGeoAltsG];
-  float dp[nGeoAltsG];
-  float result[nGeoAltsG];
-  
   // Only solve for conduction in the middle section.
   conduction[0] = 0.0;
-  conduction[nGeoAltsG-1] = 0.0;
+  conduction[nAlts-1] = 0.0;
     
-  for (iAlt=1; iAlt < nGeoAltsG-1; iAlt++) {
+  for (iAlt=1; iAlt < nAlts-1; iAlt++) {
 
     di[iAlt] = lambda[iAlt];
     m[iAlt] = dt / front[iAlt];
 
-    // This is the dalt upper (lower @ iAlt+1)
-    du[iAlt] = dalt_lower[iAlt+1];
-    // This is the dalt lower
-    dl[iAlt] = dalt_lower[iAlt];
-
-    r[iAlt] = du[iAlt]/dl[iAlt];
-
-    du12[iAlt] = du[iAlt]*du[iAlt] * (1+r[iAlt])*(1+r[iAlt]);
-    du22[iAlt] = 0.5 * (dl[iAlt]*du[iAlt] + du[iAlt]*du[iAlt]);
-    lou[iAlt] = di[iAlt]/du22[iAlt];
-
   }
     
-  for (iAlt=2; iAlt < nGeoAltsG-2; iAlt++) {
+  for (iAlt=2; iAlt < nAlts-2; iAlt++) {
 
     dl[iAlt] =
       di[iAlt+1] -
@@ -82,33 +130,224 @@ int solver_conduction(float value[nGeoAltsG],
   //     (For neutral temperature, this isn't really needed, since it is iso-thermal
   //      in the upper thermosphere, but in the ionosphere, the electron and
   //      ion temperatures are typically sloped.)
-  iAlt = nGeoAltsG-2;
+  iAlt = nAlts-2;
   a[iAlt] = 1.0*( r[iAlt]*(1.0+r[iAlt])*di[iAlt]*m[iAlt]/du22[iAlt]);
   b[iAlt] = -1.0*( 1.0 + r[iAlt]*(1+r[iAlt])*di[iAlt]*m[iAlt]/du22[iAlt]);
   c[iAlt] = 0.0;
   d[iAlt] = -1.0*value[iAlt];
 
   cp[1] = c[1]/b[1];
-  for (iAlt=2; iAlt <= nGeoAltsG-2; iAlt++) 
+  for (iAlt=2; iAlt <= nAlts-2; iAlt++) 
     cp[iAlt] = c[iAlt]/(b[iAlt]-cp[iAlt-1]*a[iAlt]);
 
   dp[1] = d[1]/b[1];
-  for (iAlt=2; iAlt <= nGeoAltsG-2; iAlt++) 
+  for (iAlt=2; iAlt <= nAlts-2; iAlt++) 
     dp[iAlt] = (d[iAlt]-dp[iAlt-1]*a[iAlt])/(b[iAlt]-cp[iAlt-1]*a[iAlt]);
 
-  result[nGeoAltsG-2] = dp[nGeoAltsG-2];
-  for (iAlt=nGeoAltsG-3; iAlt>0; iAlt--)
+  result[nAlts-2] = dp[nAlts-2];
+  for (iAlt=nAlts-3; iAlt>0; iAlt--)
     result[iAlt] = dp[iAlt] - cp[iAlt]*result[iAlt+1];
   
   conduction[0] = 0.0;
-  for (iAlt=1; iAlt<nGeoAltsG-2; iAlt++) {
+  for (iAlt=1; iAlt<nAlts-2; iAlt++) {
     conduction[iAlt] = result[iAlt] - value[iAlt];
     //cout << "Conduction : " << iAlt << " " <<  conduction[iAlt]*seconds_per_day << " (deg/day)\n";
   }
-  conduction[nGeoAltsG-1] = conduction[nGeoAltsG-2];
+  conduction[nAlts-1] = conduction[nAlts-2];
 
   return iErr;
 
 }
 
     
+
+// -----------------------------------------------------------------------------
+// Any column length.  The work space is kept around, so it only gets
+// allocated when the column length changes.
+// -----------------------------------------------------------------------------
+
+int solver_conduction_generic(float *value,
+			      float *lambda,
+			      float *front,
+			      float dt,
+			      float *r,
+			      float *du12,
+			      float *du22,
+			      float *conduction,
+			      long nAlts) {
+
+  static thread_local std::vector<float> work;
+  if (work.size() < nConductionWork * nAlts)
+    work.resize(nConductionWork * nAlts);
+
+  return solver_conduction_column<0>(value, lambda, front, dt,
+				     r, du12, du22, conduction,
+				     nAlts, work.data());
+
+}
+
+// -----------------------------------------------------------------------------
+// Pick the version of the solver for this column length.  These are
+// the common grids (50 and 100 altitudes, plus ghost cells):
+// -----------------------------------------------------------------------------
+
+int solver_conduction(float *value,
+		      float *lambda,
+		      float *front,
+		      float dt,
+		      float *r,
+		      float *du12,
+		      float *du22,
+		      float *conduction,
+		      long nAlts) {
+
+  const long nAlts50 = 50 + 2 * nGeoGhosts;
+  const long nAlts100 = 100 + 2 * nGeoGhosts;
+
+  int iErr;
+
+  if (nAlts == nAlts50) {
+    float work[nConductionWork * nAlts50];
+    iErr = solver_conduction_column<nAlts50>(value, lambda, front, dt,
+					     r, du12, du22, conduction,
+					     nAlts, work);
+  } else if (nAlts == nAlts100) {
+    float work[nConductionWork * nAlts100];
+    iErr = solver_conduction_column<nAlts100>(value, lambda, front, dt,
+					      r, du12, du22, conduction,
+					      nAlts, work);
+  } else {
+    iErr = solver_conduction_generic(value, lambda, front, dt,
+				     r, du12, du22, conduction, nAlts);
+  }
+
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// Solve the conduction equation in nLanes columns at once (see
+// solvers.h).  This is the same stencil and boundary conditions as
+// solver_conduction_column, but it is all done in floats, and the
+// forward sweep builds a row of the matrix and then eliminates it, so
+// only cp and dp (stored [iAlt][iLane]) have to be kept.  lambda is
+// only needed at iAlt-1, iAlt and iAlt+1, so those are carried up the
+// column.  Like solver_conduction_column, the top two altitudes and the
+// bottom one get no conduction.
+//
+// Each lane reads from its own column, so the compiler can't vectorize
+// a loop that reads through batch.  At each altitude, the lanes are
+// first read into small arrays (which stay in registers or L1), and
+// then the math is done on those, which is vectorized.
+// -----------------------------------------------------------------------------
+
+template <int nLanes>
+int solver_conduction_batch(const conduction_batch_struct<nLanes> &batch,
+			    float dt,
+			    long nAlts,
+			    float *work) {
+
+  float *cp = work;
+  float *dp = cp + nAlts * nLanes;
+
+  float lambda_below[nLanes], lambda_here[nLanes], lambda_above[nLanes];
+  float temp[nLanes], front[nLanes], r[nLanes], du12[nLanes], du22[nLanes];
+  float rate[nLanes];
+  float dt_inv = 1.0f / dt;
+  long iAlt;
+  int iLane;
+
+  // Lower BC (the temperature is held):
+  for (iLane = 0; iLane < nLanes; iLane++) {
+    cp[nLanes + iLane] = 0.0f;
+    dp[nLanes + iLane] = batch.temperature[iLane][1];
+    lambda_below[iLane] = batch.kappa[iLane][1] * batch.radius_sq[iLane][1];
+    lambda_here[iLane] = batch.kappa[iLane][2] * batch.radius_sq[iLane][2];
+  }
+
+  for (iAlt = 2; iAlt < nAlts - 2; iAlt++) {
+
+    float *cp_here = cp + iAlt * nLanes;
+    float *dp_here = dp + iAlt * nLanes;
+
+    for (iLane = 0; iLane < nLanes; iLane++) {
+      lambda_above[iLane] =
+	batch.kappa[iLane][iAlt + 1] * batch.radius_sq[iLane][iAlt + 1];
+      front[iLane] = batch.rho_cv[iLane][iAlt] * batch.radius_sq[iLane][iAlt];
+      temp[iLane] = batch.temperature[iLane][iAlt];
+      r[iLane] = batch.r[iLane][iAlt];
+      du12[iLane] = batch.du12[iLane][iAlt];
+      du22[iLane] = batch.du22[iLane][iAlt];
+    }
+
+    for (iLane = 0; iLane < nLanes; iLane++) {
+
+      float r2 = r[iLane] * r[iLane];
+      float front_dt = front[iLane] * dt_inv;
+
+      float di_du22 = lambda_here[iLane] / du22[iLane];
+      float dl_du12 =
+	(lambda_above[iLane] -
+	 lambda_below[iLane] * r2 -
+	 lambda_here[iLane] * (1.0f - r2)) / du12[iLane];
+
+      float a = di_du22 * r[iLane] - dl_du12 * r2;
+      float b =
+	- front_dt - di_du22 * (1.0f + r[iLane]) - dl_du12 * (1.0f - r2);
+      float c = di_du22 + dl_du12;
+      float d = - temp[iLane] * front_dt;
+
+      float denominator = 1.0f / (b - cp_here[iLane - nLanes] * a);
+      cp_here[iLane] = c * denominator;
+      dp_here[iLane] = (d - dp_here[iLane - nLanes] * a) * denominator;
+
+      lambda_below[iLane] = lambda_here[iLane];
+      lambda_here[iLane] = lambda_above[iLane];
+
+    }
+  }
+
+  // Upper BC (constant gradient), where lambda_here is at nAlts-2:
+  iAlt = nAlts - 2;
+  for (iLane = 0; iLane < nLanes; iLane++) {
+    float r = batch.r[iLane][iAlt];
+    float m = dt / (batch.rho_cv[iLane][iAlt] * batch.radius_sq[iLane][iAlt]);
+    float a = r * (1.0f + r) * lambda_here[iLane] * m / batch.du22[iLane][iAlt];
+    float b = - (1.0f + a);
+    float d = - batch.temperature[iLane][iAlt];
+    cp[iAlt * nLanes + iLane] = 0.0f;
+    dp[iAlt * nLanes + iLane] =
+      (d - dp[(iAlt - 1) * nLanes + iLane] * a) /
+      (b - cp[(iAlt - 1) * nLanes + iLane] * a);
+  }
+
+  // Back substitution, writing dT/dt straight into the field.  The
+  // solution is kept in dp:
+  for (iAlt = nAlts - 3; iAlt > 0; iAlt--) {
+    float *dp_here = dp + iAlt * nLanes;
+    float *cp_here = cp + iAlt * nLanes;
+    for (iLane = 0; iLane < nLanes; iLane++)
+      temp[iLane] = batch.temperature[iLane][iAlt];
+    for (iLane = 0; iLane < nLanes; iLane++) {
+      dp_here[iLane] = dp_here[iLane] - cp_here[iLane] * dp_here[iLane + nLanes];
+      rate[iLane] = (dp_here[iLane] - temp[iLane]) * dt_inv;
+    }
+    for (iLane = 0; iLane < nLanes; iLane++)
+      batch.conduction[iLane][iAlt] = rate[iLane];
+  }
+
+  for (iLane = 0; iLane < nLanes; iLane++) {
+    batch.conduction[iLane][0] = 0.0f;
+    batch.conduction[iLane][nAlts - 2] = 0.0f;
+    batch.conduction[iLane][nAlts - 1] = 0.0f;
+  }
+
+  return 0;
+
+}
+
+// The model uses nConductionLanes, and the benchmark also tries 16:
+template int solver_conduction_batch<8>(const conduction_batch_struct<8> &,
+					float, long, float *);
+template int solver_conduction_batch<16>(const conduction_batch_struct<16> &,
+					 float, long, float *);
@@ -0,0 +1,165 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../include/spectrum_file.h"
+
+// -----------------------------------------------------------------------------
+// Nothing is mapped until open
+// -----------------------------------------------------------------------------
+
+SpectrumFile::SpectrumFile() {
+  data = nullptr;
+  nBytes = 0;
+  nWavelengths = 0;
+  nRecords = 0;
+  record_size = 0;
+  iRecordLast = 0;
+}
+
+SpectrumFile::~SpectrumFile() {
+  close();
+}
+
+// -----------------------------------------------------------------------------
+// Map the file (read only), and check the header against the size of
+// the file and the number of wavelengths in the euv file.
+// -----------------------------------------------------------------------------
+
+int SpectrumFile::open(const std::string &file,
+		       long nWavelengths_in,
+		       Report &report) {
+
+  int iErr = 0;
+  struct stat file_stat;
+
+  close();
+
+  report.print(1, "Mapping spectrum file : " + file);
+
+  int fd = ::open(file.c_str(), O_RDONLY);
+  if (fd < 0 || fstat(fd, &file_stat) != 0) {
+    std::cout << "Could not open spectrum file : " << file << "\n";
+    if (fd >= 0) ::close(fd);
+    return 1;
+  }
+
+  nBytes = file_stat.st_size;
+  if (nBytes >= size_t(header_size)) {
+    void *mapped = mmap(nullptr, nBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped != MAP_FAILED) data = static_cast<const char *>(mapped);
+  }
+  // The mapping stays after the file is closed:
+  ::close(fd);
+
+  if (data == nullptr) {
+    std::cout << "Could not map spectrum file : " << file << "\n";
+    nBytes = 0;
+    return 1;
+  }
+
+  int64_t header[2];
+  memcpy(header, data + 8, sizeof(header));
+  nWavelengths = header[0];
+  nRecords = header[1];
+  record_size = sizeof(double) + nWavelengths * sizeof(float);
+
+  if (memcmp(data, "AETHSPEC", 8) != 0) {
+    std::cout << "Spectrum file " << file << " is not a spectrum file!\n";
+    iErr = 1;
+  } else if (nWavelengths != nWavelengths_in) {
+    std::cout << "Spectrum file " << file << " has " << nWavelengths
+	      << " wavelengths, but the euv file has "
+	      << nWavelengths_in << "!\n";
+    iErr = 1;
+  } else if (nRecords < 1 ||
+	     nBytes != size_t(header_size + nRecords * record_size)) {
+    std::cout << "Spectrum file " << file << " should have " << nRecords
+	      << " records, but it is the wrong size!\n";
+    iErr = 1;
+  }
+
+  if (iErr > 0) {
+    close();
+  } else if (report.test_verbose(2)) {
+    std::cout << "Spectrum file has " << nRecords << " records, from "
+	      << get_time(0) << " to " << get_time(nRecords - 1) << " s\n";
+  }
+
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+//
+// -----------------------------------------------------------------------------
+
+void SpectrumFile::close() {
+  if (data != nullptr) munmap(const_cast<char *>(data), nBytes);
+  data = nullptr;
+  nBytes = 0;
+  nRecords = 0;
+  iRecordLast = 0;
+}
+
+// -----------------------------------------------------------------------------
+// The records don't line up on 8 bytes, so the time is copied out:
+// -----------------------------------------------------------------------------
+
+double SpectrumFile::get_time(long iRecord) const {
+  double time;
+  memcpy(&time, data + header_size + iRecord * record_size, sizeof(time));
+  return time;
+}
+
+const float *SpectrumFile::intensity(long iRecord) const {
+  return reinterpret_cast<const float *>(data + header_size +
+					 iRecord * record_size +
+					 sizeof(double));
+}
+
+// -----------------------------------------------------------------------------
+// Outside of the file, weight is 0 and iRecord is the first or last
+// record, so iRecord+1 is only needed when weight > 0.
+// -----------------------------------------------------------------------------
+
+void SpectrumFile::find(double time, long &iRecord, float &weight) {
+
+  weight = 0.0;
+
+  if (time <= get_time(0)) {
+    iRecord = 0;
+    iRecordLast = 0;
+    return;
+  }
+  if (time >= get_time(nRecords - 1)) {
+    iRecord = nRecords - 1;
+    iRecordLast = 0;
+    return;
+  }
+
+  // Usually this is the same record as last time, or the next one:
+  iRecord = iRecordLast;
+  if (iRecord >= nRecords - 1 || get_time(iRecord) > time) iRecord = 0;
+  if (get_time(iRecord + 1) <= time) {
+    long iLow = iRecord, iHigh = nRecords - 1, iMid;
+    // get_time(iLow) <= time < get_time(iHigh):
+    while (iHigh - iLow > 1) {
+      iMid = (iLow + iHigh) / 2;
+      if (get_time(iMid) <= time) iLow = iMid;
+      else iHigh = iMid;
+    }
+    iRecord = iLow;
+  }
+
+  weight = (time - get_time(iRecord)) /
+    (get_time(iRecord + 1) - get_time(iRecord));
+  iRecordLast = iRecord;
+
+}
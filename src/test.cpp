@@ -2,8 +2,789 @@
 // Full license can be found in License.md
 
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <unistd.h>
 
 #include "../include/time_conversion.h"
+#include "../include/field3d.h"
+#include "../include/workers.h"
+#include "../include/parallel.h"
+#include "../include/report.h"
+#include "../include/allocations.h"
+#include "../include/fast_math.h"
+#include "../include/inputs.h"
+#include "../include/times.h"
+#include "../include/planets.h"
+#include "../include/indices.h"
+#include "../include/euv.h"
+#include "../include/grid.h"
+#include "../include/neutrals.h"
+#include "../include/ions.h"
+#include "../include/chemistry.h"
+#include "../include/constants.h"
+#include "../include/spectrum_file.h"
+#include "../include/solvers.h"
+#include "../include/scheduler.h"
+
+// -----------------------------------------------------------------------------
+// Check the Field3D index math against the [Lon][Lat][Alt] formula, and
+// make sure that the tiles cover every physical column exactly once.
+// The loops that leave out the last lon and lat (iLonStop, iLatStop)
+// still have to do the column of a direction with only one cell.
+// -----------------------------------------------------------------------------
+
+int test_field3d() {
+
+  int iErr = 0;
+  long iLon, iLat, iAlt, iDir, nColumns = 0;
+
+  grid_extents extents(5, 4, 3, 2);
+  std::vector<float> vector(extents.nPointsG * 3);
+  std::vector<int> nVisits(extents.nLonsG * extents.nLatsG, 0);
+
+  Field3D<float> scalar(NULL, extents);
+  Field3D<float, 3> velocity(vector.data(), extents);
+  Field3D<float, 1, 1> edges(NULL, extents);
+
+  for (iLon = 0; iLon < extents.nLonsG; iLon++)
+    for (iLat = 0; iLat < extents.nLatsG; iLat++)
+      for (iAlt = 0; iAlt < extents.nAltsG; iAlt++) {
+	if (scalar.index(iLon, iLat, iAlt) !=
+	    iLon * extents.nLatsG * extents.nAltsG + iLat * extents.nAltsG + iAlt)
+	  iErr = 1;
+	if (edges.index(iLon, iLat, iAlt) !=
+	    iLon * extents.nLatsG * (extents.nAltsG + 1) +
+	    iLat * (extents.nAltsG + 1) + iAlt)
+	  iErr = 1;
+	for (iDir = 0; iDir < 3; iDir++)
+	  if (&velocity(iLon, iLat, iAlt, iDir) !=
+	      &vector[scalar.index(iLon, iLat, iAlt) * 3 + iDir])
+	    iErr = 1;
+      }
+
+  for (tile_struct tile : scalar.tiles(2, 3, 0))
+    for (column_struct column : scalar.columns(tile)) {
+      nVisits[column.iLon * extents.nLatsG + column.iLat]++;
+      nColumns++;
+    }
+
+  if (nColumns != extents.nLons * extents.nLats) iErr = 1;
+  for (iLon = extents.iLonStart_; iLon <= extents.iLonEnd_; iLon++)
+    for (iLat = extents.iLatStart_; iLat <= extents.iLatEnd_; iLat++)
+      if (nVisits[iLon * extents.nLatsG + iLat] != 1) iErr = 1;
+
+  grid_extents one_lon(1, 4, 3, 2), one_lat(5, 1, 3, 2);
+  if (extents.iLonStop() != extents.iLonEnd_ ||
+      extents.iLatStop() != extents.iLatEnd_ ||
+      one_lon.iLonStop() != one_lon.iLonStart_ + 1 ||
+      one_lon.iLatStop() != one_lon.iLatEnd_ ||
+      one_lat.iLonStop() != one_lat.iLonEnd_ ||
+      one_lat.iLatStop() != one_lat.iLatStart_ + 1) {
+    std::cout << "test_field3d : wrong iLonStop or iLatStop!\n";
+    iErr = 1;
+  }
+
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// Make sure that the workers' tiles cover every column (including the
+// ghost cells) exactly once, that each thread only gets its own tile,
+// and that the first touch zeroes the whole field.
+// -----------------------------------------------------------------------------
+
+int test_workers() {
+
+  int iErr = 0;
+  long iColumn;
+  Report report;
+
+  grid_extents extents(5, 4, 3, 2);
+  std::vector<int> threads_to_try = {1, 4, 7, 64};
+
+  for (int nThreads : threads_to_try) {
+
+    Workers workers(nThreads, extents, report);
+    std::vector<int> nVisits(extents.nColumnsG, 0);
+
+    workers.run([&](const tile_struct &tile, int iThread) {
+      tile_struct own = workers.get_tile(iThread);
+      if (own.iLonStart != tile.iLonStart || own.iLatStart != tile.iLatStart)
+	nVisits[0] = -1000;
+      for (long iLon = tile.iLonStart; iLon < tile.iLonEnd; iLon++)
+	for (long iLat = tile.iLatStart; iLat < tile.iLatEnd; iLat++)
+	  nVisits[iLon * extents.nLatsG + iLat]++;
+    });
+
+    for (iColumn = 0; iColumn < extents.nColumnsG; iColumn++)
+      if (nVisits[iColumn] != 1) iErr = 1;
+
+    // With costs (10 times more in the first lons, like the dayside),
+    // every column still gets done once, and no thread gets more than
+    // its share plus one lon:
+    std::vector<float> costs(extents.nColumnsG, 1.0);
+    for (iColumn = 0; iColumn < 4 * extents.nLatsG; iColumn++)
+      costs[iColumn] = 10.0;
+    std::vector<float> thread_costs(nThreads, 0.0);
+    float total_cost = 0.0, lon_cost = 10.0 * extents.nLatsG;
+    for (iColumn = 0; iColumn < extents.nColumnsG; iColumn++) {
+      total_cost += costs[iColumn];
+      nVisits[iColumn] = 0;
+    }
+
+    workers.run([&](const tile_struct &tile, int iThread) {
+      for (long iLon = tile.iLonStart; iLon < tile.iLonEnd; iLon++)
+	for (long iLat = tile.iLatStart; iLat < tile.iLatEnd; iLat++) {
+	  nVisits[iLon * extents.nLatsG + iLat]++;
+	  thread_costs[iThread] += costs[iLon * extents.nLatsG + iLat];
+	}
+    }, costs);
+
+    for (iColumn = 0; iColumn < extents.nColumnsG; iColumn++)
+      if (nVisits[iColumn] != 1) iErr = 1;
+    for (int iThread = 0; iThread < nThreads; iThread++)
+      if (thread_costs[iThread] > total_cost / nThreads + lon_cost) iErr = 1;
+
+    std::vector<float> field(extents.nPointsG * 3, 1.0);
+    workers.first_touch(field.data(), extents.nPointsG, 3);
+    for (unsigned long i = 0; i < field.size(); i++)
+      if (field[i] != 0.0) iErr = 1;
+
+  }
+
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// Give every column of the whole grid its own value, and make sure
+// that the halo exchange fills in the halo of each block, but not the
+// corners, and that it doesn't wrap around in longitude (the ghost
+// cells past the ends of the whole grid are left alone).  Then the
+// gather has to put the whole grid back together.  This only does
+// something interesting with mpirun -np N ./test.exe
+// -----------------------------------------------------------------------------
+
+int test_parallel(Parallel &parallel) {
+
+  int iErr = 0;
+  long iLon, iLat, iAlt;
+  Report report;
+
+  Inputs::grid_input_struct grid_input;
+  grid_input.nLons = 6;
+  grid_input.nLats = 8;
+  grid_input.nAlts = 3;
+
+  grid_extents extents = parallel.decompose(grid_input, 2, report, iErr);
+  if (iErr > 0) return iErr;
+
+  auto column_value = [&](long iLonGlobal, long iLatGlobal) {
+    return float(iLonGlobal * 100 + iLatGlobal);
+  };
+
+  // The halo fields can have a stride, so check that too:
+  long stride = 2;
+  std::vector<float> field(extents.nPointsG * stride, -1.0);
+  std::vector<float> one_field(extents.nPointsG, -1.0);
+  Field3D<float> view(one_field.data(), extents);
+
+  // The columns a block fills in itself: its own, and the ghost cells
+  // of the whole grid along its edges:
+  auto is_mine = [&](long iLon, long iLat) {
+    long iLonGlobal = iLon + extents.iLonOffset;
+    long iLatGlobal = iLat + extents.iLatOffset;
+    int IsMine =
+      (iLon >= extents.iLonStart_ && iLon <= extents.iLonEnd_) ||
+      iLonGlobal < extents.nGCs ||
+      iLonGlobal >= extents.nLonsGlobal + extents.nGCs;
+    return IsMine &&
+      ((iLat >= extents.iLatStart_ && iLat <= extents.iLatEnd_) ||
+       iLatGlobal < extents.nGCs ||
+       iLatGlobal >= extents.nLatsGlobal + extents.nGCs);
+  };
+
+  for (iLon = 0; iLon < extents.nLonsG; iLon++) {
+    for (iLat = 0; iLat < extents.nLatsG; iLat++) {
+      long iLonGlobal = iLon + extents.iLonOffset;
+      long iLatGlobal = iLat + extents.iLatOffset;
+      if (is_mine(iLon, iLat))
+	for (iAlt = 0; iAlt < extents.nAltsG; iAlt++) {
+	  one_field[view.index(iLon, iLat, iAlt)] =
+	    column_value(iLonGlobal, iLatGlobal);
+	  field[view.index(iLon, iLat, iAlt) * stride + 1] =
+	    column_value(iLonGlobal, iLatGlobal);
+	}
+    }
+  }
+
+  parallel.add_halo_field(Parallel::temperature_halo, field.data() + 1, stride);
+  parallel.start_halo_exchange(Parallel::temperature_halo, report);
+  parallel.finish_halo_exchange(Parallel::temperature_halo, report);
+
+  for (iLon = 0; iLon < extents.nLonsG; iLon++) {
+    for (iLat = 0; iLat < extents.nLatsG; iLat++) {
+      int IsCorner =
+	(iLon < extents.iLonStart_ || iLon > extents.iLonEnd_) &&
+	(iLat < extents.iLatStart_ || iLat > extents.iLatEnd_);
+      // A corner that the block doesn't fill in itself stays as it was,
+      // and everything else (including the ghost cells at the ends of
+      // the whole grid, if it wrapped around) is the column's own value:
+      float value = column_value(iLon + extents.iLonOffset,
+				 iLat + extents.iLatOffset);
+      if (IsCorner && !is_mine(iLon, iLat)) value = -1.0;
+      for (iAlt = 0; iAlt < extents.nAltsG; iAlt++)
+	if (field[view.index(iLon, iLat, iAlt) * stride + 1] != value)
+	  iErr = 1;
+    }
+  }
+
+  std::vector<float> global_s3gc;
+  float *whole = parallel.gather_s3gc(one_field.data(), extents, global_s3gc);
+  if (parallel.is_root()) {
+    grid_extents global = parallel.get_global_extents();
+    if (parallel.get_nRanks() == 1) global = extents;
+    Field3D<float> whole_view(whole, global);
+    for (iLon = 0; iLon < global.nLonsG; iLon++)
+      for (iLat = 0; iLat < global.nLatsG; iLat++)
+	for (iAlt = 0; iAlt < global.nAltsG; iAlt++)
+	  if (whole_view(iLon, iLat, iAlt) != column_value(iLon, iLat))
+	    iErr = 1;
+  }
+
+  if (parallel.sum(1.0) != parallel.get_nRanks()) iErr = 1;
+  if (parallel.max(parallel.get_iRank()) != parallel.get_nRanks() - 1) iErr = 1;
+  if (parallel.min(parallel.get_iRank()) != 0) iErr = 1;
+
+  return int(parallel.max(iErr));
+
+}
+
+// -----------------------------------------------------------------------------
+// Check fast_log, fast_exp and fast_pow against <cmath>, using the
+// error bounds in fast_math.h
+// -----------------------------------------------------------------------------
+
+int test_fast_math() {
+
+  int iErr = 0;
+  double x, p, error;
+
+  // From very small to very big:
+  for (x = 1.0e-300; x < 1.0e300; x = x * 1.37) {
+    if (fabs(fast_log(x) - log(x)) > 2.0e-14 * (1.0 + fabs(log(x)))) iErr = 1;
+    error = fast_exp(log(x)) / exp(log(x)) - 1.0;
+    if (fabs(error) > 1.0e-13) iErr = 1;
+  }
+
+  // Temperatures and thermal_exps (see Neutrals::calc_thermodynamics):
+  for (x = 1.0; x < 1.0e5; x = x * 1.0123) {
+    for (p = -2.0; p <= 2.0; p = p + 0.01) {
+      error = fast_pow(x, p) / pow(x, p) - 1.0;
+      if (fabs(error) > 1.0e-13 * (1.0 + fabs(p * log(x)))) {
+	if (iErr == 0)
+	  std::cout << "fast_pow(" << x << ", " << p << ") is off by "
+		    << error << "\n";
+	iErr = 1;
+      }
+    }
+  }
+
+  // The float one, over all of the floats it works for:
+  for (float xf = -87.0f; xf < 87.0f; xf = xf + 0.0013f) {
+    error = fast_expf(xf) / exp(double(xf)) - 1.0;
+    if (fabs(error) > 3.0e-7) iErr = 1;
+  }
+
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// The binary search for the tangent points has to find the same
+// altitudes as walking down the column, on a stretched grid and at all
+// nightside SZAs
+// -----------------------------------------------------------------------------
+
+int test_tangent_points() {
+
+  int iErr = 0;
+  long nGCs = 2, nAlts = 60, iAlt, iiAlt, iBelowWalk;
+  std::vector<float> radius(nAlts);
+  std::vector<long> iBelow(nAlts);
+  std::vector<double> dy(nAlts);
+  double y;
+
+  for (iAlt = 0; iAlt < nAlts; iAlt++)
+    radius[iAlt] = 6372.0e3 + 100.0e3 + 1.0e3 * iAlt + 50.0 * iAlt * iAlt;
+
+  for (float sza = pi/2; sza < 3*pi/2; sza = sza + 0.001) {
+
+    calc_tangent_points(radius.data(), sza, nGCs, nAlts,
+			iBelow.data(), dy.data());
+
+    for (iAlt = nGCs; iAlt < nAlts; iAlt++) {
+      y = radius[iAlt] * fabs(cos(sza - pi/2));
+      iBelowWalk = -1;
+      if (y > radius[nGCs]) {
+	iiAlt = iAlt;
+	while (radius[iiAlt-1] > y) iiAlt--;
+	iBelowWalk = iiAlt - 1;
+      }
+      if (iBelow[iAlt] != iBelowWalk) iErr = 1;
+      if (iBelowWalk >= 0 && dy[iAlt] != y - radius[iBelowWalk]) iErr = 1;
+    }
+
+  }
+
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// The chapman table (#chapman table) against chapman_dayside, over the
+// X and sza of a thermosphere.  Away from the seam in the fit (y = 8),
+// it should be a lot better than max_relative_error:
+// -----------------------------------------------------------------------------
+
+int test_chapman_table() {
+
+  int iErr = 0;
+  ChapmanTable table;
+  long iMu;
+  double weight, y, exact, error;
+
+  table.build();
+  if (table.max_relative_error() > 3.0e-3) iErr = 1;
+
+  for (double xp = 10.0; xp < 5000.0; xp = xp * 1.0137) {
+    for (double mu = 0.001; mu < 1.0; mu = mu * 1.071) {
+      if (!table.find_mu(mu, iMu, weight) || !table.covers(xp)) iErr = 1;
+      exact = chapman_dayside(xp, mu);
+      error = fabs(table.lookup(xp, iMu, weight) / exact - 1.0);
+      y = sqrt(0.5 * xp) * mu;
+      if (error > 3.0e-3 || (fabs(y - 8.0) > 0.5 && error > 1.0e-4))
+	iErr = 1;
+    }
+  }
+
+  // Right at the terminator isn't in the table:
+  if (table.find_mu(cos(pi/2 - 1.0e-5), iMu, weight)) iErr = 1;
+  if (table.covers(0.5) || table.covers(1.0e5)) iErr = 1;
+
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// The batched conduction solver against solver_conduction, one column
+// at a time.  The columns are all different (and there are two
+// altitude spacings), so a lane that reads or writes another lane's
+// column shows up.  Every altitude from 1 to nAlts-3 has to get its
+// own dT/dt.
+// -----------------------------------------------------------------------------
+
+int test_solver_conduction_batch() {
+
+  int iErr = 0;
+  const int nLanes = nConductionLanes;
+  long nAlts = 50 + 2 * nGeoGhosts, iAlt, index;
+  int iLane, iProfile;
+  float dt = 5.0, largest;
+
+  std::vector<float> temperature(nLanes * nAlts), kappa(nLanes * nAlts);
+  std::vector<float> rho_cv(nLanes * nAlts), conduction(nLanes * nAlts, -1.0);
+  std::vector<float> radius_sq(nAlts, 4.1e13), dalt_lower(2 * nAlts);
+  std::vector<float> r(2 * nAlts), du12(2 * nAlts), du22(2 * nAlts);
+  std::vector<float> temp(nAlts), lambda(nAlts), rhocv(nAlts), column(nAlts);
+  std::vector<float> work(2 * nLanes * nAlts);
+  conduction_batch_struct<nLanes> batch;
+
+  for (iAlt = 0; iAlt < nAlts; iAlt++) {
+    dalt_lower[iAlt] = 2500.0;
+    dalt_lower[nAlts + iAlt] = 1000.0 + 50.0 * iAlt;
+  }
+  for (iProfile = 0; iProfile < 2; iProfile++)
+    conduction_metrics(dalt_lower.data() + iProfile * nAlts,
+		       r.data() + iProfile * nAlts,
+		       du12.data() + iProfile * nAlts,
+		       du22.data() + iProfile * nAlts, nAlts);
+
+  for (iLane = 0; iLane < nLanes; iLane++) {
+    for (iAlt = 0; iAlt < nAlts; iAlt++) {
+      index = iLane * nAlts + iAlt;
+      temperature[index] = 1000.0 - (700.0 + 20.0 * iLane) * exp(-iAlt / 15.0);
+      kappa[index] = 5.6e-4 * pow(temperature[index], 0.69);
+      rho_cv[index] = 1.0e-9 * exp(-iAlt / (8.0 + iLane));
+    }
+    iProfile = iLane % 2;
+    batch.temperature[iLane] = temperature.data() + iLane * nAlts;
+    batch.kappa[iLane] = kappa.data() + iLane * nAlts;
+    batch.rho_cv[iLane] = rho_cv.data() + iLane * nAlts;
+    batch.conduction[iLane] = conduction.data() + iLane * nAlts;
+    batch.radius_sq[iLane] = radius_sq.data();
+    batch.r[iLane] = r.data() + iProfile * nAlts;
+    batch.du12[iLane] = du12.data() + iProfile * nAlts;
+    batch.du22[iLane] = du22.data() + iProfile * nAlts;
+  }
+
+  solver_conduction_batch(batch, dt, nAlts, work.data());
+
+  for (iLane = 0; iLane < nLanes; iLane++) {
+    iProfile = iLane % 2;
+    for (iAlt = 0; iAlt < nAlts; iAlt++) {
+      index = iLane * nAlts + iAlt;
+      temp[iAlt] = temperature[index];
+      lambda[iAlt] = kappa[index] * radius_sq[iAlt];
+      rhocv[iAlt] = rho_cv[index] * radius_sq[iAlt];
+      column[iAlt] = 0.0;
+    }
+    solver_conduction(temp.data(), lambda.data(), rhocv.data(), dt,
+		      r.data() + iProfile * nAlts,
+		      du12.data() + iProfile * nAlts,
+		      du22.data() + iProfile * nAlts,
+		      column.data(), nAlts);
+    largest = 0.0;
+    for (iAlt = 0; iAlt < nAlts; iAlt++)
+      largest = std::max(largest, fabsf(column[iAlt] / dt));
+    if (largest < 1.0) iErr = 1;
+    for (iAlt = 0; iAlt < nAlts; iAlt++)
+      if (fabs(conduction[iLane * nAlts + iAlt] - column[iAlt] / dt) >
+	  1.0e-3 * largest) iErr = 1;
+  }
+
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// Write a little spectrum file (3 wavelengths, 4 records, an hour
+// apart), and make sure that the records are found and weighted
+// right, that it is held outside of the file, and that a file with
+// the wrong number of wavelengths is not taken.
+// -----------------------------------------------------------------------------
+
+int test_spectrum_file() {
+
+  int iErr = 0;
+  Report report;
+  long iRecord;
+  float weight;
+  const int64_t nWaves = 3, nRecords = 4;
+  double start = 1.0e9;
+
+  // Every process (with mpirun) gets its own file:
+  std::string file = "test_spectrum_" + std::to_string(getpid()) + ".bin";
+  std::ofstream out(file, std::ios::binary);
+  out.write("AETHSPEC", 8);
+  out.write(reinterpret_cast<const char *>(&nWaves), sizeof(nWaves));
+  out.write(reinterpret_cast<const char *>(&nRecords), sizeof(nRecords));
+  for (int64_t iR = 0; iR < nRecords; iR++) {
+    double time = start + 3600.0 * iR;
+    out.write(reinterpret_cast<const char *>(&time), sizeof(time));
+    for (int64_t iW = 0; iW < nWaves; iW++) {
+      float value = 10.0 * iR + iW;
+      out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+  }
+  out.close();
+
+  SpectrumFile wrong;
+  if (wrong.open(file, nWaves + 1, report) == 0) iErr = 1;
+
+  SpectrumFile spectra;
+  if (spectra.open(file, nWaves, report) > 0 ||
+      spectra.get_nRecords() != nRecords) {
+    std::remove(file.c_str());
+    return 1;
+  }
+
+  // Going forward, jumping ahead, then going back:
+  std::vector<double> times = {start - 100.0, start, start + 900.0,
+			       start + 3600.0 * 2.5, start + 3600.0 * 1.25,
+			       start + 3600.0 * 3, start + 1.0e6};
+  std::vector<long> records = {0, 0, 0, 2, 1, 3, 3};
+  std::vector<float> weights = {0.0, 0.0, 0.25, 0.5, 0.25, 0.0, 0.0};
+  for (unsigned long iTime = 0; iTime < times.size(); iTime++) {
+    spectra.find(times[iTime], iRecord, weight);
+    if (iRecord != records[iTime] || fabs(weight - weights[iTime]) > 1e-6)
+      iErr = 1;
+  }
+  if (spectra.intensity(2)[1] != 21.0) iErr = 1;
+
+  spectra.close();
+  std::remove(file.c_str());
+
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// The big pieces of the model are passed around by reference, and
+// they can't be copied, so a step can't make a deep copy by mistake:
+// -----------------------------------------------------------------------------
+
+static_assert(!std::is_copy_constructible<Inputs>::value, "Inputs copy");
+static_assert(!std::is_copy_constructible<Times>::value, "Times copy");
+static_assert(!std::is_copy_constructible<Planets>::value, "Planets copy");
+static_assert(!std::is_copy_constructible<Indices>::value, "Indices copy");
+static_assert(!std::is_copy_constructible<Euv>::value, "Euv copy");
+static_assert(!std::is_copy_constructible<Grid>::value, "Grid copy");
+static_assert(!std::is_copy_constructible<Neutrals>::value, "Neutrals copy");
+static_assert(!std::is_copy_constructible<Ions>::value, "Ions copy");
+static_assert(!std::is_copy_constructible<Chemistry>::value, "Chemistry copy");
+static_assert(!std::is_copy_constructible<Report>::value, "Report copy");
+
+// -----------------------------------------------------------------------------
+// The adaptive time step has to land right on each output, however the
+// limit jumps around, and stay in its bounds the rest of the time.
+// -----------------------------------------------------------------------------
+
+int test_calc_dt() {
+
+  int iErr = 0;
+  Times time;
+  time.set_times({2011, 6, 21, 12, 0, 0, 0});
+  time.set_end_time({2011, 6, 21, 12, 10, 0, 0});
+  time.increment_intermediate(600.0);
+  time.set_dt_bounds(2.0, 60.0);
+  time.add_time_gate(45.0);
+  time.add_time_gate(300.0);
+
+  const double dt_gate = 45.0;
+  double start = time.get_current(), simulation;
+  long nGates = 0, iStep = 0;
+
+  while (time.get_current() < time.get_end() && iStep < 1000) {
+    // a limit that tightens and loosens:
+    time.calc_dt(1.0 + 40.0 * (iStep % 7));
+    if (time.get_dt() > 60.0 + 1.0e-4) {
+      std::cout << "test_calc_dt : dt " << time.get_dt() << " is too long!\n";
+      iErr = 1;
+    }
+    time.increment_time();
+    simulation = time.get_current() - start;
+    if (time.check_time_gate(dt_gate)) {
+      nGates++;
+      if (std::fabs(simulation - nGates * dt_gate) > 1.0e-6) {
+	std::cout << "test_calc_dt : gate at " << simulation
+		  << " s instead of " << nGates * dt_gate << " s!\n";
+	iErr = 1;
+      }
+    }
+    iStep++;
+  }
+
+  if (time.get_current() != time.get_end() || nGates != 13) {
+    std::cout << "test_calc_dt : ended " << time.get_end() - time.get_current()
+	      << " s early, with " << nGates << " gates!\n";
+    iErr = 1;
+  }
+
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// The chemistry solver is explicit where the sources are bigger than
+// the losses (however long the step is, since the density can only
+// grow), and implicit (and positive) where they aren't.
+// -----------------------------------------------------------------------------
+
+int test_solver_chemistry() {
+
+  int iErr = 0;
+  float old_density = 1.0e10, dt = 60.0;
+
+  // Sources bigger than the losses, with the losses over the step more
+  // than the density:
+  float source = 3.0e9, loss = 2.0e9;
+  float density = solver_chemistry(old_density, source, loss, dt);
+  if (density != old_density + dt * (source - loss)) {
+    std::cout << "test_solver_chemistry : explicit step gave "
+	      << density << "!\n";
+    iErr = 1;
+  }
+
+  // Losses bigger than the sources:
+  source = 1.0e8;
+  loss = 5.0e9;
+  density = solver_chemistry(old_density, source, loss, dt);
+  float implicit = (old_density + dt * source) /
+    (1.0 + dt * loss / (old_density + 1e-6));
+  if (std::fabs(density / implicit - 1.0) > 1.0e-6 || density <= 0.0) {
+    std::cout << "test_solver_chemistry : implicit step gave "
+	      << density << "!\n";
+    iErr = 1;
+  }
+
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// Merge a tiny spectrum (three pairs of wavelengths that are almost
+// the same) in an exponential atmosphere.  Into three bins, each pair
+// should end up in a bin.  With a tight max_error, it should stop
+// before going over it.  The bins are always next to each other.
+// -----------------------------------------------------------------------------
+
+int test_merge_euv_waves() {
+
+  int iErr = 0;
+  long iW, iZ;
+
+  euv_merge_struct merge;
+  merge.nWaves = 6;
+  merge.nAbsorbers = 1;
+  merge.nRates = 2;
+  merge.nZ = 40;
+
+  std::vector<double> sigma = {1.0e-22, 1.05e-22, 2.0e-21,
+			       2.1e-21, 1.0e-20, 1.05e-20};
+  for (iW = 0; iW < merge.nWaves; iW++) {
+    merge.intensity.push_back(1.0e13);
+    merge.sigma.push_back(sigma[iW]);
+    // heating, then ionization:
+    merge.rates.push_back(sigma[iW] * 3.0e-18);
+    merge.rates.push_back(sigma[iW] * 0.8);
+  }
+  merge.column.resize(merge.nZ);
+  merge.density_rate.resize(merge.nRates * merge.nZ);
+  for (iZ = 0; iZ < merge.nZ; iZ++) {
+    double density = 1.0e18 * exp(-iZ / 4.0);
+    merge.column[iZ] = density * 2.0e4;
+    merge.density_rate[iZ] = density;
+    merge.density_rate[merge.nZ + iZ] = density;
+  }
+
+  auto check_bins = [&](long nBins, float max_error) {
+    long iWave = 0;
+    for (std::vector<long> &bin : merge.bins)
+      for (long iWaveInBin : bin)
+	if (iWaveInBin != iWave++) iErr = 1;
+    if (iWave != merge.nWaves ||
+	(nBins > 0 && long(merge.bins.size()) != nBins) ||
+	merge.heating_error > max_error ||
+	merge.ionization_error > max_error) {
+      std::cout << "test_merge_euv_waves : " << merge.bins.size()
+		<< " bins, errors " << merge.heating_error << " and "
+		<< merge.ionization_error << "!\n";
+      iErr = 1;
+    }
+  };
+
+  merge_euv_waves(merge, 3, 0.05);
+  check_bins(3, 0.05);
+  if (merge.bins[0].size() != 2 || merge.bins[1].size() != 2) iErr = 1;
+
+  merge_euv_waves(merge, 1, 1.0e-3);
+  check_bins(-1, 1.0e-3);
+  if (merge.bins.size() < 3) iErr = 1;
+
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// A process with a cadence runs once every cadence, however long the
+// steps are, and an integrator covers all of the time, even when it
+// doesn't run every step.
+// -----------------------------------------------------------------------------
+
+int test_scheduler() {
+
+  int iErr = 0;
+  Times time;
+  time.set_times({2011, 6, 21, 12, 0, 0, 0});
+  time.set_end_time({2011, 6, 21, 12, 10, 0, 0});
+  time.increment_intermediate(600.0);
+  time.set_dt_bounds(2.0, 60.0);
+
+  Report report;
+  Scheduler scheduler;
+  scheduler.set_process(Scheduler::sza_process, 60.0, 1);
+  scheduler.set_process(Scheduler::chemistry_process, 25.0, 8);
+
+  long nSza = 0, iStep = 0;
+  double dt_chemistry = 0.0;
+
+  while (time.get_current() < time.get_end() && iStep < 1000) {
+    time.calc_dt(3.0 + 4.0 * (iStep % 5));
+    if (scheduler.is_due(Scheduler::sza_process, time)) nSza++;
+    if (scheduler.is_due(Scheduler::chemistry_process, time)) {
+      scheduler.start(Scheduler::chemistry_process, report);
+      dt_chemistry += scheduler.get_dt(Scheduler::chemistry_process, time);
+      scheduler.stop(Scheduler::chemistry_process, time, 1, report);
+    }
+    time.increment_time();
+    iStep++;
+  }
+
+  if (nSza != 10 || std::fabs(dt_chemistry - 600.0) > 1.0e-3) {
+    std::cout << "test_scheduler : sza ran " << nSza
+	      << " times and the chemistry covered " << dt_chemistry << " s!\n";
+    iErr = 1;
+  }
+
+  if (scheduler.get_nSubcycles(Scheduler::chemistry_process, 25.0, 10.0) != 3 ||
+      scheduler.get_nSubcycles(Scheduler::chemistry_process, 25.0, 1.0) != 8 ||
+      scheduler.get_nSubcycles(Scheduler::sza_process, 25.0, 1.0) != 1) {
+    std::cout << "test_scheduler : wrong number of sub-steps!\n";
+    iErr = 1;
+  }
+
+  return iErr;
+
+}
+
+// -----------------------------------------------------------------------------
+// Once they have been used once, running a kernel on the threads and
+// timing a function shouldn't allocate anything.  This only checks
+// something when built with make test CHECK_ALLOCATIONS=1
+// -----------------------------------------------------------------------------
+
+int test_allocations() {
+
+  int iErr = 0;
+  Report report;
+  grid_extents extents(8, 6, 10, 2);
+  Workers workers(4, extents, report);
+  std::vector<float> field(extents.nPointsG);
+  static std::string function = "test_allocations";
+  static int iFunction = -1;
+
+  for (int iPass = 0; iPass < 2; iPass++) {
+
+    long nAllocations = get_nAllocations();
+
+    report.enter(function, iFunction);
+    workers.run([&](const tile_struct &tile, int iThread) {
+      for (long iLon = tile.iLonStart; iLon < tile.iLonEnd; iLon++)
+	for (long iLat = tile.iLatStart; iLat < tile.iLatEnd; iLat++)
+	  field[(iLon * extents.nLatsG + iLat) * extents.nAltsG] = iThread;
+    });
+    report.exit(function);
+
+    nAllocations = get_nAllocations() - nAllocations;
+    if (iPass > 0 && nAllocations > 0) {
+      std::cout << "test_allocations : " << nAllocations
+		<< " heap allocations!\n";
+      iErr = 1;
+    }
+
+  }
+
+  return iErr;
+
+}
 
 int main() {
 
@@ -16,6 +797,126 @@ int main() {
   iErr = test_time_routines();
   if (iErr == 0) std::cout << "Passed test_time_routines!\n";
   else std::cout << "Failed test_time_routines!\n";
+
+  // ------------------------------------------------------------
+  // Test the index math of the 3D field views:
+  // ------------------------------------------------------------
+
+  int iErrField = test_field3d();
+  if (iErrField == 0) std::cout << "Passed test_field3d!\n";
+  else std::cout << "Failed test_field3d!\n";
+  iErr = iErr + iErrField;
+
+  // ------------------------------------------------------------
+  // Test the tiles of the worker threads:
+  // ------------------------------------------------------------
+
+  int iErrWorkers = test_workers();
+  if (iErrWorkers == 0) std::cout << "Passed test_workers!\n";
+  else std::cout << "Failed test_workers!\n";
+  iErr = iErr + iErrWorkers;
+
+  // ------------------------------------------------------------
+  // Test the vectorizable pow:
+  // ------------------------------------------------------------
+
+  int iErrFastMath = test_fast_math();
+  if (iErrFastMath == 0) std::cout << "Passed test_fast_math!\n";
+  else std::cout << "Failed test_fast_math!\n";
+  iErr = iErr + iErrFastMath;
+
+  // ------------------------------------------------------------
+  // Test the nightside tangent points:
+  // ------------------------------------------------------------
+
+  int iErrTangent = test_tangent_points();
+  if (iErrTangent == 0) std::cout << "Passed test_tangent_points!\n";
+  else std::cout << "Failed test_tangent_points!\n";
+  iErr = iErr + iErrTangent;
+
+  // ------------------------------------------------------------
+  // Test the dayside chapman table:
+  // ------------------------------------------------------------
+
+  int iErrChapman = test_chapman_table();
+  if (iErrChapman == 0) std::cout << "Passed test_chapman_table!\n";
+  else std::cout << "Failed test_chapman_table!\n";
+  iErr = iErr + iErrChapman;
+
+  // ------------------------------------------------------------
+  // Test the batched conduction solver:
+  // ------------------------------------------------------------
+
+  int iErrConduction = test_solver_conduction_batch();
+  if (iErrConduction == 0) std::cout << "Passed test_solver_conduction_batch!\n";
+  else std::cout << "Failed test_solver_conduction_batch!\n";
+  iErr = iErr + iErrConduction;
+
+  // ------------------------------------------------------------
+  // Test the memory mapped spectrum file:
+  // ------------------------------------------------------------
+
+  int iErrSpectrum = test_spectrum_file();
+  if (iErrSpectrum == 0) std::cout << "Passed test_spectrum_file!\n";
+  else std::cout << "Failed test_spectrum_file!\n";
+  iErr = iErr + iErrSpectrum;
+
+  // ------------------------------------------------------------
+  // Test that the adaptive time step lands on the outputs:
+  // ------------------------------------------------------------
+
+  int iErrDt = test_calc_dt();
+  if (iErrDt == 0) std::cout << "Passed test_calc_dt!\n";
+  else std::cout << "Failed test_calc_dt!\n";
+  iErr = iErr + iErrDt;
+
+  // ------------------------------------------------------------
+  // Test when the chemistry solver is explicit:
+  // ------------------------------------------------------------
+
+  int iErrSolverChemistry = test_solver_chemistry();
+  if (iErrSolverChemistry == 0)
+    std::cout << "Passed test_solver_chemistry!\n";
+  else std::cout << "Failed test_solver_chemistry!\n";
+  iErr = iErr + iErrSolverChemistry;
+
+  // ------------------------------------------------------------
+  // Test merging the EUV wavelengths into bins:
+  // ------------------------------------------------------------
+
+  int iErrMerge = test_merge_euv_waves();
+  if (iErrMerge == 0) std::cout << "Passed test_merge_euv_waves!\n";
+  else std::cout << "Failed test_merge_euv_waves!\n";
+  iErr = iErr + iErrMerge;
+
+  // ------------------------------------------------------------
+  // Test the process scheduler:
+  // ------------------------------------------------------------
+
+  int iErrScheduler = test_scheduler();
+  if (iErrScheduler == 0) std::cout << "Passed test_scheduler!\n";
+  else std::cout << "Failed test_scheduler!\n";
+  iErr = iErr + iErrScheduler;
+
+  // ------------------------------------------------------------
+  // Test that the threads and timers don't allocate:
+  // ------------------------------------------------------------
+
+  int iErrAllocations = test_allocations();
+  if (iErrAllocations == 0) std::cout << "Passed test_allocations!\n";
+  else std::cout << "Failed test_allocations!\n";
+  iErr = iErr + iErrAllocations;
+
+  // ------------------------------------------------------------
+  // Test the halo exchange and gather between processes:
+  // ------------------------------------------------------------
+
+  Report report;
+  Parallel parallel(report);
+  int iErrParallel = test_parallel(parallel);
+  if (iErrParallel == 0) std::cout << "Passed test_parallel!\n";
+  else std::cout << "Failed test_parallel!\n";
+  iErr = iErr + iErrParallel;
   
   return iErr;
   
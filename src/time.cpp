@@ -3,6 +3,7 @@
 
 #include <math.h>
 #include <vector>
+#include <algorithm>
 #include <string>
 #include <iostream>
 #include <time.h>
@@ -20,6 +21,12 @@ Times::Times() {
   iCurrent = {0, 0, 0, 0, 0, 0, 0};
   iStep = -1;
 
+  simulation = 0.0;
+  simulation_next = 0.0;
+  dt = 0.0;
+  dt_min = 5.0;
+  dt_max = 5.0;
+
   year = 0;
   month = 0;
   day = 0;
@@ -36,12 +43,14 @@ Times::Times() {
 // 
 // -----------------------------------------------------------------------------
 
-void Times::set_times(std::vector<int> itime) {
+void Times::set_times(const std::vector<int> &itime) {
 
   start = time_int_to_real(itime);
   current = start;
   iStep = -1;
   dt = 0;
+  simulation = 0.0;
+  simulation_next = 0.0;
   // This will initiate more variables:
   increment_time();
   
@@ -55,7 +64,7 @@ void Times::set_times(std::vector<int> itime) {
 // current time is the start time.
 // -----------------------------------------------------------------------------
 
-int Times::check_time_gate(float dt_check) {
+int Times::check_time_gate(float dt_check) const {
   int DoThing = 0;
   if (current == start) DoThing = 1;
   if ( floor((simulation - dt) / dt_check) <
@@ -64,11 +73,61 @@ int Times::check_time_gate(float dt_check) {
 }
 
 // -----------------------------------------------------------------------------
-// Need to actually calculate dt here....
+//
 // -----------------------------------------------------------------------------
 
-void Times::calc_dt() {
-  dt = 5.0;
+void Times::set_dt_bounds(float dt_min_in, float dt_max_in) {
+  dt_min = dt_min_in;
+  dt_max = dt_max_in;
+}
+
+void Times::add_time_gate(double dt_gate) {
+  if (dt_gate > 0.0) time_gates.push_back(dt_gate);
+}
+
+// -----------------------------------------------------------------------------
+// Pick the time step.  dt_limit is the largest step that all of the
+// processes can take (see advance).  The step is cut right down to
+// the limit, but it only grows by max_growth each step, so a limit
+// that jumps around doesn't make dt jump around too.  It starts at
+// dt_min.  It stays between
+// dt_min and dt_max, except that it is shortened to land right on the
+// next time gate, the intermediate time or the end.  If one of those
+// is less than two steps away, the time left is split in two, so
+// there isn't a sliver of a step right before it.
+// -----------------------------------------------------------------------------
+
+void Times::calc_dt(float dt_limit) {
+
+  const double max_growth = 1.25;
+
+  // The first step doesn't know what the chemistry will do, so it
+  // starts small:
+  double dt_new = std::min(double(dt_limit), dt_max);
+  if (dt > 0.0) dt_new = std::min(dt_new, max_growth * dt);
+  else dt_new = dt_min;
+  dt_new = std::max(dt_new, dt_min);
+
+  // The next place to land, as a simulation time:
+  double target = std::min(intermediate, end) - start, next;
+  for (double dt_gate : time_gates) {
+    next = (floor(simulation / dt_gate) + 1.0) * dt_gate;
+    // (if simulation / dt_gate rounded down, this is the gate we are on)
+    if (next - simulation < 1.0e-6 * dt_gate) next = next + dt_gate;
+    target = std::min(target, next);
+  }
+
+  double remaining = target - simulation;
+  if (remaining <= dt_new) {
+    // (this is exact, so the gate is crossed)
+    simulation_next = target;
+  } else {
+    if (remaining < 2.0 * dt_new) dt_new = remaining / 2.0;
+    simulation_next = simulation + dt_new;
+  }
+
+  dt = simulation_next - simulation;
+
   return;
 }
 
@@ -76,7 +135,7 @@ void Times::calc_dt() {
 // 
 // -----------------------------------------------------------------------------
 
-double Times::get_current() {
+double Times::get_current() const {
   return current;
 }
 
@@ -84,7 +143,7 @@ double Times::get_current() {
 // 
 // -----------------------------------------------------------------------------
 
-double Times::get_end() {
+double Times::get_end() const {
   return end;
 }
 
@@ -92,7 +151,7 @@ double Times::get_end() {
 // 
 // -----------------------------------------------------------------------------
 
-std::string Times::get_YMD_HMS() {
+std::string Times::get_YMD_HMS() const {
   return sYMD_HMS;
 }
 
@@ -100,7 +159,7 @@ std::string Times::get_YMD_HMS() {
 // 
 // -----------------------------------------------------------------------------
 
-double Times::get_intermediate() {
+double Times::get_intermediate() const {
   return intermediate;
 }
 
@@ -108,7 +167,7 @@ double Times::get_intermediate() {
 // 
 // -----------------------------------------------------------------------------
 
-float Times::get_dt() {
+float Times::get_dt() const {
   return dt;
 }
 
@@ -116,7 +175,7 @@ float Times::get_dt() {
 // 
 // -----------------------------------------------------------------------------
 
-float Times::get_orbittime() {
+float Times::get_orbittime() const {
   return orbittime;
 }
 
@@ -125,7 +184,7 @@ float Times::get_orbittime() {
 // 
 // -----------------------------------------------------------------------------
 
-double Times::get_julian_day() {
+double Times::get_julian_day() const {
   return julian_day;
 }
 
@@ -134,7 +193,7 @@ double Times::get_julian_day() {
 // 
 // -----------------------------------------------------------------------------
 
-void Times::set_end_time(std::vector<int> itime) {
+void Times::set_end_time(const std::vector<int> &itime) {
   end = time_int_to_real(itime);
 }
 
@@ -145,14 +204,14 @@ void Times::set_end_time(std::vector<int> itime) {
 
 void Times::increment_time() {
 
-  // Increment simulation time:
-  simulation += dt;
+  // Increment simulation time (to where calc_dt said the step goes):
+  simulation = simulation_next;
 
   // Increment iStep (iteration number):
   iStep++;
 
   // Increment current time:
-  current += dt;
+  current = start + simulation;
 
   // Convert current time to array:
   time_real_to_int(current, iCurrent);
@@ -8,7 +8,7 @@
 // display time as a 7-element array
 // -----------------------------------------------------------------------------
 
-void display_itime(std::vector<int> itime) {
+void display_itime(const std::vector<int> &itime) {
 
   for (int i=0; i<itime.size(); i++) std::cout << itime[i] << " ";
   std::cout << "\n";
@@ -40,7 +40,7 @@ int day_of_year(int year, int month, int day) {
 //                   to seconds since reference date
 // -----------------------------------------------------------------------------
 
-double time_int_to_real(std::vector<int> itime) {
+double time_int_to_real(const std::vector<int> &itime) {
 
   int nYears = itime[0] - reference_year;
   int nLeaps = nYears/4;
@@ -109,7 +109,7 @@ void time_real_to_int(double timereal, std::vector<int> &itime) {
   int nMonths = 1;
   int iLeap = 0;
   if (itime[0] % 4 == 0) iLeap=1;
-  std::vector<int> add_on_days {0,iLeap,0,0,0,0,0,0,0,0,0,0};
+  int add_on_days[12] = {0,iLeap,0,0,0,0,0,0,0,0,0,0};
   while (nDays > (days_of_month[nMonths-1]+add_on_days[nMonths-1])) {
     nDays = nDays - (days_of_month[nMonths-1]+add_on_days[nMonths-1]);
     nMonths++;
@@ -127,7 +127,7 @@ void time_real_to_int(double timereal, std::vector<int> &itime) {
 // Convert from integer time to actual Julian Day
 // -----------------------------------------------------------------------------
 
-double time_int_to_jday(std::vector<int> itime) {
+double time_int_to_jday(const std::vector<int> &itime) {
 
   // For this, we are going to use a relationship between our
   // time reference system and the Julian Day reference system.
@@ -117,39 +117,51 @@ void vector_diff(float vect_in_1[3],
 
 void get_vector_component(float *vector_in_v3gc,
 			  int iComponent,
-			  int IsGeoGrid,
+			  grid_extents extents,
 			  float *component_out_s3gc) {
 
-  long nLons, nLats, nAlts, iLon, iLat, iAlt, index, indexv;
+  long iLon, iLat, iAlt;
 
-  if (IsGeoGrid) {
-    nLons = nGeoLonsG;
-    nLats = nGeoLatsG;
-    nAlts = nGeoAltsG;
-  } else {
-    nLons = nMagLonsG;
-    nLats = nMagLatsG;
-    nAlts = nMagAltsG;
-  }
+  long nLons = extents.nLonsG;
+  long nLats = extents.nLatsG;
+  long nAlts = extents.nAltsG;
+
+  Field3D<float, 3> vector_in(vector_in_v3gc, extents);
+  Field3D<float> component_out(component_out_s3gc, extents);
 
   for (iLon = 0; iLon < nLons; iLon++) {
     for (iLat = 0; iLat < nLats; iLat++) {
-      for (iAlt = 0; iAlt < nAlts; iAlt++) {
+      for (iAlt = 0; iAlt < nAlts; iAlt++)
+	component_out(iLon, iLat, iAlt) =
+	  vector_in(iLon, iLat, iAlt, iComponent);
+    }
+  }
+
+  return;
+  
+}
+
+// -----------------------------------------------------------------------
+// copy a 2D (per column) field all the way up each column, for
+// things like output files, which want everything in 3D
+// -----------------------------------------------------------------------
 
-	if (IsGeoGrid) {
-	  index = ijk_geo_s3gc(iLon,iLat,iAlt);
-	  indexv = ijkl_geo_v3gc(iLon,iLat,iAlt,iComponent);
-	} else {
-	  index = ijk_mag_s3gc(iLon,iLat,iAlt);
-	  indexv = ijkl_mag_v3gc(iLon,iLat,iAlt,iComponent);
-	}
+void expand_s2gc_to_s3gc(float *field_in_s2gc,
+			 grid_extents extents,
+			 float *field_out_s3gc) {
 
-	component_out_s3gc[index] = vector_in_v3gc[indexv];
+  long iLon, iLat, iAlt;
 
-      }
+  Field2D<float> field_in(field_in_s2gc, extents);
+  Field3D<float> field_out(field_out_s3gc, extents);
+
+  for (iLon = 0; iLon < extents.nLonsG; iLon++) {
+    for (iLat = 0; iLat < extents.nLatsG; iLat++) {
+      for (iAlt = 0; iAlt < extents.nAltsG; iAlt++)
+	field_out(iLon, iLat, iAlt) = field_in(iLon, iLat);
     }
   }
 
   return;
-  
+
 }
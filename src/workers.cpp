@@ -0,0 +1,238 @@
+// (c) 2020, the Aether Development Team (see doc/dev_team.md for members)
+// Full license can be found in License.md
+
+#include <iostream>
+#include <cstring>
+
+#include "../include/workers.h"
+
+// -----------------------------------------------------------------------------
+// Split up the grid and start the threads (thread 0 is the caller)
+// -----------------------------------------------------------------------------
+
+Workers::Workers(int nThreads_in,
+		 const grid_extents &extents_in,
+		 Report &report) {
+
+  extents = extents_in;
+  nThreads = nThreads_in;
+  if (nThreads < 1) nThreads = 1;
+
+  caller_now = nullptr;
+  kernel_now = nullptr;
+  tiles_now = nullptr;
+  iKernel = 0;
+  nBusy = 0;
+  IsDone = 0;
+
+  make_tiles_for_threads(report);
+  cost_tiles.resize(nThreads);
+  lon_costs.resize(extents.nLonsG);
+
+  for (int iThread = 1; iThread < nThreads; iThread++)
+    threads.push_back(std::thread(&Workers::work, this, iThread));
+
+}
+
+// -----------------------------------------------------------------------------
+// Tell the threads to stop, and wait for them
+// -----------------------------------------------------------------------------
+
+Workers::~Workers() {
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    IsDone = 1;
+  }
+  start_work.notify_all();
+
+  for (unsigned long iThread = 0; iThread < threads.size(); iThread++)
+    threads[iThread].join();
+
+}
+
+// -----------------------------------------------------------------------------
+// Cut the lon/lat plane into nLonTiles x nLatTiles = nThreads tiles,
+// as square as they can be (see factor_tiles).  If nThreads can't be
+// factored to fit in the grid (e.g., a big prime), use fewer threads.
+// -----------------------------------------------------------------------------
+
+void Workers::make_tiles_for_threads(Report &report) {
+
+  long nLonTiles = 1, nLatTiles = 1, iTile;
+
+  while (!factor_tiles(nThreads, extents.nLonsG, extents.nLatsG, 1,
+		       nLonTiles, nLatTiles)) {
+    std::cout << "Workers : can't split the grid into " << nThreads
+	      << " tiles, so trying " << nThreads - 1 << "\n";
+    nThreads--;
+  }
+
+  // Spread the extra columns out, so the tiles differ by at most one
+  // column in each direction:
+  tiles.resize(nThreads);
+  for (long iLonT = 0; iLonT < nLonTiles; iLonT++) {
+    for (long iLatT = 0; iLatT < nLatTiles; iLatT++) {
+      iTile = iLonT * nLatTiles + iLatT;
+      tiles[iTile].iLonStart = (extents.nLonsG * iLonT) / nLonTiles;
+      tiles[iTile].iLonEnd = (extents.nLonsG * (iLonT + 1)) / nLonTiles;
+      tiles[iTile].iLatStart = (extents.nLatsG * iLatT) / nLatTiles;
+      tiles[iTile].iLatEnd = (extents.nLatsG * (iLatT + 1)) / nLatTiles;
+    }
+  }
+
+  if (report.test_verbose(2))
+    std::cout << "Workers : " << nThreads << " thread(s), "
+	      << nLonTiles << " x " << nLatTiles << " tiles\n";
+
+}
+
+// -----------------------------------------------------------------------------
+// Cut the grid into a lon stripe for each thread, so that the stripes
+// have about the same total cost (see run with costs in workers.h).
+// Each stripe ends at the lon where the running total goes past its
+// share.  Nothing is allocated, since this is done every time.
+// -----------------------------------------------------------------------------
+
+void Workers::make_tiles_for_costs(const std::vector<float> &column_costs) {
+
+  long iLon, iLat, iLonStart = 0;
+  double total = 0.0, running = 0.0, share;
+
+  for (iLon = 0; iLon < extents.nLonsG; iLon++) {
+    lon_costs[iLon] = 0.0;
+    for (iLat = 0; iLat < extents.nLatsG; iLat++)
+      lon_costs[iLon] += column_costs[iLon * extents.nLatsG + iLat];
+    total += lon_costs[iLon];
+  }
+
+  iLon = 0;
+  for (int iThread = 0; iThread < nThreads; iThread++) {
+    // The last thread gets whatever is left:
+    if (iThread == nThreads - 1) {
+      iLon = extents.nLonsG;
+    } else {
+      share = total * (iThread + 1) / nThreads;
+      while (iLon < extents.nLonsG && running + 0.5 * lon_costs[iLon] < share) {
+	running += lon_costs[iLon];
+	iLon++;
+      }
+    }
+    cost_tiles[iThread].iLonStart = iLonStart;
+    cost_tiles[iThread].iLonEnd = iLon;
+    cost_tiles[iThread].iLatStart = 0;
+    cost_tiles[iThread].iLatEnd = extents.nLatsG;
+    iLonStart = iLon;
+  }
+
+}
+
+// -----------------------------------------------------------------------------
+// What each thread (except thread 0) does for the whole run: wait for
+// a kernel, do it on its tile, then say that it is done.
+// -----------------------------------------------------------------------------
+
+void Workers::work(int iThread) {
+
+  long iLastKernel = 0;
+  kernel_caller caller;
+  const void *kernel;
+  const std::vector<tile_struct> *tiles_to_run;
+
+  while (1) {
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      start_work.wait(lock, [&] { return IsDone || iKernel != iLastKernel; });
+      if (IsDone) return;
+      iLastKernel = iKernel;
+      caller = caller_now;
+      kernel = kernel_now;
+      tiles_to_run = tiles_now;
+    }
+
+    caller(kernel, (*tiles_to_run)[iThread], iThread);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      nBusy--;
+      if (nBusy == 0) work_done.notify_one();
+    }
+
+  }
+
+}
+
+// -----------------------------------------------------------------------------
+// Run a kernel on all of the tiles (see run in workers.h)
+// -----------------------------------------------------------------------------
+
+void Workers::run_kernel(kernel_caller caller,
+			 const void *kernel,
+			 const std::vector<tile_struct> &tiles_to_run) {
+
+  if (nThreads == 1) {
+    caller(kernel, tiles_to_run[0], 0);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    caller_now = caller;
+    kernel_now = kernel;
+    tiles_now = &tiles_to_run;
+    nBusy = nThreads - 1;
+    iKernel++;
+  }
+  start_work.notify_all();
+
+  caller(kernel, tiles_to_run[0], 0);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  work_done.wait(lock, [&] { return nBusy == 0; });
+  caller_now = nullptr;
+  kernel_now = nullptr;
+  tiles_now = nullptr;
+
+}
+
+// -----------------------------------------------------------------------------
+// Zero a new field, with each thread doing its own columns (see workers.h)
+// -----------------------------------------------------------------------------
+
+void Workers::first_touch(float *field, long nPoints, long nValuesPerPoint) {
+
+  if (nThreads == 1 || nPoints != extents.nPointsG) {
+    memset(field, 0, nPoints * nValuesPerPoint * sizeof(float));
+    return;
+  }
+
+  long nValuesPerColumn = extents.nAltsG * nValuesPerPoint;
+  Field2D<float> columns(NULL, extents);
+
+  run([&](const tile_struct &tile, int iThread) {
+    for (long iLon = tile.iLonStart; iLon < tile.iLonEnd; iLon++) {
+      // The lats of a tile are next to each other in memory:
+      long iColumn = columns.index(iLon, tile.iLatStart);
+      memset(field + iColumn * nValuesPerColumn, 0,
+	     (tile.iLatEnd - tile.iLatStart) * nValuesPerColumn * sizeof(float));
+    }
+  });
+
+}
+
+// -----------------------------------------------------------------------------
+// Number of threads (this can be less than asked for, see above)
+// -----------------------------------------------------------------------------
+
+int Workers::get_nThreads() {
+  return nThreads;
+}
+
+// -----------------------------------------------------------------------------
+// The tile that a thread owns
+// -----------------------------------------------------------------------------
+
+tile_struct Workers::get_tile(int iThread) {
+  return tiles[iThread];
+}